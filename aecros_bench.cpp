@@ -0,0 +1,649 @@
+//
+// Created by mk on 10/19/26.
+//
+
+// Microbenchmarks of the code behind the library and the audio path, for
+// tracking regressions on a given machine over time:
+//
+//   scan/…      directory walk (and stat) over a generated tree of files
+//   index/…     loading a compacted library snapshot
+//   search/…    TrackTable::search() against libraries of each size
+//   sort/…      TrackSorter on a three-column key
+//   list/…      row labels, then sf::Text layout and drawing (needs a display)
+//   decode/…    whole-file decode of WAV, FLAC and Ogg Vorbis
+//   dsp/…       DspChain blocks: int16 -> float -> EQ + limiter -> int16, and float only
+//   resample/…  resampleInterleaved(), 44.1 to 48 kHz
+//   mix/…       the mono mixdown that feeds the analysis tap
+//   fft/…, convolver/…
+//
+// Usage: aecros_bench [--filter text] [--min-time seconds] [--repetitions n]
+//                     [--sizes 1000,100000,…] [--out file.json]
+//
+// Each case is timed over enough iterations to last --min-time, repeated;
+// the JSON reports the median, fastest and slowest repetition per iteration
+// and, where it means something, items and bytes per second at the median.
+
+#include <SFML/Audio.hpp>
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dsp.hpp"
+#include "fft.hpp"
+#include "file_info.hpp"
+#include "library_journal.hpp"
+#include "media_paths.hpp"
+#include "pcm_cache.hpp"
+#include "pcm_tap.hpp"
+#include "track_sort.hpp"
+#include "track_table.hpp"
+
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const FONT_PATHS[] = {"arial.ttf", "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"};
+const int TREE_DIRECTORIES = 100;
+const int TREE_FILES_PER_DIRECTORY = 100;
+const unsigned TONE_SECONDS = 10;
+const unsigned TONE_RATE = 44100;
+const std::size_t BLOCK_FRAMES = 2048;  // AUDIO_BLOCK_FRAMES, without pulling in the stream
+const std::size_t MAX_ITERATIONS = 1u << 30;
+
+// Results feed this so the optimiser cannot drop the work that made them.
+volatile std::size_t sink = 0;
+
+struct Options {
+    std::string filter;
+    double minSeconds = 0.2;
+    int repetitions = 5;
+    std::vector<std::size_t> sizes = {1000, 100000, 1000000};
+    std::string output;
+};
+
+struct Measurement {
+    std::string name;
+    std::string skipped;  // Reason, for cases that could not run here
+    uint64_t iterations = 0;  // Per repetition
+    double medianNs = 0;  // All per iteration
+    double minNs = 0;
+    double maxNs = 0;
+    double itemsPerIteration = 0;
+    double bytesPerIteration = 0;
+};
+
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+class Harness {
+public:
+    explicit Harness(const Options& options) : options(options) {}
+
+    bool wants(const std::string& name) const {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    // body(n) does the work n times. items and bytes are per iteration.
+    void run(const std::string& name, const std::function<void(uint64_t)>& body, double items = 0,
+             double bytes = 0) {
+        if (!wants(name)) {
+            return;
+        }
+        std::cerr << name << "..." << std::flush;
+        // One untimed pass warms caches and sizes the timed ones.
+        Clock::time_point start = Clock::now();
+        body(1);
+        double once = std::max(1e-9, std::chrono::duration<double>(Clock::now() - start).count());
+        uint64_t iterations = static_cast<uint64_t>(
+                std::min<double>(MAX_ITERATIONS, std::max(1.0, std::ceil(options.minSeconds / once))));
+
+        std::vector<double> perIteration;
+        for (int rep = 0; rep < options.repetitions; ++rep) {
+            start = Clock::now();
+            body(iterations);
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            perIteration.push_back(ns / static_cast<double>(iterations));
+        }
+        std::sort(perIteration.begin(), perIteration.end());
+
+        Measurement result;
+        result.name = name;
+        result.iterations = iterations;
+        result.medianNs = perIteration[perIteration.size() / 2];
+        result.minNs = perIteration.front();
+        result.maxNs = perIteration.back();
+        result.itemsPerIteration = items;
+        result.bytesPerIteration = bytes;
+        results.push_back(result);
+        std::cerr << " " << result.medianNs / 1e3 << " us" << std::endl;
+    }
+
+    void skip(const std::string& name, const std::string& reason) {
+        if (!wants(name)) {
+            return;
+        }
+        Measurement result;
+        result.name = name;
+        result.skipped = reason;
+        results.push_back(result);
+        std::cerr << name << ": skipped, " << reason << std::endl;
+    }
+
+    void printJson(std::ostream& out) const;
+
+private:
+    const Options& options;
+    std::vector<Measurement> results;
+};
+
+std::string cpuModel() {
+    std::ifstream cpuInfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuInfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            std::size_t colon = line.find(':');
+            return colon == std::string::npos ? "" : line.substr(colon + 2);
+        }
+    }
+    return "";
+}
+
+void Harness::printJson(std::ostream& out) const {
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+
+    out << "{\n  \"context\": {\"date\": \"" << date << "\", \"host\": \"" << jsonEscape(host)
+        << "\", \"cpu\": \"" << jsonEscape(cpuModel()) << "\", \"cpus\": " << std::thread::hardware_concurrency()
+        << ", \"build\": \"" << build << "\", \"compiler\": \"" << jsonEscape(__VERSION__)
+        << "\", \"minTimeSeconds\": " << options.minSeconds << ", \"repetitions\": " << options.repetitions
+        << "},\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Measurement& result = results[i];
+        out << (i ? "," : "") << "\n    {\"name\": \"" << jsonEscape(result.name) << "\"";
+        if (!result.skipped.empty()) {
+            out << ", \"skipped\": \"" << jsonEscape(result.skipped) << "\"}";
+            continue;
+        }
+        out << ", \"iterations\": " << result.iterations << ", \"medianNs\": " << result.medianNs
+            << ", \"minNs\": " << result.minNs << ", \"maxNs\": " << result.maxNs;
+        if (result.itemsPerIteration > 0) {
+            out << ", \"itemsPerSecond\": " << result.itemsPerIteration * 1e9 / result.medianNs;
+        }
+        if (result.bytesPerIteration > 0) {
+            out << ", \"bytesPerSecond\": " << result.bytesPerIteration * 1e9 / result.medianNs;
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+// Three audio files in four, so the walk also has to reject some.
+void generateTree(const std::string& directory) {
+    static const char* const EXTENSIONS[] = {".flac", ".mp3", ".ogg", ".jpg"};
+    char name[64];
+    for (int d = 0; d < TREE_DIRECTORIES; ++d) {
+        std::string subdirectory = directory + "/Artist " + std::to_string(d / 10) + "/Album " + std::to_string(d);
+        std::filesystem::create_directories(subdirectory);
+        for (int f = 0; f < TREE_FILES_PER_DIRECTORY; ++f) {
+            std::snprintf(name, sizeof(name), "/%03d Track%s", f, EXTENSIONS[f % 4]);
+            std::ofstream(subdirectory + name);
+        }
+    }
+}
+
+// The same shape of library as the startup bench: tagged rows stored as one
+// compacted snapshot. Paths do not need to exist.
+void generateLibrary(const std::string& directory, std::size_t trackCount) {
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    LibraryJournal journal(directory);
+    TrackTable table;
+    journal.load(table);
+
+    char path[128];
+    char title[64];
+    TrackInfo info;
+    for (std::size_t i = 0; i < trackCount; ++i) {
+        std::snprintf(path, sizeof(path), "/bench/Artist %04zu/Album %03zu/%02zu Track %07zu.flac", i % 5000,
+                      (i / 12) % 400, i % 12 + 1, i);
+        std::snprintf(title, sizeof(title), "Track %07zu", i);
+        info.title = title;
+        info.artist = "Artist " + std::to_string(i % 5000);
+        info.album = "Album " + std::to_string((i / 12) % 400);
+        info.trackNumber = static_cast<uint16_t>(i % 12 + 1);
+        info.durationMs = static_cast<uint32_t>(120000 + (i * 7919) % 240000);
+        journal.recordAdd(path);
+        journal.recordInfo(static_cast<TrackId>(i), info);
+    }
+    journal.flush();
+    // The destructor waits for the snapshot to be written.
+    journal.compact();
+}
+
+// A chord with a little noise, so the lossy and lossless encoders both have
+// something realistic to chew on.
+std::vector<sf::Int16> makeTone(std::size_t frames, unsigned channels) {
+    std::vector<sf::Int16> samples(frames * channels);
+    uint32_t noise = 12345;
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+        double t = static_cast<double>(frame) / TONE_RATE;
+        double value = 0.3 * std::sin(2 * M_PI * 220 * t) + 0.2 * std::sin(2 * M_PI * 277 * t) +
+                       0.1 * std::sin(2 * M_PI * 3300 * t);
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            noise = noise * 1664525u + 1013904223u;
+            double dither = (static_cast<int>(noise >> 16) - 32768) / 32768.0 * 0.01;
+            samples[frame * channels + ch] = static_cast<sf::Int16>(std::lrint((value + dither) * 32767));
+        }
+    }
+    return samples;
+}
+
+bool writeTone(const std::string& path, const std::vector<sf::Int16>& samples) {
+    sf::OutputSoundFile file;
+    if (!file.openFromFile(path, TONE_RATE, 2)) {
+        return false;
+    }
+    file.write(samples.data(), samples.size());
+    return true;
+}
+
+// Same as trackLabel() in window.cpp.
+std::string rowLabel(const TrackTable& library, TrackId track) {
+    std::string_view title = library.title(track);
+    if (title.empty()) {
+        return library.path(track);
+    }
+    std::string_view artist = library.artist(track);
+    std::string label(artist);
+    if (!label.empty()) {
+        label += " - ";
+    }
+    label.append(title.data(), title.size());
+    return label;
+}
+
+std::string withCount(const std::string& name, const char* unit, std::size_t count) {
+    return name + "/" + unit + ":" + std::to_string(count);
+}
+
+void benchScan(Harness& harness, const std::string& root) {
+    std::size_t fileCount = static_cast<std::size_t>(TREE_DIRECTORIES) * TREE_FILES_PER_DIRECTORY;
+    std::string walkName = withCount("scan/walk", "files", fileCount);
+    std::string statName = withCount("scan/walkAndStat", "files", fileCount);
+    if (!harness.wants(walkName) && !harness.wants(statName)) {
+        return;
+    }
+    std::string directory = root + "/tree";
+    generateTree(directory);
+    // Warm cache: this measures the walk, not the disk.
+    harness.run(walkName, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            std::vector<std::string> files;
+            findAudioFiles(directory, files);
+            sink = sink + files.size();
+        }
+    }, static_cast<double>(fileCount));
+    harness.run(statName, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            std::vector<std::string> files;
+            findAudioFiles(directory, files);
+            FileInfo info;
+            for (const auto& path : files) {
+                sink = sink + statFile(path, info);
+            }
+        }
+    }, static_cast<double>(fileCount));
+}
+
+void benchList(Harness& harness, const TrackTable& library, const std::vector<TrackId>& rows) {
+    const std::size_t ROW_COUNTS[] = {20, 1000};  // One screen, and a long unfiltered list
+    for (std::size_t rowCount : ROW_COUNTS) {
+        rowCount = std::min(rowCount, rows.size());
+        harness.run(withCount("list/labels", "rows", rowCount), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (std::size_t row = 0; row < rowCount; ++row) {
+                    sink = sink + rowLabel(library, rows[row]).size();
+                }
+            }
+        }, static_cast<double>(rowCount));
+    }
+
+    bool wanted = false;
+    for (std::size_t rowCount : ROW_COUNTS) {
+        wanted = wanted || harness.wants(withCount("list/layout", "rows", rowCount)) ||
+                 harness.wants(withCount("list/draw", "rows", rowCount));
+    }
+    if (!wanted) {
+        return;
+    }
+    // Glyphs live in textures, so text needs an OpenGL context.
+    sf::Font font;
+    bool fontFound = false;
+    for (const char* path : FONT_PATHS) {
+        fontFound = fontFound || font.loadFromFile(path);
+    }
+    const char* reason = nullptr;
+    if (!std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY")) {
+        reason = "no display to create an OpenGL context on";
+    } else if (!fontFound) {
+        reason = "no font found";
+    }
+    sf::RenderTexture target;
+    if (!reason && !target.create(800, 600)) {
+        reason = "could not create a render texture";
+    }
+    for (std::size_t rowCount : ROW_COUNTS) {
+        rowCount = std::min(rowCount, rows.size());
+        std::string layoutName = withCount("list/layout", "rows", rowCount);
+        std::string drawName = withCount("list/draw", "rows", rowCount);
+        if (reason) {
+            harness.skip(layoutName, reason);
+            harness.skip(drawName, reason);
+            continue;
+        }
+        // As the window lays out each row on screen: a fresh sf::Text per
+        // row per frame. The window only draws the rows that fit, so a frame
+        // costs what one screen's worth does here.
+        harness.run(layoutName, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (std::size_t row = 0; row < rowCount; ++row) {
+                    sf::Text text(rowLabel(library, rows[row]), font, 15);
+                    sink = sink + static_cast<std::size_t>(text.getLocalBounds().width);
+                }
+            }
+        }, static_cast<double>(rowCount));
+        // CPU side of a frame; display() only flushes the commands.
+        harness.run(drawName, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                target.clear();
+                float y = 50;
+                for (std::size_t row = 0; row < rowCount; ++row) {
+                    sf::Text text(rowLabel(library, rows[row]), font, 15);
+                    text.setFillColor(sf::Color::White);
+                    text.setPosition(100, y);
+                    target.draw(text);
+                    y += 30;
+                }
+                target.display();
+            }
+        }, static_cast<double>(rowCount));
+    }
+}
+
+void benchLibrary(Harness& harness, const Options& options, const std::string& root) {
+    struct Query {
+        const char* label;
+        const char* text;
+    };
+    // Everything, one artist in 5000, a single track, and nothing.
+    const Query QUERIES[] = {{"all", ""}, {"artist", "artist 0042"}, {"exact", "track 0000999"}, {"none", "zzzz"}};
+    const std::vector<SortKey> SORT_KEYS = {{SortColumn::Artist, false}, {SortColumn::Album, false},
+                                            {SortColumn::TrackNumber, false}};
+
+    for (std::size_t trackCount : options.sizes) {
+        std::string prefix = "/tracks:" + std::to_string(trackCount);
+        bool wanted = harness.wants("index/load" + prefix) || harness.wants("sort" + prefix) ||
+                      (trackCount == options.sizes.back() && harness.wants("list/"));
+        for (const Query& query : QUERIES) {
+            wanted = wanted || harness.wants("search" + prefix + "/query:" + query.label);
+        }
+        if (!wanted) {
+            continue;
+        }
+        std::string directory = root + "/library-" + std::to_string(trackCount);
+        std::cerr << "Generating " << trackCount << " tracks..." << std::endl;
+        generateLibrary(directory, trackCount);
+
+        harness.run("index/load" + prefix, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                LibraryJournal journal(directory);
+                TrackTable table;
+                journal.load(table);
+                sink = sink + table.size();
+            }
+        }, static_cast<double>(trackCount));
+
+        TrackTable library;
+        {
+            LibraryJournal journal(directory);
+            journal.load(library);
+        }
+        std::vector<TrackId> results;
+        for (const Query& query : QUERIES) {
+            harness.run("search" + prefix + "/query:" + query.label, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    results.clear();
+                    library.search(query.text, results);
+                    sink = sink + results.size();
+                }
+            }, static_cast<double>(trackCount));
+        }
+
+        std::vector<TrackId> all;
+        library.search("", all);
+        TrackSorter sorter;
+        std::vector<TrackId> sorted;
+        harness.run("sort" + prefix + "/keys:artist,album,track", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                sorted = all;
+                sorter.sort(library, SORT_KEYS, sorted);
+                sink = sink + sorted.front();
+            }
+        }, static_cast<double>(trackCount));
+
+        if (trackCount == options.sizes.back()) {
+            std::vector<TrackId> rows;
+            library.search("", rows);
+            benchList(harness, library, rows);
+        }
+    }
+}
+
+void benchDecode(Harness& harness, const std::string& root) {
+    const char* const FORMATS[] = {"wav", "flac", "ogg"};
+    std::vector<sf::Int16> tone;
+    for (const char* format : FORMATS) {
+        std::string name = std::string("decode/") + format + "/seconds:" + std::to_string(TONE_SECONDS);
+        if (!harness.wants(name)) {
+            continue;
+        }
+        if (tone.empty()) {
+            tone = makeTone(static_cast<std::size_t>(TONE_SECONDS) * TONE_RATE, 2);
+        }
+        std::string path = root + "/tone." + format;
+        if (!writeTone(path, tone)) {
+            harness.skip(name, std::string("cannot encode ") + format);
+            continue;
+        }
+        double frames = static_cast<double>(TONE_SECONDS) * TONE_RATE;
+        harness.run(name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                DecodedTrack track;
+                decodeTrack(path, track);
+                sink = sink + track.samples.size();
+            }
+        }, frames, frames * 2 * sizeof(int16_t));
+    }
+}
+
+void benchKernels(Harness& harness) {
+    std::vector<sf::Int16> source = makeTone(BLOCK_FRAMES, 2);
+    double blockItems = static_cast<double>(BLOCK_FRAMES);
+
+    // A busy EQ curve, so every band is active.
+    DspSettings settings = defaultDspSettings();
+    for (int band = 0; band < settings.bandCount; ++band) {
+        settings.bands[band].gainDb = band % 2 ? -3.0f : 4.0f;
+    }
+    settings.preampDb = -2.0f;
+    DspChain chain;
+    chain.prepare(TONE_RATE, 2, BLOCK_FRAMES);
+    chain.setSettings(settings);
+
+    // Refilled each time so the limiter sees the same signal; the copy is part of the figure.
+    std::vector<int16_t> block(source.size());
+    harness.run(withCount("dsp/int16/eq+limiter", "frames", BLOCK_FRAMES), [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            std::copy(source.begin(), source.end(), block.begin());
+            chain.processInt16(block.data(), BLOCK_FRAMES);
+        }
+        sink = sink + block[0];
+    }, blockItems, blockItems * 2 * sizeof(int16_t));
+
+    std::vector<float> floatSource(source.size());
+    for (std::size_t i = 0; i < source.size(); ++i) {
+        floatSource[i] = source[i] * (1.0f / 32768.0f);
+    }
+    std::vector<float> floatBlock(floatSource.size());
+    harness.run(withCount("dsp/float/eq+limiter", "frames", BLOCK_FRAMES), [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            std::copy(floatSource.begin(), floatSource.end(), floatBlock.begin());
+            chain.process(floatBlock.data(), BLOCK_FRAMES);
+        }
+        sink = sink + static_cast<std::size_t>(floatBlock[0] > 0);
+    }, blockItems, blockItems * 2 * sizeof(float));
+
+    std::vector<float> mono(BLOCK_FRAMES);
+    harness.run(withCount("mix/mono/channels:2", "frames", BLOCK_FRAMES), [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            mixToMono(source.data(), BLOCK_FRAMES, 2, mono.data());
+        }
+        sink = sink + static_cast<std::size_t>(mono[1] > 0);
+    }, blockItems);
+
+    std::vector<float> second(static_cast<std::size_t>(TONE_RATE) * 2);
+    for (std::size_t i = 0; i < second.size(); ++i) {
+        second[i] = floatSource[i % floatSource.size()];
+    }
+    harness.run("resample/44100to48000/seconds:1", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            sink = sink + resampleInterleaved(second, 2, 44100, 48000).size();
+        }
+    }, static_cast<double>(TONE_RATE));
+
+    const std::size_t FFT_SIZE = 4096;  // SPECTRUM_FFT_SIZE
+    RealFft fft(FFT_SIZE);
+    std::vector<float> re(fft.bins()), im(fft.bins());
+    harness.run(withCount("fft/real", "size", FFT_SIZE), [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            fft.forward(second.data(), re.data(), im.data());
+        }
+        sink = sink + static_cast<std::size_t>(re[1] > 0);
+    }, static_cast<double>(FFT_SIZE));
+
+    // A one-second stereo room response, as a typical correction filter.
+    ImpulseResponse response;
+    response.channelCount = 2;
+    response.sampleRate = TONE_RATE;
+    response.samples.resize(static_cast<std::size_t>(TONE_RATE) * 2);
+    for (std::size_t i = 0; i < response.samples.size(); ++i) {
+        response.samples[i] = std::exp(-static_cast<float>(i) / TONE_RATE * 6.0f) * (i % 7 == 0 ? 0.5f : -0.1f);
+    }
+    Convolver convolver(response, TONE_RATE, 2);
+    harness.run(withCount("convolver/ir:1s", "frames", BLOCK_FRAMES), [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            std::copy(floatSource.begin(), floatSource.end(), floatBlock.begin());
+            convolver.process(floatBlock.data(), BLOCK_FRAMES);
+        }
+        sink = sink + static_cast<std::size_t>(floatBlock[0] > 0);
+    }, blockItems);
+}
+
+bool parseSizes(const std::string& list, std::vector<std::size_t>& sizes) {
+    sizes.clear();
+    std::istringstream input(list);
+    std::string item;
+    while (std::getline(input, item, ',')) {
+        char* end = nullptr;
+        unsigned long long value = std::strtoull(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value == 0) {
+            return false;
+        }
+        sizes.push_back(static_cast<std::size_t>(value));
+    }
+    std::sort(sizes.begin(), sizes.end());
+    return !sizes.empty();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            options.minSeconds = std::max(0.001, std::atof(argv[++i]));
+        } else if (arg == "--repetitions" && hasValue) {
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--sizes" && hasValue && parseSizes(argv[i + 1], options.sizes)) {
+            ++i;
+        } else if (arg == "--out" && hasValue) {
+            options.output = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--filter text] [--min-time seconds] [--repetitions n] [--sizes n,n,...] [--out file]"
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    std::string root = (std::filesystem::temp_directory_path() / ("aecros-bench-" + std::to_string(getpid()))).string();
+    std::error_code error;
+    std::filesystem::create_directories(root, error);
+
+    Harness harness(options);
+    benchScan(harness, root);
+    benchLibrary(harness, options, root);
+    benchDecode(harness, root);
+    benchKernels(harness);
+    std::filesystem::remove_all(root, error);
+
+    if (options.output.empty()) {
+        harness.printJson(std::cout);
+        return 0;
+    }
+    std::ofstream outFile(options.output, std::ios::trunc);
+    harness.printJson(outFile);
+    if (!outFile) {
+        std::cerr << "Could not write " << options.output << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "audio_stream.hpp"
+#include <algorithm>
+
+AudioStream::~AudioStream() {
+    stop();
+}
+
+bool openStreamSource(const std::string& path, StreamSource& source) {
+    auto file = std::make_unique<sf::InputSoundFile>();
+    if (!file->openFromFile(path) || file->getChannelCount() == 0) {
+        return false;
+    }
+    source.path = path;
+    source.channelCount = file->getChannelCount();
+    source.sampleRate = file->getSampleRate();
+    source.duration = file->getDuration();
+    source.primed.resize(AUDIO_BLOCK_FRAMES * source.channelCount);
+    source.primed.resize(static_cast<std::size_t>(file->read(source.primed.data(), source.primed.size())));
+    source.file = std::move(file);
+    source.memoryTrack.reset();
+    return true;
+}
+
+bool openStreamSource(std::shared_ptr<const DecodedTrack> track, StreamSource& source) {
+    if (!track || track->channelCount == 0 || track->sampleRate == 0) {
+        return false;
+    }
+    uint64_t frames = track->samples.size() / track->channelCount;
+    source.channelCount = track->channelCount;
+    source.sampleRate = track->sampleRate;
+    source.duration = sf::microseconds(static_cast<sf::Int64>(frames * 1000000 / track->sampleRate));
+    source.primed.clear();
+    source.file.reset();
+    source.memoryTrack = std::move(track);
+    return true;
+}
+
+bool AudioStream::openFromFile(const std::string& path) {
+    StreamSource source;
+    if (!openStreamSource(path, source)) {
+        return false;
+    }
+    open(std::move(source));
+    return true;
+}
+
+bool AudioStream::openFromMemory(std::shared_ptr<const DecodedTrack> track) {
+    StreamSource source;
+    if (!openStreamSource(std::move(track), source)) {
+        return false;
+    }
+    open(std::move(source));
+    return true;
+}
+
+void AudioStream::open(StreamSource&& source) {
+    stop();
+
+    file = std::move(source.file);
+    memoryTrack = std::move(source.memoryTrack);
+    memoryOffset = 0;
+    primed = std::move(source.primed);
+    duration = source.duration;
+
+    unsigned channelCount = source.channelCount;
+    samples.assign(AUDIO_BLOCK_FRAMES * channelCount, 0);
+    tapScratch.assign(AUDIO_BLOCK_FRAMES, 0.0f);
+    tap.sampleRate = source.sampleRate;
+    dspChain.prepare(source.sampleRate, channelCount, AUDIO_BLOCK_FRAMES);
+    initialize(channelCount, source.sampleRate);
+}
+
+sf::Time AudioStream::getDuration() const {
+    return duration;
+}
+
+void AudioStream::setDspSettings(const DspSettings& settings) {
+    dspChain.setSettings(settings);
+}
+
+void AudioStream::setImpulseResponse(std::shared_ptr<const ImpulseResponse> impulseResponse) {
+    dspChain.setImpulseResponse(std::move(impulseResponse));
+}
+
+bool AudioStream::onGetData(Chunk& data) {
+    std::size_t count;
+    if (!primed.empty()) {
+        // The block decoded while opening; the file is already positioned after it.
+        count = primed.size();
+        std::copy(primed.begin(), primed.end(), samples.begin());
+        primed.clear();
+    } else if (memoryTrack) {
+        count = std::min(samples.size(), memoryTrack->samples.size() - memoryOffset);
+        std::copy(memoryTrack->samples.begin() + memoryOffset, memoryTrack->samples.begin() + memoryOffset + count,
+                  samples.begin());
+        memoryOffset += count;
+    } else {
+        count = static_cast<std::size_t>(file->read(samples.data(), samples.size()));
+    }
+    unsigned channelCount = getChannelCount();
+    dspChain.processInt16(samples.data(), count / channelCount);
+
+    if (tap.enabled.load(std::memory_order_relaxed)) {
+        std::size_t frames = count / channelCount;
+        mixToMono(samples.data(), frames, channelCount, tapScratch.data());
+        tap.ring.write(tapScratch.data(), frames);
+    }
+
+    data.samples = samples.data();
+    data.sampleCount = count;
+    return count == samples.size();
+}
+
+void AudioStream::onSeek(sf::Time timeOffset) {
+    primed.clear();
+    if (memoryTrack) {
+        uint64_t frame = static_cast<uint64_t>(timeOffset.asMicroseconds()) * memoryTrack->sampleRate / 1000000;
+        memoryOffset = std::min<std::size_t>(frame * memoryTrack->channelCount, memoryTrack->samples.size());
+    } else {
+        file->seek(timeOffset);
+    }
+    dspChain.reset();
+}
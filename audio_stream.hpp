@@ -0,0 +1,70 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_AUDIO_STREAM_HPP
+#define AECROS_AUDIO_STREAM_HPP
+
+#include <SFML/Audio.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "dsp.hpp"
+#include "pcm_cache.hpp"
+#include "pcm_tap.hpp"
+
+const std::size_t AUDIO_BLOCK_FRAMES = 2048;
+
+// An opened decoder (or cached PCM) with its first block already decoded.
+// Built off the UI thread and handed to AudioStream::open(), which only has
+// to swap it in.
+struct StreamSource {
+    std::string path;
+    std::unique_ptr<sf::InputSoundFile> file;  // Null when playing from memory
+    std::shared_ptr<const DecodedTrack> memoryTrack;
+    std::vector<sf::Int16> primed;
+    unsigned channelCount = 0;
+    unsigned sampleRate = 0;
+    sf::Time duration;
+};
+
+bool openStreamSource(const std::string& path, StreamSource& source);
+bool openStreamSource(std::shared_ptr<const DecodedTrack> track, StreamSource& source);
+
+// Drop-in replacement for sf::Music that runs decoded blocks through the
+// DSP chain before handing them to the sound card.
+class AudioStream : public sf::SoundStream {
+public:
+    AudioStream() = default;
+    ~AudioStream() override;
+
+    bool openFromFile(const std::string& path);
+    // Plays straight from RAM; the stream keeps the track alive while open.
+    bool openFromMemory(std::shared_ptr<const DecodedTrack> track);
+    // Takes over a source prepared elsewhere; does no I/O of its own.
+    void open(StreamSource&& source);
+    sf::Time getDuration() const;
+
+    // Safe to call from the UI thread at any time.
+    void setDspSettings(const DspSettings& settings);
+    void setImpulseResponse(std::shared_ptr<const ImpulseResponse> impulseResponse);
+
+    PcmTap& outputTap() { return tap; }
+
+protected:
+    bool onGetData(Chunk& data) override;
+    void onSeek(sf::Time timeOffset) override;
+
+private:
+    std::unique_ptr<sf::InputSoundFile> file;
+    std::shared_ptr<const DecodedTrack> memoryTrack;
+    std::size_t memoryOffset = 0;
+    std::vector<sf::Int16> primed;
+    std::vector<sf::Int16> samples;
+    std::vector<float> tapScratch;
+    DspChain dspChain;
+    PcmTap tap;
+    sf::Time duration;
+};
+
+#endif //AECROS_AUDIO_STREAM_HPP
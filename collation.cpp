@@ -0,0 +1,76 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "collation.hpp"
+
+namespace {
+
+const uint64_t EMPTY_KEY = UINT64_MAX;
+
+bool isAsciiAlnum(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+}
+
+// Yields the collated bytes of a string one at a time.
+class CollatedReader {
+public:
+    explicit CollatedReader(std::string_view text) : text(text) {
+        while (position < text.size() && !isAsciiAlnum(static_cast<unsigned char>(text[position]))) {
+            ++position;
+        }
+        if (text.size() - position > 4 && fold(text[position]) == 't' && fold(text[position + 1]) == 'h' &&
+            fold(text[position + 2]) == 'e' && text[position + 3] == ' ') {
+            position += 4;
+        }
+    }
+
+    bool done() const { return position >= text.size(); }
+    unsigned char next() { return fold(static_cast<unsigned char>(text[position++])); }
+
+private:
+    std::string_view text;
+    std::size_t position = 0;
+};
+
+}
+
+uint64_t collationKey(std::string_view text, std::size_t offset) {
+    CollatedReader reader(text);
+    if (reader.done()) {
+        return EMPTY_KEY;
+    }
+    for (std::size_t i = 0; i < offset && !reader.done(); ++i) {
+        reader.next();
+    }
+    uint64_t key = 0;
+    for (int i = 0; i < 8; ++i) {
+        key = (key << 8) | (reader.done() ? 0 : reader.next());
+    }
+    // A real key can never reach EMPTY_KEY: byte 0xFF is not valid UTF-8.
+    return key;
+}
+
+bool collationKeyIsPrefix(uint64_t key) {
+    return key != EMPTY_KEY && (key & 0xFF) != 0;
+}
+
+int compareCollated(std::string_view a, std::string_view b) {
+    CollatedReader left(a);
+    CollatedReader right(b);
+    if (left.done() || right.done()) {
+        return left.done() == right.done() ? 0 : (left.done() ? 1 : -1);
+    }
+    while (!left.done() && !right.done()) {
+        unsigned char l = left.next();
+        unsigned char r = right.next();
+        if (l != r) {
+            return l < r ? -1 : 1;
+        }
+    }
+    return left.done() == right.done() ? 0 : (left.done() ? -1 : 1);
+}
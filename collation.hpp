@@ -0,0 +1,27 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_COLLATION_HPP
+#define AECROS_COLLATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Sort order for display strings: ASCII case is folded, leading punctuation
+// and a leading "the " are skipped, and empty strings sort last. Bytes
+// outside ASCII compare as-is, which keeps UTF-8 text grouped after Latin.
+
+// Eight collated bytes packed big-endian, starting offset bytes in, so
+// comparing keys as integers agrees with compareCollated() except between
+// strings that share those eight bytes. Keys at increasing offsets break
+// such ties.
+uint64_t collationKey(std::string_view text, std::size_t offset = 0);
+
+// True if text may collate past what its key holds, i.e. key ties need compareCollated().
+bool collationKeyIsPrefix(uint64_t key);
+
+int compareCollated(std::string_view a, std::string_view b);
+
+#endif //AECROS_COLLATION_HPP
@@ -0,0 +1,200 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "convolver.hpp"
+#include "dsp.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+uint16_t readLe16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLe32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+}
+
+bool loadImpulseResponse(const std::string& path, ImpulseResponse& impulseResponse) {
+    std::ifstream inFile(path, std::ios::binary);
+    if (!inFile) {
+        std::cerr << "Could not open impulse response: " << path << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 || std::memcmp(data.data() + 8, "WAVE", 4) != 0) {
+        std::cerr << "Not a WAV file: " << path << std::endl;
+        return false;
+    }
+
+    uint16_t format = 0, channelCount = 0, bitsPerSample = 0;
+    uint32_t sampleRate = 0;
+    const unsigned char* pcm = nullptr;
+    std::size_t pcmSize = 0;
+
+    std::size_t offset = 12;
+    while (offset + 8 <= data.size()) {
+        const unsigned char* chunk = data.data() + offset;
+        uint32_t chunkSize = readLe32(chunk + 4);
+        std::size_t available = std::min<std::size_t>(chunkSize, data.size() - offset - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            format = readLe16(chunk + 8);
+            channelCount = readLe16(chunk + 10);
+            sampleRate = readLe32(chunk + 12);
+            bitsPerSample = readLe16(chunk + 22);
+            if (format == 0xFFFE && available >= 26) {
+                format = readLe16(chunk + 32);  // WAVE_FORMAT_EXTENSIBLE sub-format
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            pcm = chunk + 8;
+            pcmSize = available;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    bool isPcm = format == 1 && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+    bool isFloat = format == 3 && (bitsPerSample == 32 || bitsPerSample == 64);
+    if (!pcm || channelCount == 0 || sampleRate == 0 || (!isPcm && !isFloat)) {
+        std::cerr << "Unsupported WAV format in impulse response: " << path << std::endl;
+        return false;
+    }
+
+    std::size_t bytesPerSample = bitsPerSample / 8;
+    std::size_t sampleCount = pcmSize / bytesPerSample;
+    sampleCount -= sampleCount % channelCount;
+
+    impulseResponse.path = path;
+    impulseResponse.channelCount = channelCount;
+    impulseResponse.sampleRate = sampleRate;
+    impulseResponse.samples.resize(sampleCount);
+    for (std::size_t i = 0; i < sampleCount; ++i) {
+        const unsigned char* p = pcm + i * bytesPerSample;
+        float value = 0.0f;
+        if (isFloat && bitsPerSample == 32) {
+            uint32_t bits = readLe32(p);
+            std::memcpy(&value, &bits, sizeof(value));
+        } else if (isFloat) {
+            uint64_t bits = readLe32(p) | (static_cast<uint64_t>(readLe32(p + 4)) << 32);
+            double wide;
+            std::memcpy(&wide, &bits, sizeof(wide));
+            value = static_cast<float>(wide);
+        } else if (bitsPerSample == 16) {
+            value = static_cast<int16_t>(readLe16(p)) / 32768.0f;
+        } else if (bitsPerSample == 24) {
+            int32_t sample = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+            value = sample / 8388608.0f;
+        } else {
+            value = static_cast<int32_t>(readLe32(p)) / 2147483648.0f;
+        }
+        impulseResponse.samples[i] = value;
+    }
+    return true;
+}
+
+Convolver::Convolver(const ImpulseResponse& impulseResponse, unsigned sampleRate, unsigned channelCount,
+                     std::size_t blockSize)
+    : rate(sampleRate), channels(channelCount), blockSize(blockSize), binCount(blockSize + 1),
+      partitions(1), fft(blockSize * 2) {
+    std::vector<float> filter = impulseResponse.samples;
+    unsigned filterChannels = std::max(1u, impulseResponse.channelCount);
+    if (impulseResponse.sampleRate != 0 && impulseResponse.sampleRate != sampleRate) {
+        filter = resampleInterleaved(filter, filterChannels, impulseResponse.sampleRate, sampleRate);
+    }
+    std::size_t filterFrames = filter.size() / filterChannels;
+    partitions = std::max<std::size_t>(1, (filterFrames + blockSize - 1) / blockSize);
+
+    std::vector<float> padded(blockSize * 2);
+    channelState.resize(channels);
+    for (unsigned ch = 0; ch < channels; ++ch) {
+        Channel& state = channelState[ch];
+        state.filterRe.assign(partitions * binCount, 0.0f);
+        state.filterIm.assign(partitions * binCount, 0.0f);
+        state.historyRe.assign(partitions * binCount, 0.0f);
+        state.historyIm.assign(partitions * binCount, 0.0f);
+        state.input.assign(blockSize * 2, 0.0f);
+        state.output.assign(blockSize, 0.0f);
+
+        // A mono response is applied to every channel.
+        unsigned source = ch % filterChannels;
+        for (std::size_t p = 0; p < partitions; ++p) {
+            std::fill(padded.begin(), padded.end(), 0.0f);
+            for (std::size_t i = 0; i < blockSize; ++i) {
+                std::size_t frame = p * blockSize + i;
+                if (frame >= filterFrames) {
+                    break;
+                }
+                padded[i] = filter[frame * filterChannels + source];
+            }
+            fft.forward(padded.data(), state.filterRe.data() + p * binCount, state.filterIm.data() + p * binCount);
+        }
+    }
+
+    accumulatorRe.resize(binCount);
+    accumulatorIm.resize(binCount);
+    timeBuffer.resize(blockSize * 2);
+}
+
+void Convolver::reset() {
+    for (Channel& state : channelState) {
+        std::fill(state.historyRe.begin(), state.historyRe.end(), 0.0f);
+        std::fill(state.historyIm.begin(), state.historyIm.end(), 0.0f);
+        std::fill(state.input.begin(), state.input.end(), 0.0f);
+        std::fill(state.output.begin(), state.output.end(), 0.0f);
+    }
+    historyPosition = 0;
+    blockFill = 0;
+}
+
+void Convolver::process(float* samples, std::size_t frameCount) {
+    std::size_t done = 0;
+    while (done < frameCount) {
+        std::size_t span = std::min(blockSize - blockFill, frameCount - done);
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            Channel& state = channelState[ch];
+            float* input = state.input.data() + blockSize + blockFill;
+            const float* output = state.output.data() + blockFill;
+            float* frame = samples + done * channels + ch;
+            for (std::size_t i = 0; i < span; ++i) {
+                input[i] = frame[i * channels];
+                frame[i * channels] = output[i];
+            }
+        }
+        blockFill += span;
+        done += span;
+        if (blockFill == blockSize) {
+            processBlock();
+            blockFill = 0;
+        }
+    }
+}
+
+void Convolver::processBlock() {
+    for (Channel& state : channelState) {
+        float* historyRe = state.historyRe.data() + historyPosition * binCount;
+        float* historyIm = state.historyIm.data() + historyPosition * binCount;
+        fft.forward(state.input.data(), historyRe, historyIm);
+
+        std::fill(accumulatorRe.begin(), accumulatorRe.end(), 0.0f);
+        std::fill(accumulatorIm.begin(), accumulatorIm.end(), 0.0f);
+        for (std::size_t p = 0; p < partitions; ++p) {
+            std::size_t slot = (historyPosition + partitions - p) % partitions;
+            complexMultiplyAccumulate(state.historyRe.data() + slot * binCount, state.historyIm.data() + slot * binCount,
+                                      state.filterRe.data() + p * binCount, state.filterIm.data() + p * binCount,
+                                      accumulatorRe.data(), accumulatorIm.data(), binCount);
+        }
+
+        // Overlap-save: the second half of the circular result is the valid output.
+        fft.inverse(accumulatorRe.data(), accumulatorIm.data(), timeBuffer.data());
+        std::copy(timeBuffer.begin() + blockSize, timeBuffer.end(), state.output.begin());
+        std::copy(state.input.begin() + blockSize, state.input.end(), state.input.begin());
+    }
+    historyPosition = (historyPosition + 1) % partitions;
+}
@@ -0,0 +1,66 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_CONVOLVER_HPP
+#define AECROS_CONVOLVER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "fft.hpp"
+
+const std::size_t CONVOLVER_BLOCK_FRAMES = 1024;
+
+struct ImpulseResponse {
+    std::string path;
+    std::vector<float> samples;  // Interleaved
+    unsigned channelCount = 0;
+    unsigned sampleRate = 0;
+
+    std::size_t frameCount() const { return channelCount ? samples.size() / channelCount : 0; }
+};
+
+// Reads 16/24/32-bit PCM or 32/64-bit float WAV files at full precision.
+bool loadImpulseResponse(const std::string& path, ImpulseResponse& impulseResponse);
+
+// Uniformly partitioned overlap-save FIR convolution. The impulse response
+// is cut into blocks, each transformed once; every audio block then costs
+// one forward FFT, one inverse FFT and a multiply-accumulate per partition.
+// Latency is exactly one block regardless of how process() is called.
+class Convolver {
+public:
+    Convolver(const ImpulseResponse& impulseResponse, unsigned sampleRate, unsigned channelCount,
+              std::size_t blockSize = CONVOLVER_BLOCK_FRAMES);
+
+    unsigned sampleRate() const { return rate; }
+    unsigned channelCount() const { return channels; }
+    std::size_t latency() const { return blockSize; }
+
+    void process(float* samples, std::size_t frameCount);
+    void reset();
+
+private:
+    struct Channel {
+        std::vector<float> filterRe, filterIm;  // partitions * bins
+        std::vector<float> historyRe, historyIm;  // Frequency-domain delay line
+        std::vector<float> input;   // Previous block + current block
+        std::vector<float> output;  // Last computed block
+    };
+
+    void processBlock();
+
+    unsigned rate;
+    unsigned channels;
+    std::size_t blockSize;
+    std::size_t binCount;
+    std::size_t partitions;
+    RealFft fft;
+    std::vector<Channel> channelState;
+    std::vector<float> accumulatorRe, accumulatorIm;
+    std::vector<float> timeBuffer;
+    std::size_t historyPosition = 0;
+    std::size_t blockFill = 0;
+};
+
+#endif //AECROS_CONVOLVER_HPP
@@ -0,0 +1,630 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "daemon.hpp"
+#include <SFML/Audio.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "audio_stream.hpp"
+#include "library_journal.hpp"
+#include "media_paths.hpp"
+#include "pcm_cache.hpp"
+#include "play_queue.hpp"
+#include "prefetcher.hpp"
+#include "settings.hpp"
+#include "track_loader.hpp"
+#include "track_table.hpp"
+
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const int MAX_EVENTS = 64;
+const std::size_t READ_CHUNK = 4096;
+const std::size_t MAX_LINE_BYTES = 4096;
+const std::size_t MAX_PENDING_OUTPUT = 1 << 20;  // A client that reads slower than this is dropped
+const std::size_t SEARCH_LIMIT = 50;
+const long TICK_MS = 100;  // Only while loading or playing
+const auto LOAD_BUDGET = std::chrono::milliseconds(20);
+
+// Signal handlers only set the flag and poke the loop; everything else
+// happens on the loop itself.
+volatile std::sig_atomic_t stopRequested = 0;
+int stopEventFd = -1;
+
+void requestStop(int) {
+    stopRequested = 1;
+    uint64_t one = 1;
+    ssize_t written = write(stopEventFd, &one, sizeof(one));
+    (void)written;
+}
+
+struct Client {
+    std::string input;
+    std::string output;
+    bool writeArmed = false;
+    bool closing = false;  // Close once the output has gone out
+};
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool parseTrackId(std::string_view text, TrackId& id) {
+    std::string digits(text);
+    char* end = nullptr;
+    errno = 0;
+    unsigned long value = std::strtoul(digits.c_str(), &end, 10);
+    if (digits.empty() || *end != '\0' || errno != 0 || value >= NO_TRACK) {
+        return false;
+    }
+    id = static_cast<TrackId>(value);
+    return true;
+}
+
+// Keeps every reply line a single line.
+void appendField(std::string& out, std::string_view text) {
+    for (char c : text) {
+        out += (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+    }
+}
+
+void appendSeconds(std::string& out, float seconds) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", seconds);
+    out += buffer;
+}
+
+class PlayerDaemon {
+public:
+    explicit PlayerDaemon(std::string socketPath);
+    ~PlayerDaemon();
+
+    bool start();
+    void run();
+
+private:
+    void acceptClients();
+    void readClient(int fd, Client& client);
+    void flushClient(int fd, Client& client);
+    void closeClient(int fd);
+    void handleCommand(std::string_view line, Client& client);
+    void appendStatus(std::string& out);
+
+    void tick();
+    void updateTimer();
+    void playTrack(TrackId track);
+    void startLoadedTrack();
+    void prefetchUpcoming();
+    void saveResumePosition();
+
+    std::string socketPath;
+    std::string mediaDir = mediaDirectory();
+    int listenFd = -1;
+    int epollFd = -1;
+    int timerFd = -1;
+    bool timerArmed = false;
+    std::unordered_map<int, Client> clients;
+
+    AppSettings appSettings;
+    TrackTable library;
+    LibraryJournal journal{mediaDir};
+    PlayQueue playQueue;
+    PcmCache pcmCache{0};
+    Prefetcher prefetcher;
+    TrackLoader trackLoader{pcmCache, prefetcher};
+    AudioStream music;
+    TrackId loadingTrack = NO_TRACK;
+    TrackId playingTrack = NO_TRACK;
+    std::string nowPlayingPath;
+    bool wantPlaying = false;  // Cleared by pause and stop; a stream that stops by itself moves on
+    std::vector<TrackId> searchResults;
+};
+
+PlayerDaemon::PlayerDaemon(std::string socketPath) : socketPath(std::move(socketPath)) {}
+
+PlayerDaemon::~PlayerDaemon() {
+    saveResumePosition();
+    music.stop();
+    journal.flush();
+    for (const auto& entry : clients) {
+        close(entry.first);
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    for (int fd : {epollFd, timerFd, stopEventFd}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    stopEventFd = -1;
+}
+
+bool PlayerDaemon::start() {
+    std::error_code error;
+    std::filesystem::create_directories(mediaDir, error);
+    appSettings = loadSettings(mediaDir + "/settings.txt");
+    pcmCache.setBudget(appSettings.pcmCacheMb << 20);
+    music.setImpulseResponse(loadRoomCorrection(appSettings));
+    music.setDspSettings(appSettings.dsp);
+    // Tracks removed by another frontend stay as empty rows; skip them.
+    playQueue.setRemoved(&library.removedFlags());
+    journal.startLoad();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    // Replace a socket left behind by a crash, but never a live daemon's.
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        bool inUse = connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        close(probe);
+        if (inUse) {
+            std::cerr << "Another daemon is listening on " << socketPath << std::endl;
+            return false;
+        }
+    }
+    unlink(socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    mode_t oldMask = umask(077);  // Owner only: the socket controls playback
+    bool bound = listenFd >= 0 && bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    umask(oldMask);
+    if (!bound || listen(listenFd, SOMAXCONN) != 0) {
+        std::cerr << "Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    stopEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || timerFd < 0 || stopEventFd < 0) {
+        std::cerr << "Could not set up the event loop: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    for (int fd : {listenFd, timerFd, stopEventFd}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    updateTimer();
+    std::cerr << "Listening on " << socketPath << std::endl;
+    return true;
+}
+
+void PlayerDaemon::run() {
+    epoll_event events[MAX_EVENTS];
+    while (!stopRequested) {
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptClients();
+            } else if (fd == timerFd) {
+                uint64_t expirations;
+                ssize_t got = read(timerFd, &expirations, sizeof(expirations));
+                (void)got;
+                tick();
+            } else if (fd == stopEventFd) {
+                uint64_t value;
+                ssize_t got = read(stopEventFd, &value, sizeof(value));
+                (void)got;
+            } else {
+                auto it = clients.find(fd);
+                if (it == clients.end()) {
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    readClient(fd, it->second);
+                } else if (events[i].events & EPOLLOUT) {
+                    flushClient(fd, it->second);
+                } else {
+                    closeClient(fd);
+                }
+            }
+        }
+        updateTimer();
+    }
+}
+
+void PlayerDaemon::acceptClients() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        clients.emplace(fd, Client());
+    }
+}
+
+// Reads everything available and answers every complete line in one go,
+// so a pipelined batch costs one read and one write.
+void PlayerDaemon::readClient(int fd, Client& client) {
+    bool peerClosed = false;
+    char buffer[READ_CHUNK];
+    while (true) {
+        ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+        if (got > 0) {
+            client.input.append(buffer, static_cast<std::size_t>(got));
+            continue;
+        }
+        if (got == 0) {
+            peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            closeClient(fd);
+            return;
+        }
+        break;
+    }
+
+    std::size_t start = 0;
+    for (std::size_t end = client.input.find('\n'); end != std::string::npos && !client.closing;
+         end = client.input.find('\n', start)) {
+        handleCommand(std::string_view(client.input).substr(start, end - start), client);
+        start = end + 1;
+    }
+    client.input.erase(0, start);
+    if (client.input.size() > MAX_LINE_BYTES) {
+        client.output += "ERR line too long\n";
+        client.closing = true;
+    }
+    if (peerClosed) {
+        client.closing = true;
+    }
+    flushClient(fd, client);
+}
+
+void PlayerDaemon::flushClient(int fd, Client& client) {
+    std::size_t sent = 0;
+    while (sent < client.output.size()) {
+        ssize_t count = send(fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+        if (count > 0) {
+            sent += static_cast<std::size_t>(count);
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            closeClient(fd);
+            return;
+        }
+    }
+    client.output.erase(0, sent);
+
+    if (client.output.empty() && client.closing) {
+        closeClient(fd);
+        return;
+    }
+    if (client.output.size() > MAX_PENDING_OUTPUT) {
+        closeClient(fd);
+        return;
+    }
+    // Only ask for EPOLLOUT while there is something waiting to go out.
+    bool wantWrite = !client.output.empty();
+    if (wantWrite != client.writeArmed) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+        client.writeArmed = wantWrite;
+    }
+}
+
+void PlayerDaemon::closeClient(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
+
+void PlayerDaemon::handleCommand(std::string_view line, Client& client) {
+    line = trim(line);
+    if (line.empty()) {
+        return;
+    }
+    std::size_t space = line.find(' ');
+    std::string_view command = line.substr(0, space);
+    std::string_view argument = space == std::string_view::npos ? std::string_view() : trim(line.substr(space + 1));
+    std::string& out = client.output;
+    TrackId track = NO_TRACK;
+
+    if (command == "play") {
+        if (!argument.empty()) {
+            if (!parseTrackId(argument, track) || track >= library.size() || library.isRemoved(track)) {
+                out += "ERR no such track\n";
+                return;
+            }
+            playQueue.play(track);
+            playTrack(track);
+        } else if (music.getStatus() == sf::SoundSource::Paused) {
+            music.play();
+            wantPlaying = true;
+        } else if (music.getStatus() == sf::SoundSource::Stopped && loadingTrack == NO_TRACK) {
+            track = playQueue.current() != NO_TRACK ? playQueue.current() : playQueue.next();
+            if (track == NO_TRACK) {
+                out += "ERR nothing to play\n";
+                return;
+            }
+            playTrack(track);
+        }
+        out += "OK\n";
+    } else if (command == "pause") {
+        music.pause();
+        wantPlaying = false;
+        out += "OK\n";
+    } else if (command == "stop") {
+        trackLoader.cancel();
+        loadingTrack = NO_TRACK;
+        saveResumePosition();
+        music.stop();
+        wantPlaying = false;
+        out += "OK\n";
+    } else if (command == "next" || command == "prev") {
+        track = command == "next" ? playQueue.next() : playQueue.previous();
+        if (track == NO_TRACK) {
+            out += "ERR end of queue\n";
+            return;
+        }
+        playTrack(track);
+        out += "OK " + std::to_string(track) + "\n";
+    } else if (command == "queue") {
+        if (!parseTrackId(argument, track) || track >= library.size() || library.isRemoved(track)) {
+            out += "ERR no such track\n";
+            return;
+        }
+        playQueue.enqueueNext(track);
+        out += "OK\n";
+    } else if (command == "seek") {
+        char* end = nullptr;
+        std::string number(argument);
+        double seconds = std::strtod(number.c_str(), &end);
+        if (number.empty() || *end != '\0' || !std::isfinite(seconds) || seconds < 0) {
+            out += "ERR bad position\n";
+            return;
+        }
+        if (music.getStatus() == sf::SoundSource::Stopped) {
+            // A stopped stream ignores seeks.
+            out += "ERR not playing\n";
+            return;
+        }
+        // Past the end means the end; clamped first, as a huge value would
+        // not fit in the milliseconds SFML takes.
+        sf::Time duration = music.getDuration();
+        sf::Time offset = seconds < duration.asSeconds() ? sf::milliseconds(static_cast<sf::Int32>(seconds * 1000))
+                                                         : duration;
+        music.setPlayingOffset(offset);
+        out += "OK\n";
+    } else if (command == "volume") {
+        if (!argument.empty()) {
+            char* end = nullptr;
+            std::string number(argument);
+            double volume = std::strtod(number.c_str(), &end);
+            if (*end != '\0') {
+                out += "ERR bad volume\n";
+                return;
+            }
+            music.setVolume(static_cast<float>(std::clamp(volume, 0.0, 100.0)));
+        }
+        out += "OK " + std::to_string(static_cast<int>(music.getVolume() + 0.5f)) + "\n";
+    } else if (command == "search") {
+        library.search(argument, searchResults);
+        std::size_t shown = std::min(searchResults.size(), SEARCH_LIMIT);
+        out += "OK " + std::to_string(shown) + " " + std::to_string(searchResults.size()) + "\n";
+        for (std::size_t i = 0; i < shown; ++i) {
+            TrackId result = searchResults[i];
+            out += std::to_string(result);
+            out += '\t';
+            std::string_view artist = library.artist(result);
+            if (!artist.empty() && !library.title(result).empty()) {
+                appendField(out, artist);
+                out += " - ";
+            }
+            appendField(out, library.sortTitle(result));
+            out += '\n';
+        }
+    } else if (command == "status") {
+        appendStatus(out);
+    } else if (command == "ping") {
+        out += "OK pong\n";
+    } else if (command == "quit") {
+        out += "OK bye\n";
+        client.closing = true;
+    } else {
+        out += "ERR unknown command\n";
+    }
+}
+
+void PlayerDaemon::appendStatus(std::string& out) {
+    const char* state = "stopped";
+    if (loadingTrack != NO_TRACK) {
+        state = "loading";
+    } else if (music.getStatus() == sf::SoundSource::Playing) {
+        state = "playing";
+    } else if (music.getStatus() == sf::SoundSource::Paused) {
+        state = "paused";
+    }
+    out += "OK state=";
+    out += state;
+    out += " track=" + (playingTrack == NO_TRACK ? std::string("-") : std::to_string(playingTrack));
+    out += " position=";
+    appendSeconds(out, music.getPlayingOffset().asSeconds());
+    out += " duration=";
+    appendSeconds(out, music.getDuration().asSeconds());
+    out += " volume=" + std::to_string(static_cast<int>(music.getVolume() + 0.5f));
+    out += " tracks=" + std::to_string(library.trackCount());
+    out += journal.isLoading() ? " library=loading" : journal.isReadOnly() ? " library=read-only" : " library=ready";
+    // Last, as the path may contain spaces.
+    out += " path=";
+    appendField(out, nowPlayingPath);
+    out += '\n';
+}
+
+// Runs every TICK_MS, and only while updateTimer() finds work to do.
+void PlayerDaemon::tick() {
+    if (journal.isLoading()) {
+        if (!journal.applyLoaded(library, LOAD_BUDGET)) {
+            library.shrinkToFit();
+        }
+        playQueue.setLibrary(library.size());
+    }
+    startLoadedTrack();
+
+    // Played to the end: carry on through the queue.
+    if (wantPlaying && loadingTrack == NO_TRACK && music.getStatus() == sf::SoundSource::Stopped) {
+        TrackId track = playQueue.next();
+        if (track == NO_TRACK) {
+            wantPlaying = false;
+        } else {
+            playTrack(track);
+        }
+    }
+}
+
+void PlayerDaemon::updateTimer() {
+    bool wantTick = journal.isLoading() || loadingTrack != NO_TRACK || wantPlaying;
+    if (wantTick == timerArmed) {
+        return;
+    }
+    itimerspec spec{};
+    if (wantTick) {
+        spec.it_interval.tv_nsec = TICK_MS * 1000000;
+        spec.it_value = spec.it_interval;
+    }
+    timerfd_settime(timerFd, 0, &spec, nullptr);
+    timerArmed = wantTick;
+}
+
+// Opening happens on the loader thread; tick() picks the result up.
+void PlayerDaemon::playTrack(TrackId track) {
+    saveResumePosition();
+    music.stop();
+    loadingTrack = track;
+    wantPlaying = true;
+    trackLoader.request(library.path(track));
+}
+
+void PlayerDaemon::startLoadedTrack() {
+    TrackLoader::Result loaded;
+    if (!trackLoader.poll(loaded)) {
+        return;
+    }
+    TrackId track = loadingTrack;
+    loadingTrack = NO_TRACK;
+    if (!loaded.ok) {
+        std::cerr << "Could not play media: " << loaded.path << std::endl;
+        // Skipped over by tick(), like a track that ended.
+        return;
+    }
+    music.open(std::move(loaded.source));
+    music.play();
+    playingTrack = track;
+    nowPlayingPath = loaded.path;
+    appSettings.resumePath = loaded.path;
+    appSettings.resumePositionMs = 0;
+    saveSettings(mediaDir + "/settings.txt", appSettings);
+
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+    library.notePlayed(track, now);
+    journal.recordPlayed(track, now);
+    journal.flush();
+    if (journal.wantsCompaction()) {
+        journal.compact();
+    }
+    if (!loaded.fromCache) {
+        pcmCache.prefill(loaded.path);
+    }
+    prefetchUpcoming();
+}
+
+void PlayerDaemon::prefetchUpcoming() {
+    std::vector<std::string> upcoming;
+    for (TrackId track : playQueue.peek(appSettings.prefetchTracks)) {
+        if (track != playQueue.current()) {
+            upcoming.push_back(library.path(track));
+        }
+    }
+    prefetcher.schedule(upcoming);
+}
+
+void PlayerDaemon::saveResumePosition() {
+    if (nowPlayingPath.empty() || music.getStatus() == sf::SoundSource::Stopped) {
+        return;
+    }
+    appSettings.resumePath = nowPlayingPath;
+    appSettings.resumePositionMs = static_cast<uint32_t>(music.getPlayingOffset().asMilliseconds());
+    saveSettings(mediaDir + "/settings.txt", appSettings);
+}
+
+}
+
+std::string defaultDaemonSocketPath() {
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && *runtimeDir) {
+        return std::string(runtimeDir) + "/aecros.sock";
+    }
+    return "/tmp/aecros-" + std::to_string(getuid()) + ".sock";
+}
+
+int runDaemon(const std::string& socketPath) {
+    PlayerDaemon daemon(socketPath);
+    if (!daemon.start()) {
+        return 1;
+    }
+    daemon.run();
+    return 0;
+}
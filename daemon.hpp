@@ -0,0 +1,35 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_DAEMON_HPP
+#define AECROS_DAEMON_HPP
+
+#include <string>
+
+// Runs the player without a window: the shared library and the audio engine,
+// driven over a Unix domain socket from a single epoll loop. Nothing wakes
+// the loop while it is idle, so idle clients cost only their descriptor.
+//
+// The protocol is line based. Each request is one line, "<command> [args]",
+// and gets exactly one reply, "OK [result]" or "ERR <reason>", in request
+// order, so clients may pipeline as many requests as they like in one write.
+// "search" is the one reply with a body: "OK <shown> <total>" followed by
+// <shown> lines of "<track id>\t<label>".
+//
+//   play [id]        resume, or play the given track
+//   pause | stop | next | prev
+//   queue <id>       play id after the current track
+//   seek <seconds>
+//   volume [0-100]   set or report the volume
+//   search <text>    up to 50 matches from the library
+//   status           state=… track=… position=… duration=… volume=… tracks=… library=… path=…
+//   ping | quit
+//
+// Returns the process exit code.
+int runDaemon(const std::string& socketPath);
+
+// $XDG_RUNTIME_DIR/aecros.sock, or /tmp/aecros-<uid>.sock without it.
+std::string defaultDaemonSocketPath();
+
+#endif //AECROS_DAEMON_HPP
@@ -0,0 +1,16 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include <iostream>
+#include "daemon.hpp"
+
+// aecrosd [socket path]: the player without a window. Built apart from the
+// GUI so it links only the core and runs where there is no display.
+int main(int argc, char* argv[]) {
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        std::cerr << "Usage: " << argv[0] << " [socket path]" << std::endl;
+        return 2;
+    }
+    return runDaemon(argc > 1 ? argv[1] : defaultDaemonSocketPath());
+}
@@ -0,0 +1,436 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "dsp.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+
+namespace {
+
+// Channels of one frame into the low lanes of a register, and back. The
+// unused lanes are zero and never stored.
+template <unsigned LANES>
+inline __m128 loadLanes(const float* samples) {
+    if constexpr (LANES == 4) {
+        return _mm_loadu_ps(samples);
+    } else if constexpr (LANES == 3) {
+        return _mm_setr_ps(samples[0], samples[1], samples[2], 0.0f);
+    } else if constexpr (LANES == 2) {
+        return _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(samples));
+    } else {
+        return _mm_load_ss(samples);
+    }
+}
+
+template <unsigned LANES>
+inline void storeLanes(float* samples, __m128 value) {
+    if constexpr (LANES == 4) {
+        _mm_storeu_ps(samples, value);
+    } else if constexpr (LANES == 3) {
+        _mm_storel_pi(reinterpret_cast<__m64*>(samples), value);
+        _mm_store_ss(samples + 2, _mm_movehl_ps(value, value));
+    } else if constexpr (LANES == 2) {
+        _mm_storel_pi(reinterpret_cast<__m64*>(samples), value);
+    } else {
+        _mm_store_ss(samples, value);
+    }
+}
+
+}
+#endif
+
+DspSettings defaultDspSettings() {
+    static const float frequencies[MAX_EQ_BANDS] = {31.0f, 62.0f, 125.0f, 250.0f, 500.0f,
+                                                    1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f};
+    DspSettings settings;
+    for (int i = 0; i < MAX_EQ_BANDS; ++i) {
+        settings.bands[i].type = FilterType::Peaking;
+        settings.bands[i].frequency = frequencies[i];
+        settings.bands[i].gainDb = 0.0f;
+        settings.bands[i].q = 1.41f;
+    }
+    settings.bandCount = MAX_EQ_BANDS;
+    return settings;
+}
+
+BiquadCoefficients makeBiquad(const EqBand& band, float sampleRate) {
+    const double pi = 3.14159265358979323846;
+    double frequency = std::min<double>(band.frequency, sampleRate * 0.49);
+    double A = std::pow(10.0, band.gainDb / 40.0);
+    double w0 = 2.0 * pi * frequency / sampleRate;
+    double cosW0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * std::max(band.q, 0.05f));
+    double sqrtA2Alpha = 2.0 * std::sqrt(A) * alpha;
+
+    double b0, b1, b2, a0, a1, a2;
+    switch (band.type) {
+        case FilterType::LowShelf:
+            b0 = A * ((A + 1) - (A - 1) * cosW0 + sqrtA2Alpha);
+            b1 = 2 * A * ((A - 1) - (A + 1) * cosW0);
+            b2 = A * ((A + 1) - (A - 1) * cosW0 - sqrtA2Alpha);
+            a0 = (A + 1) + (A - 1) * cosW0 + sqrtA2Alpha;
+            a1 = -2 * ((A - 1) + (A + 1) * cosW0);
+            a2 = (A + 1) + (A - 1) * cosW0 - sqrtA2Alpha;
+            break;
+        case FilterType::HighShelf:
+            b0 = A * ((A + 1) + (A - 1) * cosW0 + sqrtA2Alpha);
+            b1 = -2 * A * ((A - 1) + (A + 1) * cosW0);
+            b2 = A * ((A + 1) + (A - 1) * cosW0 - sqrtA2Alpha);
+            a0 = (A + 1) - (A - 1) * cosW0 + sqrtA2Alpha;
+            a1 = 2 * ((A - 1) - (A + 1) * cosW0);
+            a2 = (A + 1) - (A - 1) * cosW0 - sqrtA2Alpha;
+            break;
+        case FilterType::LowPass:
+            b0 = (1 - cosW0) / 2;
+            b1 = 1 - cosW0;
+            b2 = (1 - cosW0) / 2;
+            a0 = 1 + alpha;
+            a1 = -2 * cosW0;
+            a2 = 1 - alpha;
+            break;
+        case FilterType::HighPass:
+            b0 = (1 + cosW0) / 2;
+            b1 = -(1 + cosW0);
+            b2 = (1 + cosW0) / 2;
+            a0 = 1 + alpha;
+            a1 = -2 * cosW0;
+            a2 = 1 - alpha;
+            break;
+        case FilterType::Peaking:
+        default:
+            b0 = 1 + alpha * A;
+            b1 = -2 * cosW0;
+            b2 = 1 - alpha * A;
+            a0 = 1 + alpha / A;
+            a1 = -2 * cosW0;
+            a2 = 1 - alpha / A;
+            break;
+    }
+
+    BiquadCoefficients c;
+    c.b0 = static_cast<float>(b0 / a0);
+    c.b1 = static_cast<float>(b1 / a0);
+    c.b2 = static_cast<float>(b2 / a0);
+    c.a1 = static_cast<float>(a1 / a0);
+    c.a2 = static_cast<float>(a2 / a0);
+    return c;
+}
+
+std::vector<float> resampleInterleaved(const std::vector<float>& input, unsigned channelCount,
+                                       unsigned fromRate, unsigned toRate) {
+    if (fromRate == toRate || channelCount == 0 || fromRate == 0 || toRate == 0) {
+        return input;
+    }
+    const double pi = 3.14159265358979323846;
+    const int HALF_TAPS = 32;
+
+    std::size_t inputFrames = input.size() / channelCount;
+    std::size_t outputFrames = static_cast<std::size_t>(static_cast<double>(inputFrames) * toRate / fromRate);
+    double step = static_cast<double>(fromRate) / toRate;
+    double cutoff = std::min(1.0, 1.0 / step);  // Low-pass below the lower Nyquist frequency
+
+    std::vector<float> output(outputFrames * channelCount, 0.0f);
+    std::vector<double> weights(2 * HALF_TAPS);
+    for (std::size_t frame = 0; frame < outputFrames; ++frame) {
+        double position = frame * step;
+        long center = static_cast<long>(std::floor(position));
+        double weightSum = 0.0;
+        for (int t = 0; t < 2 * HALF_TAPS; ++t) {
+            double x = position - (center - HALF_TAPS + 1 + t);
+            double sinc = std::fabs(x) < 1e-9 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+            double window = 0.42 + 0.5 * std::cos(pi * x / HALF_TAPS) + 0.08 * std::cos(2.0 * pi * x / HALF_TAPS);
+            weights[t] = std::fabs(x) >= HALF_TAPS ? 0.0 : sinc * window;
+            weightSum += weights[t];
+        }
+        for (int t = 0; t < 2 * HALF_TAPS; ++t) {
+            long source = center - HALF_TAPS + 1 + t;
+            if (source < 0 || source >= static_cast<long>(inputFrames)) {
+                continue;
+            }
+            // Normalising by the weight sum keeps the DC gain at exactly one.
+            double weight = weights[t] / weightSum;
+            for (unsigned ch = 0; ch < channelCount; ++ch) {
+                output[frame * channelCount + ch] += static_cast<float>(weight * input[source * channelCount + ch]);
+            }
+        }
+    }
+    return output;
+}
+
+DspChain::DspChain() : pendingSettings(defaultDspSettings()), settings(defaultDspSettings()) {
+    reset();
+}
+
+DspChain::~DspChain() {
+    delete pendingConvolver.exchange(nullptr);
+    delete retiredConvolver.exchange(nullptr);
+    delete convolver;
+}
+
+void DspChain::setSettings(const DspSettings& newSettings) {
+    pendingSettings.write(newSettings);
+}
+
+void DspChain::setImpulseResponse(std::shared_ptr<const ImpulseResponse> newImpulseResponse) {
+    impulseResponse = std::move(newImpulseResponse);
+    if (impulseResponse && impulseResponse->frameCount() > 0 && channels > 0 && channels <= MAX_DSP_CHANNELS) {
+        publishConvolver(new Convolver(*impulseResponse, sampleRate, channels));
+    }
+}
+
+void DspChain::publishConvolver(Convolver* next) {
+    collectRetiredConvolver();
+    // A convolver the audio thread never picked up can be freed right here.
+    delete pendingConvolver.exchange(next, std::memory_order_acq_rel);
+}
+
+void DspChain::collectRetiredConvolver() {
+    delete retiredConvolver.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void DspChain::acquireConvolver() {
+    // Only swap once the previous convolver has been collected, so the audio
+    // thread never has to free anything itself.
+    if (retiredConvolver.load(std::memory_order_acquire) != nullptr) {
+        return;
+    }
+    Convolver* next = pendingConvolver.exchange(nullptr, std::memory_order_acq_rel);
+    if (next) {
+        retiredConvolver.store(convolver, std::memory_order_release);
+        convolver = next;
+    }
+}
+
+void DspChain::prepare(unsigned newSampleRate, unsigned channelCount, std::size_t maxFrames) {
+    sampleRate = newSampleRate;
+    channels = channelCount;
+    scratch.assign(maxFrames * channels, 0.0f);
+    pendingSettings.update();
+    settings = pendingSettings.read();
+    updateCoefficients();
+
+    // The audio thread is stopped, so the convolver can be swapped directly.
+    collectRetiredConvolver();
+    Convolver* next = pendingConvolver.exchange(nullptr, std::memory_order_acq_rel);
+    if (next) {
+        delete convolver;
+        convolver = next;
+    }
+    bool formatChanged = convolver && (convolver->sampleRate() != sampleRate || convolver->channelCount() != channels);
+    if (formatChanged || (!convolver && impulseResponse)) {
+        delete convolver;
+        convolver = nullptr;
+        if (impulseResponse && impulseResponse->frameCount() > 0 && channels > 0 && channels <= MAX_DSP_CHANNELS) {
+            convolver = new Convolver(*impulseResponse, sampleRate, channels);
+        }
+    }
+    reset();
+}
+
+void DspChain::reset() {
+    std::memset(state1, 0, sizeof(state1));
+    std::memset(state2, 0, sizeof(state2));
+    limiterGain = 1.0f;
+    if (convolver) {
+        convolver->reset();
+    }
+}
+
+void DspChain::updateCoefficients() {
+    // Flat peaking/shelf bands are identities, so only the bands that do
+    // something are kept in the processing list. A band that comes back
+    // starts from silence rather than from state left over from before.
+    activeBands = 0;
+    for (int i = 0; i < MAX_EQ_BANDS; ++i) {
+        const EqBand& band = settings.bands[i];
+        bool passBand = band.type == FilterType::LowPass || band.type == FilterType::HighPass;
+        bool active = i < settings.bandCount && (passBand || std::fabs(band.gainDb) >= 0.01f);
+        if (active) {
+            if (!bandActive[i]) {
+                std::fill(std::begin(state1[i]), std::end(state1[i]), 0.0f);
+                std::fill(std::begin(state2[i]), std::end(state2[i]), 0.0f);
+            }
+            coefficients[i] = makeBiquad(band, static_cast<float>(sampleRate));
+            activeBandList[activeBands++] = i;
+        }
+        bandActive[i] = active;
+    }
+
+    preampGain = std::pow(10.0f, settings.preampDb / 20.0f);
+    limiterCeiling = std::pow(10.0f, settings.limiterCeilingDb / 20.0f);
+    limiterRelease = std::exp(-1.0f / (std::max(settings.limiterReleaseMs, 1.0f) * 0.001f * sampleRate));
+    bool unsupported = channels == 0 || channels > MAX_DSP_CHANNELS;
+    bypass = (activeBands == 0 && std::fabs(settings.preampDb) < 0.01f && !settings.limiterEnabled) || unsupported;
+    if (unsupported) {
+        settings.roomCorrectionEnabled = false;
+    }
+}
+
+void DspChain::applyPendingSettings() {
+    if (pendingSettings.update()) {
+        settings = pendingSettings.read();
+        updateCoefficients();
+    }
+    acquireConvolver();
+}
+
+void DspChain::process(float* samples, std::size_t frameCount) {
+    applyPendingSettings();
+    if (!bypass || (settings.roomCorrectionEnabled && convolver)) {
+        processStages(samples, frameCount);
+    }
+}
+
+void DspChain::processInt16(int16_t* samples, std::size_t frameCount) {
+    applyPendingSettings();
+    if (bypass && !(settings.roomCorrectionEnabled && convolver)) {
+        return;
+    }
+    // Blocks larger than the scratch buffer go through it a piece at a time.
+    std::size_t chunkFrames = channels > 0 ? scratch.size() / channels : 0;
+    if (chunkFrames == 0) {
+        return;
+    }
+    float* buffer = scratch.data();
+    for (std::size_t first = 0; first < frameCount; first += chunkFrames) {
+        std::size_t frames = std::min(chunkFrames, frameCount - first);
+        std::size_t count = frames * channels;
+        int16_t* chunk = samples + first * channels;
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer[i] = chunk[i] * (1.0f / 32768.0f);
+        }
+        processStages(buffer, frames);
+        for (std::size_t i = 0; i < count; ++i) {
+            float value = std::max(-1.0f, std::min(1.0f, buffer[i]));
+            chunk[i] = static_cast<int16_t>(std::lrint(value * 32767.0f));
+        }
+    }
+}
+
+void DspChain::processStages(float* samples, std::size_t frameCount) {
+#if defined(__SSE__)
+    // Decaying filter state would otherwise fall into denormals and stall the FPU.
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+#endif
+    if (preampGain != 1.0f) {
+        std::size_t count = frameCount * channels;
+        for (std::size_t i = 0; i < count; ++i) {
+            samples[i] *= preampGain;
+        }
+    }
+    if (activeBands > 0) {
+        processEq(samples, frameCount);
+    }
+    if (settings.roomCorrectionEnabled && convolver) {
+        convolver->process(samples, frameCount);
+    }
+    if (settings.limiterEnabled) {
+        processLimiter(samples, frameCount);
+    }
+}
+
+void DspChain::processEq(float* samples, std::size_t frameCount) {
+#if defined(__SSE__)
+    // One __m128 carries the same sample of up to four channels.
+    for (unsigned group = 0; group < channels; group += DSP_LANES) {
+        switch (std::min<unsigned>(DSP_LANES, channels - group)) {
+            case 1:
+                biquadGroupSse<1>(samples + group, frameCount, group);
+                break;
+            case 2:
+                biquadGroupSse<2>(samples + group, frameCount, group);
+                break;
+            case 3:
+                biquadGroupSse<3>(samples + group, frameCount, group);
+                break;
+            default:
+                biquadGroupSse<4>(samples + group, frameCount, group);
+                break;
+        }
+    }
+#else
+    // Channels are grouped into fixed-width lanes so the inner loop is the
+    // same four multiply-adds for every channel.
+    for (unsigned group = 0; group < channels; group += DSP_LANES) {
+        unsigned lanes = std::min<unsigned>(DSP_LANES, channels - group);
+        for (std::size_t frame = 0; frame < frameCount; ++frame) {
+            float* frameSamples = samples + frame * channels + group;
+            alignas(16) float x[DSP_LANES] = {};
+            for (unsigned lane = 0; lane < lanes; ++lane) {
+                x[lane] = frameSamples[lane];
+            }
+            for (int active = 0; active < activeBands; ++active) {
+                int band = activeBandList[active];
+                const BiquadCoefficients& c = coefficients[band];
+                float* s1 = state1[band] + group;
+                float* s2 = state2[band] + group;
+                for (int lane = 0; lane < DSP_LANES; ++lane) {
+                    float y = c.b0 * x[lane] + s1[lane];
+                    s1[lane] = c.b1 * x[lane] - c.a1 * y + s2[lane];
+                    s2[lane] = c.b2 * x[lane] - c.a2 * y;
+                    x[lane] = y;
+                }
+            }
+            for (unsigned lane = 0; lane < lanes; ++lane) {
+                frameSamples[lane] = x[lane];
+            }
+        }
+    }
+#endif
+}
+
+#if defined(__SSE__)
+template <unsigned LANES>
+void DspChain::biquadGroupSse(float* samples, std::size_t frameCount, unsigned group) {
+    // Band by band over the whole block, so each band's state and
+    // coefficients stay in registers; the block itself stays in L1.
+    for (int active = 0; active < activeBands; ++active) {
+        int band = activeBandList[active];
+        const BiquadCoefficients& c = coefficients[band];
+        const __m128 b0 = _mm_set1_ps(c.b0);
+        const __m128 b1 = _mm_set1_ps(c.b1);
+        const __m128 b2 = _mm_set1_ps(c.b2);
+        const __m128 a1 = _mm_set1_ps(c.a1);
+        const __m128 a2 = _mm_set1_ps(c.a2);
+        // group is a multiple of DSP_LANES, so these are 16-byte aligned.
+        __m128 s1 = _mm_load_ps(state1[band] + group);
+        __m128 s2 = _mm_load_ps(state2[band] + group);
+        float* frameSamples = samples;
+        for (std::size_t frame = 0; frame < frameCount; ++frame, frameSamples += channels) {
+            __m128 x = loadLanes<LANES>(frameSamples);
+            __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), s1);
+            s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), s2);
+            s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+            storeLanes<LANES>(frameSamples, y);
+        }
+        _mm_store_ps(state1[band] + group, s1);
+        _mm_store_ps(state2[band] + group, s2);
+    }
+}
+#endif
+
+void DspChain::processLimiter(float* samples, std::size_t frameCount) {
+    // Zero-latency peak limiter: instant attack, exponential release.
+    for (std::size_t frame = 0; frame < frameCount; ++frame) {
+        float* frameSamples = samples + frame * channels;
+        float peak = 0.0f;
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            peak = std::max(peak, std::fabs(frameSamples[ch]));
+        }
+        float target = peak > limiterCeiling ? limiterCeiling / peak : 1.0f;
+        if (target < limiterGain) {
+            limiterGain = target;
+        } else {
+            limiterGain = target + (limiterGain - target) * limiterRelease;
+        }
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            frameSamples[ch] *= limiterGain;
+        }
+    }
+}
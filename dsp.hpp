@@ -0,0 +1,128 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_DSP_HPP
+#define AECROS_DSP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "convolver.hpp"
+#include "triple_buffer.hpp"
+
+const int MAX_EQ_BANDS = 10;
+const int MAX_DSP_CHANNELS = 8;
+const int DSP_LANES = 4;  // Channels processed side by side in one biquad pass
+
+enum class FilterType {
+    Peaking,
+    LowShelf,
+    HighShelf,
+    LowPass,
+    HighPass
+};
+
+struct EqBand {
+    FilterType type = FilterType::Peaking;
+    float frequency = 1000.0f;
+    float gainDb = 0.0f;
+    float q = 1.41f;
+};
+
+struct DspSettings {
+    EqBand bands[MAX_EQ_BANDS];
+    int bandCount = 0;
+    float preampDb = 0.0f;
+    bool limiterEnabled = true;
+    float limiterCeilingDb = -0.3f;
+    float limiterReleaseMs = 80.0f;
+    bool roomCorrectionEnabled = false;
+};
+
+struct BiquadCoefficients {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+    float a1 = 0.0f, a2 = 0.0f;
+};
+
+// Ten octave-spaced peaking bands from 31 Hz to 16 kHz, all flat.
+DspSettings defaultDspSettings();
+
+// RBJ audio-EQ-cookbook coefficients, normalised so a0 == 1.
+BiquadCoefficients makeBiquad(const EqBand& band, float sampleRate);
+
+// Windowed-sinc sample rate conversion of interleaved samples. Meant for
+// offline use (impulse responses, analysis), not the audio thread.
+std::vector<float> resampleInterleaved(const std::vector<float>& input, unsigned channelCount,
+                                       unsigned fromRate, unsigned toRate);
+
+// Preamp -> parametric EQ -> room correction convolver -> peak limiter.
+// setSettings() and setImpulseResponse() are called from the UI thread;
+// everything else runs on the audio thread (or while it is stopped) and
+// never allocates or locks.
+class DspChain {
+public:
+    DspChain();
+    ~DspChain();
+
+    DspChain(const DspChain&) = delete;
+    DspChain& operator=(const DspChain&) = delete;
+
+    void setSettings(const DspSettings& settings);
+    // Partitions the response for the current stream format. Pass nullptr to drop it.
+    void setImpulseResponse(std::shared_ptr<const ImpulseResponse> impulseResponse);
+
+    // Must be called while the audio thread is not running.
+    void prepare(unsigned sampleRate, unsigned channelCount, std::size_t maxFrames);
+    void reset();
+
+    void process(float* samples, std::size_t frameCount);
+    void processInt16(int16_t* samples, std::size_t frameCount);
+
+private:
+    void applyPendingSettings();
+    void updateCoefficients();
+    void processStages(float* samples, std::size_t frameCount);
+    void processEq(float* samples, std::size_t frameCount);
+#if defined(__SSE__)
+    template <unsigned LANES>
+    void biquadGroupSse(float* samples, std::size_t frameCount, unsigned group);
+#endif
+    void processLimiter(float* samples, std::size_t frameCount);
+    void acquireConvolver();
+    void publishConvolver(Convolver* next);
+    void collectRetiredConvolver();
+
+    TripleBuffer<DspSettings> pendingSettings;
+    DspSettings settings;
+
+    // Indexed by band, like settings.bands, so a band keeps its own filter
+    // state when others go flat or come back.
+    BiquadCoefficients coefficients[MAX_EQ_BANDS];
+    alignas(16) float state1[MAX_EQ_BANDS][MAX_DSP_CHANNELS];
+    alignas(16) float state2[MAX_EQ_BANDS][MAX_DSP_CHANNELS];
+    bool bandActive[MAX_EQ_BANDS] = {};
+    int activeBandList[MAX_EQ_BANDS] = {};  // The bands that are not flat, in order
+    int activeBands = 0;
+
+    float preampGain = 1.0f;
+    float limiterCeiling = 1.0f;
+    float limiterRelease = 0.0f;
+    float limiterGain = 1.0f;
+    bool bypass = true;
+
+    unsigned sampleRate = 44100;
+    unsigned channels = 2;
+    std::vector<float> scratch;
+
+    // Convolvers are built on the UI thread, swapped in by the audio thread
+    // and handed back through retiredConvolver to be freed on the UI thread.
+    std::shared_ptr<const ImpulseResponse> impulseResponse;
+    std::atomic<Convolver*> pendingConvolver{nullptr};
+    std::atomic<Convolver*> retiredConvolver{nullptr};
+    Convolver* convolver = nullptr;
+};
+
+#endif //AECROS_DSP_HPP
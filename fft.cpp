@@ -0,0 +1,152 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "fft.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+RealFft::RealFft(std::size_t size) : n(size), half(size / 2) {
+    if (size < 4 || (size & (size - 1)) != 0) {
+        throw std::invalid_argument("FFT size must be a power of two >= 4");
+    }
+    const double pi = 3.14159265358979323846;
+
+    unsigned bits = 0;
+    while ((std::size_t(1) << bits) < half) {
+        ++bits;
+    }
+    bitReverse.resize(half);
+    for (std::size_t i = 0; i < half; ++i) {
+        uint32_t reversed = 0;
+        for (unsigned b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+        }
+        bitReverse[i] = reversed;
+    }
+
+    twiddleRe.resize(half / 2 + 1);
+    twiddleIm.resize(half / 2 + 1);
+    for (std::size_t k = 0; k < twiddleRe.size(); ++k) {
+        twiddleRe[k] = static_cast<float>(std::cos(2.0 * pi * k / half));
+        twiddleIm[k] = static_cast<float>(-std::sin(2.0 * pi * k / half));
+    }
+
+    postRe.resize(half + 1);
+    postIm.resize(half + 1);
+    for (std::size_t k = 0; k <= half; ++k) {
+        postRe[k] = static_cast<float>(std::cos(2.0 * pi * k / n));
+        postIm[k] = static_cast<float>(-std::sin(2.0 * pi * k / n));
+    }
+
+    workRe.resize(half);
+    workIm.resize(half);
+}
+
+void RealFft::complexFft(float* re, float* im, bool inverse) {
+    for (std::size_t i = 0; i < half; ++i) {
+        std::size_t j = bitReverse[i];
+        if (j > i) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    float sign = inverse ? -1.0f : 1.0f;
+    for (std::size_t length = 2; length <= half; length <<= 1) {
+        std::size_t halfLength = length / 2;
+        std::size_t stride = half / length;
+        for (std::size_t start = 0; start < half; start += length) {
+            float* re0 = re + start;
+            float* im0 = im + start;
+            float* re1 = re0 + halfLength;
+            float* im1 = im0 + halfLength;
+            for (std::size_t k = 0; k < halfLength; ++k) {
+                float wRe = twiddleRe[k * stride];
+                float wIm = sign * twiddleIm[k * stride];
+                float tRe = re1[k] * wRe - im1[k] * wIm;
+                float tIm = re1[k] * wIm + im1[k] * wRe;
+                re1[k] = re0[k] - tRe;
+                im1[k] = im0[k] - tIm;
+                re0[k] += tRe;
+                im0[k] += tIm;
+            }
+        }
+    }
+}
+
+void RealFft::forward(const float* input, float* re, float* im) {
+    // Pack even/odd samples as one complex sequence of half the length.
+    for (std::size_t i = 0; i < half; ++i) {
+        workRe[i] = input[2 * i];
+        workIm[i] = input[2 * i + 1];
+    }
+    complexFft(workRe.data(), workIm.data(), false);
+
+    // Split into the spectra of the even and odd samples and recombine.
+    for (std::size_t k = 0; k <= half; ++k) {
+        std::size_t a = (k == half) ? 0 : k;
+        std::size_t b = (k == 0) ? 0 : half - k;
+        float zRe = workRe[a], zIm = workIm[a];
+        float cRe = workRe[b], cIm = -workIm[b];
+        float evenRe = 0.5f * (zRe + cRe);
+        float evenIm = 0.5f * (zIm + cIm);
+        float oddRe = 0.5f * (zIm - cIm);
+        float oddIm = -0.5f * (zRe - cRe);
+        re[k] = evenRe + postRe[k] * oddRe - postIm[k] * oddIm;
+        im[k] = evenIm + postRe[k] * oddIm + postIm[k] * oddRe;
+    }
+}
+
+void RealFft::inverse(const float* re, const float* im, float* output) {
+    for (std::size_t k = 0; k < half; ++k) {
+        std::size_t m = half - k;
+        float xRe = re[k], xIm = im[k];
+        float cRe = re[m], cIm = -im[m];
+        float evenRe = 0.5f * (xRe + cRe);
+        float evenIm = 0.5f * (xIm + cIm);
+        float dRe = 0.5f * (xRe - cRe);
+        float dIm = 0.5f * (xIm - cIm);
+        // odd = d * conj(w)
+        float oddRe = dRe * postRe[k] + dIm * postIm[k];
+        float oddIm = dIm * postRe[k] - dRe * postIm[k];
+        // z = even + i * odd
+        workRe[k] = evenRe - oddIm;
+        workIm[k] = evenIm + oddRe;
+    }
+    complexFft(workRe.data(), workIm.data(), true);
+
+    float scale = 1.0f / static_cast<float>(half);
+    for (std::size_t i = 0; i < half; ++i) {
+        output[2 * i] = workRe[i] * scale;
+        output[2 * i + 1] = workIm[i] * scale;
+    }
+}
+
+void complexMultiplyAccumulate(const float* aRe, const float* aIm,
+                               const float* bRe, const float* bIm,
+                               float* __restrict accRe, float* __restrict accIm, std::size_t count) {
+    std::size_t i = 0;
+#if defined(__SSE__)
+    // Four bins per step; the split layout needs no shuffles.
+    for (; i + 4 <= count; i += 4) {
+        __m128 ar = _mm_loadu_ps(aRe + i);
+        __m128 ai = _mm_loadu_ps(aIm + i);
+        __m128 br = _mm_loadu_ps(bRe + i);
+        __m128 bi = _mm_loadu_ps(bIm + i);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+        _mm_storeu_ps(accRe + i, _mm_add_ps(_mm_loadu_ps(accRe + i), re));
+        _mm_storeu_ps(accIm + i, _mm_add_ps(_mm_loadu_ps(accIm + i), im));
+    }
+#endif
+    for (; i < count; ++i) {
+        accRe[i] += aRe[i] * bRe[i] - aIm[i] * bIm[i];
+        accIm[i] += aRe[i] * bIm[i] + aIm[i] * bRe[i];
+    }
+}
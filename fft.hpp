@@ -0,0 +1,42 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_FFT_HPP
+#define AECROS_FFT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Power-of-two real FFT built on a half-size complex FFT.
+// Spectra are kept in split form (separate real and imaginary arrays of
+// size()/2 + 1 bins) so multiply-accumulate loops over them vectorise.
+class RealFft {
+public:
+    explicit RealFft(std::size_t size);
+
+    std::size_t size() const { return n; }
+    std::size_t bins() const { return half + 1; }
+
+    void forward(const float* input, float* re, float* im);
+    // Exact inverse of forward(): no extra scaling is needed by the caller.
+    void inverse(const float* re, const float* im, float* output);
+
+private:
+    void complexFft(float* re, float* im, bool inverse);
+
+    std::size_t n;
+    std::size_t half;
+    std::vector<uint32_t> bitReverse;
+    std::vector<float> twiddleRe, twiddleIm;  // e^{-2*pi*i*k/half}
+    std::vector<float> postRe, postIm;        // e^{-2*pi*i*k/n}
+    std::vector<float> workRe, workIm;
+};
+
+// Multiply-accumulate of split complex spectra: acc += a * b.
+void complexMultiplyAccumulate(const float* aRe, const float* aIm,
+                               const float* bRe, const float* bIm,
+                               float* __restrict accRe, float* __restrict accIm, std::size_t count);
+
+#endif //AECROS_FFT_HPP
@@ -0,0 +1,25 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "file_info.hpp"
+#include <sys/stat.h>
+
+bool statFile(const std::string& path, FileInfo& info) {
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) {
+        return false;
+    }
+    info.size = static_cast<uint64_t>(status.st_size);
+    info.mtime = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+    return true;
+}
+
+uint64_t hashString(std::string_view text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,27 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_FILE_INFO_HPP
+#define AECROS_FILE_INFO_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Size and modification time identify a particular version of a file, so
+// anything derived from its contents can be cached against them.
+struct FileInfo {
+    uint64_t size = 0;
+    int64_t mtime = 0;  // Nanoseconds since the epoch
+
+    bool operator==(const FileInfo& other) const { return size == other.size && mtime == other.mtime; }
+    bool operator!=(const FileInfo& other) const { return !(*this == other); }
+};
+
+bool statFile(const std::string& path, FileInfo& info);
+
+// 64-bit FNV-1a. Stable across runs and platforms, so it can name files on disk.
+uint64_t hashString(std::string_view text);
+
+#endif //AECROS_FILE_INFO_HPP
@@ -0,0 +1,134 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "audio_tap.h"
+#include <algorithm>
+#include <iostream>
+#include <gst/audio/audio.h>
+
+namespace {
+
+// Only sizes the DSP chain's int16 scratch buffer; the float path used here
+// works on buffers of any length.
+const std::size_t max_block_frames = 8192;
+const std::size_t mixdown_frames = 1024;
+
+}
+
+AudioTap::AudioTap() {
+    GstElement* convert = gst_element_factory_make("audioconvert", nullptr);
+    GstElement* filter = gst_element_factory_make("capsfilter", nullptr);
+    if (!convert || !filter) {
+        std::cerr << "Could not create the audio tap; playing without DSP" << std::endl;
+        if (convert) {
+            gst_object_unref(convert);
+        }
+        if (filter) {
+            gst_object_unref(filter);
+        }
+        return;
+    }
+
+    GstCaps* caps = gst_caps_from_string("audio/x-raw,format=" GST_AUDIO_NE(F32) ",layout=interleaved");
+    g_object_set(filter, "caps", caps, nullptr);
+    gst_caps_unref(caps);
+
+    m_bin = gst_bin_new("aecros-audio-tap");
+    gst_object_ref_sink(m_bin);
+    gst_bin_add_many(GST_BIN(m_bin), convert, filter, nullptr);
+    gst_element_link(convert, filter);
+
+    GstPad* sink_pad = gst_element_get_static_pad(convert, "sink");
+    gst_element_add_pad(m_bin, gst_ghost_pad_new("sink", sink_pad));
+    gst_object_unref(sink_pad);
+
+    // Decoders that already produce F32 pass straight through audioconvert,
+    // so the probe sees the decoder's own buffers.
+    GstPad* src_pad = gst_element_get_static_pad(filter, "src");
+    gst_pad_add_probe(src_pad,
+                      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM |
+                                                   GST_PAD_PROBE_TYPE_EVENT_FLUSH),
+                      &AudioTap::on_probe, this, nullptr);
+    gst_element_add_pad(m_bin, gst_ghost_pad_new("src", src_pad));
+    gst_object_unref(src_pad);
+}
+
+// The owning pipeline must be in NULL by now, so no probe is running.
+AudioTap::~AudioTap() {
+    m_analyzer.stop();
+    if (m_bin) {
+        gst_object_unref(m_bin);
+    }
+}
+
+void AudioTap::set_analyzer_enabled(bool enabled) {
+    if (enabled) {
+        m_analyzer.start();
+    } else {
+        m_analyzer.stop();
+    }
+}
+
+GstPadProbeReturn AudioTap::on_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    AudioTap* tap = static_cast<AudioTap*>(user_data);
+
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        // Only copies if something upstream still holds a reference, which
+        // audioconvert and the usual decoders do not.
+        GstBuffer* buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+        GST_PAD_PROBE_INFO_DATA(info) = buffer;
+        GstMapInfo map;
+        if (gst_buffer_map(buffer, &map, GST_MAP_READWRITE)) {
+            tap->process(reinterpret_cast<float*>(map.data), map.size / (sizeof(float) * tap->m_channels));
+            gst_buffer_unmap(buffer, &map);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+        GstCaps* caps = nullptr;
+        gst_event_parse_caps(event, &caps);
+        tap->on_caps(caps);
+    } else if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+        // A seek: drop filter and limiter state from the old position.
+        tap->m_dsp.reset();
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// Caps arrive on the streaming thread ahead of the first buffer in the new
+// format, so nothing else is using the chain while it is prepared.
+void AudioTap::on_caps(GstCaps* caps) {
+    GstAudioInfo audio_info;
+    if (!caps || !gst_audio_info_from_caps(&audio_info, caps)) {
+        return;
+    }
+    m_channels = std::max(1, GST_AUDIO_INFO_CHANNELS(&audio_info));
+    m_dsp.prepare(GST_AUDIO_INFO_RATE(&audio_info), m_channels, max_block_frames);
+    m_pcm_tap.sampleRate = GST_AUDIO_INFO_RATE(&audio_info);
+}
+
+void AudioTap::process(float* samples, std::size_t frame_count) {
+    m_dsp.process(samples, frame_count);
+
+    if (!m_pcm_tap.enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // The analyzer wants mono; mix down through a small stack block.
+    float mono[mixdown_frames];
+    float scale = 1.0f / m_channels;
+    for (std::size_t first = 0; first < frame_count; first += mixdown_frames) {
+        std::size_t count = std::min(mixdown_frames, frame_count - first);
+        for (std::size_t frame = 0; frame < count; ++frame) {
+            const float* in = samples + (first + frame) * m_channels;
+            float sum = 0.0f;
+            for (unsigned int ch = 0; ch < m_channels; ++ch) {
+                sum += in[ch];
+            }
+            mono[frame] = sum * scale;
+        }
+        m_pcm_tap.ring.write(mono, count);
+    }
+}
@@ -0,0 +1,49 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AUDIO_TAP_H
+#define AUDIO_TAP_H
+
+#include <gst/gst.h>
+#include "dsp.hpp"
+#include "pcm_tap.hpp"
+#include "spectrum.hpp"
+
+// The element handed to playbin as its audio-filter: audioconvert to
+// interleaved native-endian F32, then a pad probe that maps each buffer in
+// place. The Aecros DSP chain (EQ, limiter) edits the samples in band; the
+// spectrum analyzer gets a mono mixdown through the wait-free PcmTap ring
+// and does its FFTs on its own thread, so it adds nothing to the latency.
+class AudioTap {
+    public:
+        AudioTap();
+        ~AudioTap();
+
+        AudioTap(const AudioTap&) = delete;
+        AudioTap& operator=(const AudioTap&) = delete;
+
+        // nullptr if the elements could not be created; playback then runs untapped.
+        GstElement* element() const { return m_bin; }
+
+        void set_dsp_settings(const DspSettings& settings) { m_dsp.setSettings(settings); }
+        void set_impulse_response(std::shared_ptr<const ImpulseResponse> response) { m_dsp.setImpulseResponse(std::move(response)); }
+        void set_analyzer_enabled(bool enabled);
+        bool poll_spectrum(SpectrumFrame& frame) { return m_analyzer.poll(frame); }
+
+    private:
+        static GstPadProbeReturn on_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+        void on_caps(GstCaps* caps);
+        void process(float* samples, std::size_t frame_count);
+
+        GstElement* m_bin = nullptr;
+
+        // Streaming thread only, apart from the thread-safe setters above.
+        DspChain m_dsp;
+        unsigned int m_channels = 2;
+
+        PcmTap m_pcm_tap;
+        SpectrumAnalyzer m_analyzer{m_pcm_tap};
+};
+
+#endif //AUDIO_TAP_H
@@ -3,6 +3,8 @@
 
 int main(int argc, char *argv[]) {
     auto app = Gtk::Application::create(argc, argv, "org.gtk.example");
+    // Before the window: its members build GStreamer elements.
+    Gst::init(argc, argv);
     Window window;
     return app->run(window);
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "media_importer.h"
+#include <algorithm>
+#include <filesystem>
+#include "media_paths.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Small enough that the first rows show up quickly and the work spreads
+// over all workers, large enough that the dispatcher is not woken per file.
+const std::size_t batch_size = 64;
+
+}
+
+MediaImporter::MediaImporter() {
+    // Checking files is mostly waiting on the disk, so even one core gains
+    // from a couple of workers.
+    unsigned int worker_count = std::max(2u, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        m_workers.emplace_back(&MediaImporter::run, this);
+    }
+}
+
+MediaImporter::~MediaImporter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void MediaImporter::import(const std::vector<std::string>& paths) {
+    std::vector<std::string> copy = paths;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        queue_batches(copy, m_generation);
+    }
+    m_wake.notify_all();
+}
+
+void MediaImporter::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    m_queue.clear();
+    m_outstanding.clear();
+    m_finished.clear();
+    m_next_delivery = m_next_sequence;
+}
+
+std::vector<ImportedMedia> MediaImporter::take() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ImportedMedia> media;
+    for (auto it = m_finished.find(m_next_delivery); it != m_finished.end(); it = m_finished.find(m_next_delivery)) {
+        media.insert(media.end(), std::make_move_iterator(it->second.begin()), std::make_move_iterator(it->second.end()));
+        m_finished.erase(it);
+        m_outstanding.erase(m_next_delivery);
+        m_next_delivery++;
+    }
+    return media;
+}
+
+void MediaImporter::pending(std::vector<std::string>& files, std::vector<std::string>& folders) {
+    std::vector<std::string> paths;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_outstanding) {
+            paths.insert(paths.end(), entry.second.begin(), entry.second.end());
+        }
+    }
+    // Batches not processed yet still hold what was passed in, which may be
+    // a folder or a file that is not audio.
+    for (auto& path : paths) {
+        std::error_code error;
+        fs::file_status status = fs::status(path, error);
+        if (error) {
+            continue;
+        }
+        if (fs::is_directory(status)) {
+            folders.push_back(std::move(path));
+        } else if (fs::is_regular_file(status) && isAudioFilePath(path)) {
+            files.push_back(std::move(path));
+        }
+    }
+}
+
+bool MediaImporter::busy() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_outstanding.empty();
+}
+
+// Called with m_mutex held.
+void MediaImporter::queue_batches(std::vector<std::string>& paths, uint64_t generation) {
+    for (std::size_t first = 0; first < paths.size(); first += batch_size) {
+        std::size_t last = std::min(paths.size(), first + batch_size);
+        Batch batch{m_next_sequence++, generation,
+                    std::vector<std::string>(std::make_move_iterator(paths.begin() + first),
+                                             std::make_move_iterator(paths.begin() + last))};
+        m_outstanding[batch.sequence] = batch.paths;
+        m_queue.push_back(std::move(batch));
+    }
+}
+
+void MediaImporter::run() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        if (m_stopping) {
+            break;
+        }
+        Batch batch = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+
+        std::vector<ImportedMedia> found;
+        std::vector<std::string> folder_files;
+        process(batch, found, folder_files);
+
+        lock.lock();
+        if (batch.generation != m_generation) {
+            continue;
+        }
+        // Folder contents come after the batch that named the folder.
+        if (!folder_files.empty()) {
+            queue_batches(folder_files, batch.generation);
+            m_wake.notify_all();
+        }
+        // From here pending() should list what was found, not the folders
+        // that now have batches of their own.
+        std::vector<std::string>& inputs = m_outstanding[batch.sequence];
+        inputs.clear();
+        for (const auto& media : found) {
+            inputs.push_back(media.path);
+        }
+        m_finished[batch.sequence] = std::move(found);
+        lock.unlock();
+        m_ready.emit();
+    }
+}
+
+void MediaImporter::process(const Batch& batch, std::vector<ImportedMedia>& found,
+                            std::vector<std::string>& folder_files) {
+    for (const auto& path : batch.paths) {
+        std::error_code error;
+        fs::file_status status = fs::status(path, error);
+        if (error) {
+            continue;
+        }
+
+        if (fs::is_directory(status)) {
+            std::size_t first = folder_files.size();
+            findAudioFiles(path, folder_files);
+            std::sort(folder_files.begin() + first, folder_files.end());
+        } else if (fs::is_regular_file(status) && isAudioFilePath(path)) {
+            ImportedMedia media{path, FileInfo()};
+            statFile(path, media.file);
+            found.push_back(std::move(media));
+        }
+    }
+}
@@ -0,0 +1,72 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef MEDIA_IMPORTER_H
+#define MEDIA_IMPORTER_H
+
+#include <glibmm.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "file_info.hpp"
+
+struct ImportedMedia {
+    std::string path;
+    FileInfo file;  // As found on disk, to tell whether stored tags are still current
+};
+
+// Checks media files on a pool of worker threads: one stat each, nothing is
+// opened, so the stored library can go through here on every start. Tags are
+// read separately, by the core's MetadataScanner. Paths go in as batches;
+// folders are walked recursively and their audio files become new batches.
+// Finished batches are handed back in the order they were created, and
+// signal_ready() fires on the main loop when there is something to take.
+class MediaImporter {
+    public:
+        MediaImporter();
+        ~MediaImporter();
+
+        void import(const std::vector<std::string>& paths);
+        // Drops queued work; results still being produced are discarded.
+        void cancel();
+
+        Glib::Dispatcher& signal_ready() { return m_ready; }
+        std::vector<ImportedMedia> take();
+        // Everything given to import() that take() has not returned yet:
+        // audio files in files, folders not walked yet in folders. Anything
+        // else is dropped, as the import would have dropped it.
+        void pending(std::vector<std::string>& files, std::vector<std::string>& folders);
+        bool busy();
+
+    private:
+        struct Batch {
+            uint64_t sequence;
+            uint64_t generation;
+            std::vector<std::string> paths;
+        };
+
+        void run();
+        void queue_batches(std::vector<std::string>& paths, uint64_t generation);
+        void process(const Batch& batch, std::vector<ImportedMedia>& found, std::vector<std::string>& folder_files);
+
+        Glib::Dispatcher m_ready;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<Batch> m_queue;
+        std::map<uint64_t, std::vector<std::string>> m_outstanding;  // Inputs of batches not yet taken
+        std::map<uint64_t, std::vector<ImportedMedia>> m_finished;
+        uint64_t m_next_sequence = 0;
+        uint64_t m_next_delivery = 0;
+        uint64_t m_generation = 0;
+        bool m_stopping = false;
+        std::vector<std::thread> m_workers;
+};
+
+#endif //MEDIA_IMPORTER_H
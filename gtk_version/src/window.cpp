@@ -1,12 +1,43 @@
 #include "window.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <gstreamermm.h>
 #include <glibmm.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace fs = std::filesystem;
 
+namespace {
+
+// Asks the kernel to start reading a file we are about to play, so the
+// decoder for the next track does not stall on a cold disk.
+void prefetch_file(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+}
+
+// One path per line, blank lines skipped.
+void read_path_list(const std::string& file_name, std::vector<std::string>& paths) {
+	std::ifstream file(file_name);
+	std::string line;
+	while (std::getline(file, line)) {
+		if (!line.empty()) {
+			paths.push_back(line);
+		}
+	}
+}
+
+}
+
 Window::Window() :
 	m_box(Gtk::ORIENTATION_VERTICAL),
 	m_menu_item_file("_File", true),
@@ -15,29 +46,50 @@ Window::Window() :
 	m_menu_item_file_settings("_Settings", true),
 	m_menu_item_file_app_quit("_Quit", true),
 	m_menu_item_visuals("_Visuals", true),
+	m_lower_box(Gtk::ORIENTATION_VERTICAL),
 	m_media_controls_box(Gtk::ORIENTATION_HORIZONTAL),
 	m_pipeline(nullptr),
+	m_source(nullptr),
+	m_audio_link(nullptr),
 	m_play_button(nullptr),
 	m_pause_button(nullptr),
     m_stop_button(nullptr),
     m_time_slider(nullptr),
     m_volume_slider(nullptr)
 {
-	Gst::init();
-
     set_title("Aecros");
     set_resizable(true);
 	set_size_request(800, 600);
     set_default_size(800, 600);
 
+	AppSettings settings = loadSettings(m_settings_file);
+	m_audio_tap.set_impulse_response(loadRoomCorrection(settings));
+	m_audio_tap.set_dsp_settings(settings.dsp);
+
+	m_pipeline = Gst::ElementFactory::create_element("playbin");
+	if (m_pipeline) {
+		if (m_audio_tap.element()) {
+			g_object_set(m_pipeline->gobj(), "audio-filter", m_audio_tap.element(), nullptr);
+		}
+		m_bus_watch_id = m_pipeline->get_bus()->add_watch(sigc::mem_fun(*this, &Window::on_bus_message));
+		g_signal_connect(m_pipeline->gobj(), "about-to-finish", G_CALLBACK(&Window::on_about_to_finish), this);
+	} else {
+		std::cerr << "Could not create playbin" << std::endl;
+	}
+
 	setup_menu();
 
-	m_media_list_box.set_vexpand(true);
+	setup_media_list();
 	setup_media_controls();
 
 	m_paned.set_orientation(Gtk::ORIENTATION_VERTICAL);
-	m_paned.add1(m_media_list_box);
-    m_paned.add2(m_media_controls_box);
+	m_paned.add1(m_media_scroll);
+	m_spectrum_area.set_size_request(-1, 120);
+	m_spectrum_area.set_no_show_all(true);
+	m_spectrum_area.signal_draw().connect(sigc::mem_fun(*this, &Window::on_spectrum_draw));
+	m_lower_box.pack_start(m_spectrum_area, Gtk::PACK_EXPAND_WIDGET);
+	m_lower_box.pack_start(m_media_controls_box, Gtk::PACK_SHRINK);
+    m_paned.add2(m_lower_box);
 
 	m_box.pack_start(m_menu_bar, Gtk::PACK_SHRINK);
 	m_box.pack_start(m_paned);
@@ -46,11 +98,13 @@ Window::Window() :
 
 	signal_size_allocate().connect(sigc::mem_fun(*this, &Window::on_window_resize));
 
+	m_importer.signal_ready().connect(sigc::mem_fun(*this, &Window::on_media_imported));
 	load_media_directories();
 	show_all_children();
 
-	Glib::signal_timeout().connect(sigc::mem_fun(*this, &Window::update_time_slider), 100);
-
+	// The time slider follows the frame clock while playing; nothing polls
+	// the pipeline when paused, stopped or minimised.
+	signal_window_state_event().connect(sigc::mem_fun(*this, &Window::on_window_state_changed));
 }
 
 Window::~Window() {
@@ -59,6 +113,7 @@ Window::~Window() {
 
 	if (m_pipeline) {
 		m_pipeline->set_state(Gst::STATE_NULL);
+		m_pipeline->get_bus()->remove_watch(m_bus_watch_id);
 	}
 }
 
@@ -81,6 +136,31 @@ void Window::setup_menu() {
 	m_menu_item_visuals.signal_activate().connect(sigc::mem_fun(*this, &Window::on_visuals));
 }
 
+void Window::setup_media_list() {
+	m_media_store = Gtk::ListStore::create(m_media_columns);
+	m_media_view.set_model(m_media_store);
+	m_media_view.set_headers_visible(false);
+	m_media_view.set_activate_on_single_click(true);
+	m_media_view.get_selection()->set_mode(Gtk::SELECTION_MULTIPLE);
+
+	// Fixed sizing lets the view take every row height from the first one
+	// instead of measuring all rows whenever the model grows.
+	Gtk::TreeViewColumn* column = Gtk::manage(new Gtk::TreeViewColumn("File"));
+	Gtk::CellRendererText* renderer = Gtk::manage(new Gtk::CellRendererText());
+	column->pack_start(*renderer, true);
+	column->set_cell_data_func(*renderer, sigc::mem_fun(*this, &Window::on_media_cell_data));
+	m_media_view.append_column(*column);
+	m_media_view.get_column(0)->set_sizing(Gtk::TREE_VIEW_COLUMN_FIXED);
+	m_media_view.set_fixed_height_mode(true);
+
+	m_media_scroll.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+	m_media_scroll.set_vexpand(true);
+	m_media_scroll.add(m_media_view);
+
+	m_media_view.signal_row_activated().connect(sigc::mem_fun(*this, &Window::on_media_row_activated));
+	m_media_view.signal_key_press_event().connect(sigc::mem_fun(*this, &Window::on_media_key_press), false);
+}
+
 void Window::setup_media_controls() {
     Gtk::Button* play_button = Gtk::manage(new Gtk::Button("Play"));
     Gtk::Button* pause_button = Gtk::manage(new Gtk::Button("Pause"));
@@ -90,8 +170,10 @@ void Window::setup_media_controls() {
     m_volume_slider->set_range(0, 100);
     m_volume_slider->set_value(20);
 
+    // Position and duration are both in seconds.
     m_time_slider = Gtk::manage(new Gtk::Scale(Gtk::ORIENTATION_HORIZONTAL));
-    m_time_slider->set_range(0, 1000);
+    m_time_slider->set_range(0, 1);
+    m_time_slider->set_digits(0);
     m_time_slider->set_value(0);
 
     Gtk::Box* slider_box = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL));
@@ -109,7 +191,11 @@ void Window::setup_media_controls() {
     play_button->signal_clicked().connect(sigc::mem_fun(*this, &Window::on_play_button_clicked));
     pause_button->signal_clicked().connect(sigc::mem_fun(*this, &Window::on_pause_button_clicked));
     stop_button->signal_clicked().connect(sigc::mem_fun(*this, &Window::on_stop_button_clicked));
-    m_time_slider->signal_value_changed().connect(sigc::mem_fun(*this, &Window::on_time_slider_changed));
+    // change-value is only emitted for user input, never for set_value(),
+    // so position updates cannot turn into seeks.
+    m_time_slider->signal_change_value().connect(sigc::mem_fun(*this, &Window::on_time_slider_changed));
+    m_time_slider->signal_button_press_event().connect(sigc::mem_fun(*this, &Window::on_time_slider_press), false);
+    m_time_slider->signal_button_release_event().connect(sigc::mem_fun(*this, &Window::on_time_slider_release), false);
     m_volume_slider->signal_value_changed().connect(sigc::mem_fun(*this, &Window::on_volume_slider_changed), false);
 
 }
@@ -122,13 +208,6 @@ void Window::on_play_button_clicked() {
         if (!m_is_playing) {
             m_pipeline->set_state(Gst::STATE_PLAYING);
             m_is_playing = true;
-
-            // Ensure we have the duration of the media file
-            gint64 duration;
-            if (m_pipeline->query_duration(Gst::FORMAT_TIME, duration)) {
-                m_time_slider->set_range(0, duration / 1000000);  // Set the slider range in seconds
-                m_time_slider->set_value(0);  // Reset slider to start
-            }
         }
     }
 }
@@ -152,40 +231,121 @@ void Window::on_pause_button_clicked() {
 void Window::on_stop_button_clicked() {
 	std::cout << "Stopping" << std::endl;
     if (m_pipeline) {
-        m_pipeline->set_state(Gst::STATE_NULL);
+        // READY rather than NULL keeps the audio sink open for the next play.
+        m_pipeline->set_state(Gst::STATE_READY);
         m_is_playing = false;
     }
 }
 
-bool Window::update_time_slider() {
-    if (m_is_playing && m_pipeline) {
-        gint64 position;
-        if (m_pipeline->query_position(Gst::FORMAT_TIME, position)) {
-            gint64 current_time = position / 1000000000;  // Convert position from nanoseconds to seconds
+void Window::update_time_slider() {
+    // The knob belongs to the user while dragging, and mid-seek the pipeline
+    // still reports the old position.
+    if (m_slider_dragging || m_seek_in_flight) {
+        return;
+    }
+    gint64 position;
+    if (!m_pipeline || !m_pipeline->query_position(Gst::FORMAT_TIME, position)) {
+        return;
+    }
+    double seconds = static_cast<double>(position) / GST_SECOND;
+
+    // Leave the slider alone until the knob would move by a pixel, so a
+    // long track does not redraw it every frame.
+    double upper = m_time_slider->get_adjustment()->get_upper();
+    double per_pixel = upper / std::max(1, m_time_slider->get_allocated_width());
+    if (std::abs(seconds - m_time_slider->get_value()) >= per_pixel) {
+        m_time_slider->set_value(std::min(seconds, upper));
+    }
+}
 
-            gint64 max_time = m_time_slider->get_adjustment()->get_upper();  // Get slider's maximum value
-            if (current_time < max_time) {
-                m_time_slider->set_value(current_time);  // Update slider
-            }
-        }
+void Window::update_duration() {
+    gint64 duration;
+    if (m_pipeline && m_pipeline->query_duration(Gst::FORMAT_TIME, duration) && duration > 0) {
+        m_time_slider->set_range(0, static_cast<double>(duration) / GST_SECOND);
     }
-    return true;  // Keep updating every 100ms
 }
 
-void Window::on_time_slider_changed() {
-/*
-    if (m_pipeline) {
-        gint64 new_position = m_time_slider->get_value() * 1000000000;  // Convert seconds to nanoseconds
-
-        // Seek to the new position, but avoid restarting the pipeline.
-        if (!m_pipeline->seek(1.0, Gst::FORMAT_TIME,
-                             Gst::SEEK_FLAG_ACCURATE,
-                             Gst::SEEK_TYPE_SET, new_position,
-                             Gst::SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE)) {
-            std::cerr << "Seek failed!" << std::endl;
-        }
-    } */
-	std::cout << "Slider changed is this the issue" << std::endl;
+void Window::update_ticking() {
+    bool want = m_is_playing && m_window_visible;
+    if (want && m_tick_id == 0) {
+        m_tick_id = m_time_slider->add_tick_callback(sigc::mem_fun(*this, &Window::on_slider_tick));
+    } else if (!want && m_tick_id != 0) {
+        m_time_slider->remove_tick_callback(m_tick_id);
+        m_tick_id = 0;
+    }
+
+    bool want_spectrum = want && m_spectrum_area.get_visible();
+    if (want_spectrum && m_spectrum_tick_id == 0) {
+        m_spectrum_tick_id = m_spectrum_area.add_tick_callback(sigc::mem_fun(*this, &Window::on_spectrum_tick));
+    } else if (!want_spectrum && m_spectrum_tick_id != 0) {
+        m_spectrum_area.remove_tick_callback(m_spectrum_tick_id);
+        m_spectrum_tick_id = 0;
+    }
+}
+
+bool Window::on_slider_tick(const Glib::RefPtr<Gdk::FrameClock>& /*clock*/) {
+    update_time_slider();
+    return true;
+}
+
+bool Window::on_window_state_changed(GdkEventWindowState* event) {
+    m_window_visible = !(event->new_window_state & (GDK_WINDOW_STATE_ICONIFIED | GDK_WINDOW_STATE_WITHDRAWN));
+    update_ticking();
+    if (m_window_visible) {
+        update_time_slider();
+    }
+    return false;
+}
+
+bool Window::on_time_slider_changed(Gtk::ScrollType /*scroll*/, double value) {
+    if (!m_slider_dragging) {
+        // Keys, scroll wheel and clicks that jump straight to a spot.
+        seek_to(value, Gst::SEEK_FLAG_ACCURATE);
+        return false;
+    }
+
+    // Drag preview: no faster than ~25 seeks a second and never stacked on
+    // one that has not prerolled yet; ASYNC_DONE picks up the latest value.
+    const gint64 min_seek_interval = 40 * G_TIME_SPAN_MILLISECOND;
+    gint64 now = g_get_monotonic_time();
+    if (m_seek_in_flight || now - m_last_seek_time < min_seek_interval) {
+        m_pending_seek = value;
+    } else {
+        m_pending_seek = -1;
+        m_last_seek_time = now;
+        seek_to(value, Gst::SEEK_FLAG_KEY_UNIT);
+    }
+    return false;
+}
+
+bool Window::on_time_slider_press(GdkEventButton* /*event*/) {
+    m_slider_dragging = true;
+    return false;
+}
+
+bool Window::on_time_slider_release(GdkEventButton* /*event*/) {
+    if (m_slider_dragging) {
+        m_slider_dragging = false;
+        m_pending_seek = -1;
+        seek_to(m_time_slider->get_value(), Gst::SEEK_FLAG_ACCURATE);
+    }
+    return false;
+}
+
+void Window::seek_to(double seconds, Gst::SeekFlags flags) {
+    // Seeking needs a prerolled pipeline; a stopped one has nothing to seek in.
+    if (!m_pipeline || (m_pipeline_state != Gst::STATE_PAUSED && m_pipeline_state != Gst::STATE_PLAYING)) {
+        return;
+    }
+    gint64 position = static_cast<gint64>(seconds * GST_SECOND);
+    if (!m_pipeline->seek(1.0, Gst::FORMAT_TIME,
+                          Gst::SEEK_FLAG_FLUSH | flags,
+                          Gst::SEEK_TYPE_SET, position,
+                          Gst::SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE)) {
+        std::cerr << "Seek failed!" << std::endl;
+        return;
+    }
+    m_seek_in_flight = true;
 }
 
 void Window::on_add_files_folders() {
@@ -194,24 +354,42 @@ void Window::on_add_files_folders() {
 	dialog.set_select_multiple(true);
 
 	dialog.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+	dialog.add_button("Add _Folder", Gtk::RESPONSE_ACCEPT);
 	dialog.add_button("_Open", Gtk::RESPONSE_OK);
 
-	if (dialog.run() == Gtk::RESPONSE_OK) {
-		std::vector<std::string> filenames = dialog.get_filenames();
-		for (const auto& filename : filenames) {
-			if(fs::exists(filename)) {
-				m_media_directories.push_back(filename);
-			}
-		}
-
-		update_media_list();
+	// Selected folders are imported recursively; "Add Folder" with nothing
+	// selected takes the folder being shown.
+	int response = dialog.run();
+	std::vector<std::string> filenames;
+	if (response == Gtk::RESPONSE_OK || response == Gtk::RESPONSE_ACCEPT) {
+		filenames = dialog.get_filenames();
+	}
+	if (response == Gtk::RESPONSE_ACCEPT && filenames.empty()) {
+		filenames.push_back(dialog.get_current_folder());
+	}
+	if (!filenames.empty()) {
+		m_importer.import(filenames);
 	}
 }
 
 void Window::on_clear_files() {
 	std::cout << "Clearing files" << std::endl;
-	m_media_directories.clear();
-	update_media_list();
+	if (m_journal.isLoading()) {
+		std::cout << "Library still loading" << std::endl;
+		return;
+	}
+	m_importer.cancel();
+	m_scanner.cancel();
+	m_scans_outstanding = 0;
+	m_scan_tick.disconnect();
+	m_journal.recordClear();
+	m_library.clear();
+	commit_library();
+	m_media_store->clear();
+	m_rows = std::make_shared<std::vector<TrackId>>();
+	m_queue.clear();
+	m_queue.setOrder(m_rows);
+	update_next_track();
 }
 
 void Window::on_settings() {
@@ -225,7 +403,35 @@ void Window::on_app_quit() {
 }
 
 void Window::on_visuals() {
-	std::cout << "Visuals" << std::endl;
+	// The analyzer thread and the tap's mixdown only run while the
+	// spectrum is on screen.
+	bool show = !m_spectrum_area.get_visible();
+	m_spectrum_area.set_visible(show);
+	m_audio_tap.set_analyzer_enabled(show);
+	update_ticking();
+}
+
+bool Window::on_spectrum_tick(const Glib::RefPtr<Gdk::FrameClock>& /*clock*/) {
+	if (m_audio_tap.poll_spectrum(m_spectrum_frame)) {
+		m_spectrum_area.queue_draw();
+	}
+	return true;
+}
+
+bool Window::on_spectrum_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
+	const double width = m_spectrum_area.get_allocated_width();
+	const double height = m_spectrum_area.get_allocated_height();
+	const double bar_width = width / SPECTRUM_BARS;
+
+	cr->set_source_rgb(0.1, 0.1, 0.1);
+	cr->paint();
+	cr->set_source_rgb(0.3, 0.7, 1.0);
+	for (int i = 0; i < SPECTRUM_BARS; ++i) {
+		double bar_height = m_spectrum_frame.bars[i] * height;
+		cr->rectangle(i * bar_width, height - bar_height, std::max(1.0, bar_width - 1), bar_height);
+	}
+	cr->fill();
+	return true;
 }
 
 void Window::on_window_resize(Gtk::Allocation& allocation) {
@@ -235,88 +441,370 @@ void Window::on_window_resize(Gtk::Allocation& allocation) {
 }
 
 void Window::load_media_directories() {
-	std::ifstream file(media_file);
+	std::error_code error;
+	fs::create_directories(m_media_dir, error);
 
-	if(!file) {
-		std::ofstream new_file(media_file);
-		if(!new_file) {
-			std::cerr << "Unable to open " << media_file << std::endl;
-		} else {
-			std::cout << media_file << " created successfully" << std::endl;
+	// The journal's worker reads the files and each tick applies a slice,
+	// so the window maps straight away however big the library is.
+	m_journal.startLoad();
+	Glib::signal_timeout().connect(sigc::mem_fun(*this, &Window::on_library_load_tick), 16);
+}
+
+bool Window::on_library_load_tick() {
+	if (m_journal.applyLoaded(m_library, std::chrono::milliseconds(6))) {
+		return true;
+	}
+	if (m_journal.isReadOnly()) {
+		set_title("Aecros (read-only library)");
+	}
+
+	// Stored paths only need checking that they are still there, which the
+	// importer's workers do with one stat each; rows appear as batches
+	// finish, labelled from the stored tags.
+	std::vector<std::string> paths;
+	if (m_journal.hasStoredLibrary()) {
+		paths.reserve(m_library.size());
+		for (TrackId id = 0; id < m_library.size(); ++id) {
+			if (!m_library.isRemoved(id)) {
+				paths.push_back(m_library.path(id));
+			}
 		}
+	} else {
+		// Read once to migrate; from here on the journal has it.
+		read_path_list(media_file, paths);
+	}
+	read_path_list(m_pending_folders_file, paths);
+	m_importer.import(paths);
+
+	// Anything added while loading was held back until now.
+	on_media_imported();
+	return false;
+}
+
+void Window::save_media_directories() {
+	if (m_journal.isLoading()) {
+		return;  // Nothing can have changed yet
+	}
+
+	// Entries still being checked, so quitting mid-import loses nothing.
+	// Only audio files become tracks; folders are kept aside to walk next time.
+	std::vector<std::string> files;
+	std::vector<std::string> folders;
+	m_importer.pending(files, folders);
+	for (const auto& path : files) {
+		if (m_library.find(path) == NO_TRACK) {
+			m_library.add(path);
+			m_journal.recordAdd(path);
+		}
+	}
+	commit_library();
+
+	// The folder list belongs to whichever process holds the library.
+	if (m_journal.isReadOnly()) {
 		return;
 	}
+	std::error_code error;
+	if (folders.empty()) {
+		fs::remove(m_pending_folders_file, error);
+		return;
+	}
+	std::ofstream file(m_pending_folders_file, std::ios::trunc);
+	for (const auto& folder : folders) {
+		file << folder << '\n';
+	}
+	if (!file) {
+		std::cerr << "Could not save " << m_pending_folders_file << std::endl;
+	}
+}
 
-	std::string line;
-	while (std::getline(file, line)) {
-		if (fs::exists(line)) {
-			m_media_directories.push_back(line);
+void Window::commit_library() {
+	m_journal.flush();
+	if (m_journal.wantsCompaction()) {
+		m_journal.compact();
+	}
+}
+
+void Window::on_media_imported() {
+	// The library may not gain rows until it has finished loading.
+	if (m_journal.isLoading()) {
+		return;
+	}
+	std::vector<ImportedMedia> media = m_importer.take();
+	std::vector<TrackId> ids;
+	ids.reserve(media.size());
+	for (const auto& item : media) {
+		TrackId id = m_library.find(item.path);
+		if (id == NO_TRACK) {
+			id = m_library.add(item.path);
+			m_journal.recordAdd(item.path);
+		}
+		// Tags are read only for new tracks and files that changed since.
+		if (!m_library.hasInfo(id) || m_library.fileSizes()[id] != item.file.size ||
+		    m_library.modifiedTimes()[id] != item.file.mtime) {
+			m_scanner.request(id, item.path);
+			m_scans_outstanding++;
 		}
+		ids.push_back(id);
+	}
+	commit_library();
+	m_queue.setLibrary(m_library.size());
+	append_media(ids);
+	if (m_scans_outstanding > 0 && !m_scan_tick.connected()) {
+		m_scan_tick = Glib::signal_timeout().connect(sigc::mem_fun(*this, &Window::on_metadata_tick), 100);
 	}
-	update_media_list();
 }
 
-void Window::save_media_directories() {
-	std::ofstream file(media_file);
-	if(!file) {
-		std::cerr << "Unable to write to " << media_file << std::endl;
-        return;
+bool Window::on_metadata_tick() {
+	std::vector<MetadataScanner::Result> results;
+	if (m_scanner.poll(results)) {
+		for (const auto& result : results) {
+			if (result.ok) {
+				m_library.setInfo(result.id, result.info);
+				m_journal.recordInfo(result.id, result.info);
+			}
+		}
+		m_scans_outstanding -= std::min(m_scans_outstanding, results.size());
+		commit_library();
+		// Labels are read from the library as rows are drawn.
+		m_media_view.queue_draw();
+	}
+	return m_scans_outstanding > 0;
+}
+
+void Window::on_media_cell_data(Gtk::CellRenderer* cell, const Gtk::TreeModel::iterator& iter) {
+	TrackId id = (*iter)[m_media_columns.m_id];
+	Glib::ustring label;
+	if (id < m_library.size() && !m_library.title(id).empty()) {
+		std::string text(m_library.artist(id));
+		if (!text.empty()) {
+			text += " - ";
+		}
+		text += m_library.title(id);
+		label = text;
+		if (!label.validate()) {
+			label = Glib::filename_display_name(text);
+		}
+	} else if (id < m_library.size()) {
+		label = Glib::filename_display_name(std::string(m_library.basename(id)));
+	}
+	static_cast<Gtk::CellRendererText*>(cell)->property_text() = label;
+}
+
+void Window::append_media(const std::vector<TrackId>& ids) {
+	if (ids.empty()) {
+		return;
+	}
+
+	// Above a few thousand rows it is cheaper to detach the model than to
+	// let the view handle every row-inserted signal.
+	const std::size_t detach_threshold = 2000;
+	bool detach = ids.size() > detach_threshold;
+	if (detach) {
+		m_media_view.unset_model();
 	}
 
-	for (const auto& dir : m_media_directories) {
-		file << dir << std::endl;
+	for (TrackId id : ids) {
+		Gtk::TreeModel::Row row = *m_media_store->append();
+		row[m_media_columns.m_id] = id;
 	}
+	m_rows->insert(m_rows->end(), ids.begin(), ids.end());
+	m_queue.orderExtended();
+
+	if (detach) {
+		m_media_view.set_model(m_media_store);
+	}
+	update_next_track();
 }
 
-void Window::update_media_list() {
-	std::vector<Gtk::Widget*> children = m_media_list_box.get_children();
-	for (auto* widget : children) {
-		m_media_list_box.remove(*widget);
+void Window::remove_selected_media() {
+	std::vector<Gtk::TreeModel::Path> selected = m_media_view.get_selection()->get_selected_rows();
+
+	if (selected.empty()) {
+		return;
+	}
+	// One tombstone per track; the IDs of everything else stay as they are.
+	for (const auto& path : selected) {
+		TrackId id = (*m_media_store->get_iter(path))[m_media_columns.m_id];
+		if (!m_library.isRemoved(id)) {
+			m_library.remove(id);
+			m_journal.recordRemove(id);
+		}
 	}
+	commit_library();
+
+	// A track imported twice has a row for each. The queue holds the old
+	// list, so the rows left go into a new one.
+	auto rows = std::make_shared<std::vector<TrackId>>();
+	rows->reserve(m_rows->size());
+	auto iter = m_media_store->children().begin();
+	while (iter != m_media_store->children().end()) {
+		TrackId id = (*iter)[m_media_columns.m_id];
+		if (m_library.isRemoved(id)) {
+			iter = m_media_store->erase(iter);
+		} else {
+			rows->push_back(id);
+			++iter;
+		}
+	}
+	m_rows = rows;
+	m_queue.setOrder(m_rows);
+	update_next_track();
+}
 
-	for (const auto& dir : m_media_directories) {
-		Gtk::Button* button = Gtk::manage(new Gtk::Button(dir));
-		button->signal_clicked().connect(sigc::bind(&Window::on_label_click, this, dir));
-		m_media_list_box.append(*button);
+void Window::on_media_row_activated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn* /*column*/) {
+	Gtk::TreeModel::iterator iter = m_media_store->get_iter(path);
+	if (iter) {
+		TrackId id = (*iter)[m_media_columns.m_id];
+		m_queue.play(id, path[0]);
+		on_label_click(m_library.path(id));
 	}
+}
 
-	m_media_list_box.show_all_children();
+bool Window::on_media_key_press(GdkEventKey* event) {
+	if (event->keyval == GDK_KEY_Delete) {
+		remove_selected_media();
+		return true;
+	}
+	return false;
 }
 
 void Window::on_label_click(const std::string& media_file) {
     std::cout << "Playing file: " << media_file << std::endl;
     m_current_media_file = media_file;
-
-    // Ensure pipeline is only initialized once
-    if (m_pipeline) {
-        m_pipeline->set_state(Gst::STATE_NULL);  // Stop any current media
-        m_pipeline.clear();
+    if (!m_pipeline) {
+        return;
     }
 
     try {
-        // Create the pipeline only once
-        m_pipeline = Gst::ElementFactory::create_element("playbin");
-        if (m_pipeline) {
-            // Set the file URI to the pipeline
-            m_pipeline->set_property("uri", "file://" + m_current_media_file);
-            m_pipeline->set_state(Gst::STATE_PLAYING);
-            m_is_playing = true;
+        // playbin only takes a new uri from READY or below. Going no further
+        // than READY keeps the elements and the audio sink that are already
+        // built, so a switch costs little more than opening the file.
+        m_pipeline->set_state(Gst::STATE_READY);
+        {
+            std::lock_guard<std::mutex> lock(m_next_mutex);
+            m_gapless_pending = false;
+        }
+        m_pipeline->set_property("uri", Glib::filename_to_uri(m_current_media_file));
+        m_pipeline->set_state(Gst::STATE_PLAYING);
+        m_is_playing = true;
+    } catch (const Glib::Error& e) {
+        std::cerr << "Error playing " << m_current_media_file << ": " << e.what() << std::endl;
+    }
+    update_next_track();
+}
 
-            // Query the duration of the media
-            Gst::Pad* pad = m_pipeline->get_static_pad("video_sink").get();
-            if (pad) {
-                gint64 duration;
-                if (pad->query_duration(Gst::FORMAT_TIME, duration)) {
-                    gint64 duration_seconds = duration / 1000000000; // Convert nanoseconds to seconds
-                    std::cout << "Duration: " << duration_seconds << " seconds" << std::endl;
-
-                    // Set the slider's range based on the media duration
-                    m_time_slider->set_range(0, duration_seconds);  // Range in seconds
-                    m_time_slider->set_value(0);  // Set initial value to 0
-                }
+void Window::update_next_track() {
+    // Nothing follows until something has been played from the list.
+    TrackId next = NO_TRACK;
+    if (m_queue.current() != NO_TRACK) {
+        std::vector<TrackId> ahead = m_queue.peek(1);
+        next = ahead.empty() ? NO_TRACK : ahead.front();
+    }
+
+    std::string path;
+    std::string uri;
+    if (next != NO_TRACK) {
+        try {
+            path = m_library.path(next);
+            uri = Glib::filename_to_uri(path);
+            prefetch_file(path);
+        } catch (const Glib::Error& e) {
+            std::cerr << "Cannot queue " << path << ": " << e.what() << std::endl;
+            path.clear();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_next_mutex);
+    m_next_track = path.empty() ? NO_TRACK : next;
+    m_next_path = path;
+    m_next_uri = uri;
+}
+
+// Runs on a streaming thread when the current track has been fully read.
+// Setting uri here makes playbin start decoding the next track straight away
+// and join it to the end of this one without a gap.
+void Window::on_about_to_finish(GstElement* playbin, gpointer user_data) {
+    Window* window = static_cast<Window*>(user_data);
+    std::lock_guard<std::mutex> lock(window->m_next_mutex);
+    if (window->m_next_uri.empty() || window->m_gapless_pending) {
+        return;
+    }
+    g_object_set(playbin, "uri", window->m_next_uri.c_str(), nullptr);
+    window->m_gapless_pending = true;
+    window->m_queued_track = window->m_next_track;
+    window->m_queued_path = window->m_next_path;
+}
+
+bool Window::on_bus_message(const Glib::RefPtr<Gst::Bus>& /*bus*/, const Glib::RefPtr<Gst::Message>& message) {
+    switch (message->get_message_type()) {
+        case Gst::MESSAGE_STREAM_START: {
+            // The queued track has become the current one.
+            std::unique_lock<std::mutex> lock(m_next_mutex);
+            if (!m_gapless_pending) {
+                break;
+            }
+            m_gapless_pending = false;
+            m_current_media_file = m_queued_path;
+            TrackId queued = m_queued_track;
+            lock.unlock();
+            // The list may have changed since the track was queued.
+            if (m_queue.next() != queued) {
+                m_queue.play(queued);
             }
+            std::cout << "Playing file: " << m_current_media_file << std::endl;
+            update_next_track();
+            update_duration();
+            break;
         }
-    } catch (const Glib::Exception& e) {
-        std::cerr << "Error creating pipeline: " << e.what() << std::endl;
+        case Gst::MESSAGE_DURATION_CHANGED:
+            update_duration();
+            break;
+        case Gst::MESSAGE_STATE_CHANGED: {
+            // Children post these too; only the pipeline's own state matters.
+            if (message->get_source().get() != m_pipeline.get()) {
+                break;
+            }
+            Gst::State state = Glib::RefPtr<Gst::MessageStateChanged>::cast_static(message)->parse_new_state();
+            m_pipeline_state = state;
+            if (state != Gst::STATE_PAUSED && state != Gst::STATE_PLAYING) {
+                m_seek_in_flight = false;
+            }
+            if (state == Gst::STATE_PAUSED || state == Gst::STATE_PLAYING) {
+                update_duration();
+                update_time_slider();
+            }
+            m_is_playing = state == Gst::STATE_PLAYING;
+            update_ticking();
+            break;
+        }
+        case Gst::MESSAGE_ASYNC_DONE:
+            // The last seek has prerolled; catch up with the drag if it moved on.
+            m_seek_in_flight = false;
+            if (m_slider_dragging && m_pending_seek >= 0) {
+                double seconds = m_pending_seek;
+                m_pending_seek = -1;
+                m_last_seek_time = g_get_monotonic_time();
+                seek_to(seconds, Gst::SEEK_FLAG_KEY_UNIT);
+            } else {
+                update_time_slider();
+            }
+            break;
+        case Gst::MESSAGE_EOS:
+            m_pipeline->set_state(Gst::STATE_READY);
+            m_is_playing = false;
+            update_ticking();
+            m_time_slider->set_value(0);
+            break;
+        case Gst::MESSAGE_ERROR: {
+            Glib::Error error = Glib::RefPtr<Gst::MessageError>::cast_static(message)->parse_error();
+            std::cerr << "Playback error: " << error.what() << std::endl;
+            m_pipeline->set_state(Gst::STATE_READY);
+            m_is_playing = false;
+            update_ticking();
+            break;
+        }
+        default:
+            break;
     }
-}
\ No newline at end of file
+    return true;
+}
@@ -8,7 +8,17 @@
 #include <gtkmm-3.0/gtkmm.h>
 #include <vector>
 #include <string>
+#include <memory>
+#include <mutex>
 #include <gstreamermm.h>
+#include "audio_tap.h"
+#include "library_journal.hpp"
+#include "media_importer.h"
+#include "media_paths.hpp"
+#include "metadata.hpp"
+#include "play_queue.hpp"
+#include "settings.hpp"
+#include "track_table.hpp"
 
 class Window : public Gtk::Window {
     public:
@@ -26,16 +36,59 @@ class Window : public Gtk::Window {
         Gtk::MenuItem m_menu_item_file_app_quit;
         Gtk::MenuItem m_menu_item_visuals;
         Gtk::Paned m_paned;
-        Gtk::ListBox m_media_list_box;
+        Gtk::ScrolledWindow m_media_scroll;
+        Gtk::TreeView m_media_view;
+
+        // One row per entry of m_rows, in the same order. The
+        // view runs in fixed-height mode, so it only measures and draws the
+        // rows that are on screen, and their text comes from m_library as
+        // they are drawn, so new tags only need a redraw.
+        class MediaColumns : public Gtk::TreeModel::ColumnRecord {
+            public:
+                MediaColumns() {
+                    add(m_id);
+                }
+
+                Gtk::TreeModelColumn<TrackId> m_id;
+        };
+        MediaColumns m_media_columns;
+        Glib::RefPtr<Gtk::ListStore> m_media_store;
+        Gtk::Box m_lower_box;
+        Gtk::DrawingArea m_spectrum_area;  // Shown by the Visuals menu
         Gtk::Box m_media_controls_box;
 
+        // One playbin for the life of the window; tracks are switched by
+        // changing its uri, never by rebuilding it.
         Glib::RefPtr<Gst::Element> m_pipeline;
         Gst::Element* m_source;
         Gst::Element* m_audio_link;
+        guint m_bus_watch_id = 0;
+        guint m_tick_id = 0;  // Frame-clock callback moving the time slider, 0 when not ticking
+        guint m_spectrum_tick_id = 0;
+        AudioTap m_audio_tap;  // playbin's audio-filter
+        SpectrumFrame m_spectrum_frame;
+        bool m_window_visible = true;
         bool m_is_playing = false;
+        Gst::State m_pipeline_state = Gst::STATE_NULL;
+
+        // Scrubbing: while the slider is held, cheap key-unit seeks follow it
+        // at most one at a time; releasing it commits one accurate seek.
         bool m_slider_dragging = false;
+        bool m_seek_in_flight = false;  // Until the pipeline posts ASYNC_DONE
+        double m_pending_seek = -1;     // Latest drag position not yet sought to, in seconds
+        gint64 m_last_seek_time = 0;    // g_get_monotonic_time() of the last drag seek
         std::string m_current_media_file;
 
+        // The track to chain to gaplessly, resolved on the main loop ahead of
+        // time and read by on_about_to_finish() on a streaming thread.
+        std::mutex m_next_mutex;
+        TrackId m_next_track = NO_TRACK;
+        std::string m_next_path;
+        std::string m_next_uri;
+        bool m_gapless_pending = false;  // Set once the next uri is queued, until its stream starts
+        TrackId m_queued_track = NO_TRACK;
+        std::string m_queued_path;
+
         Gtk::Button* m_play_button;
         Gtk::Button* m_pause_button;
         Gtk::Button* m_stop_button;
@@ -49,28 +102,67 @@ class Window : public Gtk::Window {
         void on_settings();
         void on_app_quit();
         void on_visuals();
+        bool on_spectrum_tick(const Glib::RefPtr<Gdk::FrameClock>& clock);
+        bool on_spectrum_draw(const Cairo::RefPtr<Cairo::Context>& cr);
         void on_window_resize(Gtk::Allocation& allocation);
 
         // New methods
         void load_media_directories();
         void save_media_directories();
-        void update_media_list();
+        void setup_media_list();
+        void append_media(const std::vector<TrackId>& ids);
+        void on_media_imported();
+        bool on_library_load_tick();
+        bool on_metadata_tick();
+        void on_media_cell_data(Gtk::CellRenderer* cell, const Gtk::TreeModel::iterator& iter);
+        void commit_library();
+        void remove_selected_media();
+        void on_media_row_activated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn* column);
+        bool on_media_key_press(GdkEventKey* event);
 
         void on_play_button_clicked();
         void on_pause_button_clicked();
         void on_stop_button_clicked();
-        bool update_time_slider();
-        void on_time_slider_changed();
-        void on_time_slider_value_changed();
-        void on_time_slider_release();
+        void update_time_slider();
+        void update_duration();
+        void update_ticking();
+        bool on_slider_tick(const Glib::RefPtr<Gdk::FrameClock>& clock);
+        bool on_window_state_changed(GdkEventWindowState* event);
+        bool on_time_slider_changed(Gtk::ScrollType scroll, double value);
+        bool on_time_slider_press(GdkEventButton* event);
+        bool on_time_slider_release(GdkEventButton* event);
+        void seek_to(double seconds, Gst::SeekFlags flags);
         void on_volume_slider_changed();
         void on_label_click(const std::string& media_file);
+        void update_next_track();
+        bool on_bus_message(const Glib::RefPtr<Gst::Bus>& bus, const Glib::RefPtr<Gst::Message>& message);
+        static void on_about_to_finish(GstElement* playbin, gpointer user_data);
 
         // New members
-        std::vector<std::string> m_media_directories;  // List of media directories
+        MediaImporter m_importer;
+
+        // The library store shared with the SFML frontend. Rows shown here are
+        // the entries that still exist on disk.
+        const std::string m_media_dir = mediaDirectory();
+        // Shared with the SFML frontend, which edits the EQ; read here so
+        // both play through the same DSP settings.
+        const std::string m_settings_file = m_media_dir + "/settings.txt";
+        // Folders still waiting to be walked when the window closed; they are
+        // imported again on the next start.
+        const std::string m_pending_folders_file = m_media_dir + "/pending_folders.txt";
+        TrackTable m_library;
+        LibraryJournal m_journal{m_media_dir};
+        // Reads tags for tracks that have none stored, or whose file changed.
+        MetadataScanner m_scanner;
+        std::size_t m_scans_outstanding = 0;
+        sigc::connection m_scan_tick;
+        // The listed tracks, in row order. m_queue plays through this same
+        // list; rows are appended to it in place and removals replace it.
+        std::shared_ptr<std::vector<TrackId>> m_rows = std::make_shared<std::vector<TrackId>>();
+        PlayQueue m_queue;
 
         // Constants
-        const std::string media_file = "../media/directories.txt";
+        const std::string media_file = "../media/directories.txt";  // This frontend's own list before the shared library
 
 };
 
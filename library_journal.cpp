@@ -0,0 +1,680 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "library_journal.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[4] = {'A', 'L', 'S', '1'};
+const char JOURNAL_MAGIC[4] = {'A', 'L', 'J', '1'};
+const std::size_t SNAPSHOT_HEADER_BYTES = 8;  // Magic, then the generation it covers
+const std::size_t JOURNAL_HEADER_BYTES = 4;
+const std::size_t RECORD_OVERHEAD = 8;  // Length before the body, CRC after it
+const std::size_t WRITE_BUFFER_BYTES = 1 << 16;
+// Journals smaller than this are not worth a snapshot rewrite, however small the snapshot.
+const uint64_t MIN_COMPACT_BYTES = 4 << 20;
+const std::size_t LOAD_CHUNK_RECORDS = 16384;
+const std::size_t MAX_LOAD_CHUNKS = 8;  // Bounds how far reading runs ahead of applying
+
+enum RecordType : uint8_t {
+    RECORD_ADD = 1,
+    RECORD_INFO = 2,
+    RECORD_PLAYED = 3,
+    RECORD_PLAY_STATS = 4,
+    RECORD_CLEAR = 5,
+    RECORD_REMOVE = 6,
+};
+
+uint32_t crc32(const char* data, std::size_t length) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Fields are stored in host byte order, like the waveform cache.
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, std::string_view text) {
+    uint16_t length = static_cast<uint16_t>(std::min<std::size_t>(text.size(), UINT16_MAX));
+    put(out, length);
+    out.append(text.data(), length);
+}
+
+class FieldReader {
+public:
+    explicit FieldReader(std::string_view data) : data(data) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (data.size() < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data.data(), sizeof(T));
+        data.remove_prefix(sizeof(T));
+        return value;
+    }
+    std::string_view getString() {
+        uint16_t length = get<uint16_t>();
+        if (data.size() < length) {
+            ok = false;
+            return {};
+        }
+        std::string_view text = data.substr(0, length);
+        data.remove_prefix(length);
+        return text;
+    }
+    std::string_view rest() const { return data; }
+
+    bool ok = true;
+
+private:
+    std::string_view data;
+};
+
+// Starts a record in out; finishRecord() fills in its length and checksum.
+void beginRecord(std::string& out, RecordType type) {
+    out.clear();
+    put<uint32_t>(out, 0);
+    put<uint8_t>(out, type);
+}
+
+void finishRecord(std::string& out) {
+    uint32_t length = static_cast<uint32_t>(out.size() - 4);
+    std::memcpy(&out[0], &length, sizeof(length));
+    put(out, crc32(out.data() + 4, length));
+}
+
+bool applyRecord(std::string_view body, TrackTable& library) {
+    FieldReader reader(body.substr(1));
+    switch (static_cast<uint8_t>(body[0])) {
+        case RECORD_ADD:
+            library.add(reader.rest());
+            return true;
+        case RECORD_INFO: {
+            TrackId id = reader.get<uint32_t>();
+            TrackInfo info;
+            info.durationMs = reader.get<uint32_t>();
+            info.trackNumber = reader.get<uint16_t>();
+            info.year = reader.get<uint16_t>();
+            info.file.size = reader.get<uint64_t>();
+            info.file.mtime = reader.get<int64_t>();
+            info.title = reader.getString();
+            info.artist = reader.getString();
+            info.album = reader.getString();
+            if (reader.ok) {
+                library.setInfo(id, info);
+            }
+            return reader.ok;
+        }
+        case RECORD_PLAYED: {
+            TrackId id = reader.get<uint32_t>();
+            int64_t when = reader.get<int64_t>();
+            if (reader.ok) {
+                library.notePlayed(id, when);
+            }
+            return reader.ok;
+        }
+        case RECORD_PLAY_STATS: {
+            TrackId id = reader.get<uint32_t>();
+            uint32_t count = reader.get<uint32_t>();
+            int64_t last = reader.get<int64_t>();
+            if (reader.ok) {
+                library.setPlayStats(id, count, last);
+            }
+            return reader.ok;
+        }
+        case RECORD_CLEAR:
+            library.clear();
+            return true;
+        case RECORD_REMOVE: {
+            TrackId id = reader.get<uint32_t>();
+            if (reader.ok) {
+                library.remove(id);
+            }
+            return reader.ok;
+        }
+        default:
+            // Written by a newer build; its checksum held, so skip just this record.
+            return true;
+    }
+}
+
+// Walks the records of a mapped snapshot or journal up to the end or the
+// first damaged one. Returns the number of bytes that held good records
+// (including the header), or 0 if the file is missing or not ours.
+template <typename Callback>
+uint64_t scanRecords(const MappedFile& file, const char (&magic)[4], std::size_t headerBytes, uint32_t* generation,
+                     Callback onRecord) {
+    std::string_view data = file.contents();
+    if (!file.isOpen() || data.size() < headerBytes || std::memcmp(data.data(), magic, 4) != 0) {
+        return 0;
+    }
+    if (generation) {
+        std::memcpy(generation, data.data() + 4, sizeof(*generation));
+    }
+    std::size_t offset = headerBytes;
+    while (data.size() - offset >= RECORD_OVERHEAD) {
+        uint32_t length;
+        std::memcpy(&length, data.data() + offset, sizeof(length));
+        if (length == 0 || length > data.size() - offset - RECORD_OVERHEAD) {
+            break;
+        }
+        std::string_view body = data.substr(offset + 4, length);
+        uint32_t storedCrc;
+        std::memcpy(&storedCrc, data.data() + offset + 4 + length, sizeof(storedCrc));
+        if (storedCrc != crc32(body.data(), body.size())) {
+            break;
+        }
+        onRecord(body);
+        offset += RECORD_OVERHEAD + length;
+    }
+    return offset;
+}
+
+uint64_t replayFile(const std::string& path, const char (&magic)[4], std::size_t headerBytes, TrackTable& library,
+                    uint32_t* generation = nullptr) {
+    MappedFile file(path);
+    return scanRecords(file, magic, headerBytes, generation,
+                       [&library](std::string_view body) { applyRecord(body, library); });
+}
+
+// Journal generations present on disk, oldest first.
+std::vector<uint32_t> journalGenerations(const std::string& directory, const std::string& prefix) {
+    std::vector<uint32_t> generations;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+            name.find_first_not_of("0123456789", prefix.size()) == std::string::npos) {
+            generations.push_back(static_cast<uint32_t>(std::stoul(name.substr(prefix.size()))));
+        }
+    }
+    std::sort(generations.begin(), generations.end());
+    return generations;
+}
+
+bool syncPath(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+}
+
+LibraryJournal::LibraryJournal(const std::string& directory)
+        : directory(directory),
+          snapshotPath(directory + "/library.snapshot"),
+          journalPrefix("library.journal."),
+          journalBuffer(WRITE_BUFFER_BYTES),
+          worker(&LibraryJournal::run, this) {}
+
+LibraryJournal::~LibraryJournal() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    loadRoom.notify_one();
+    worker.join();
+    if (lockFd >= 0) {
+        close(lockFd);
+    }
+}
+
+void LibraryJournal::lockLibrary() {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string path = directory + "/library.lock";
+    // Held until the journal is destroyed; the kernel drops it if the process dies.
+    lockFd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockFd >= 0 && flock(lockFd, LOCK_EX | LOCK_NB) == 0) {
+        return;
+    }
+    if (errno == EWOULDBLOCK) {
+        std::cerr << "Library in " << directory << " is open in another Aecros process; "
+                  << "loading it read-only, changes will not be saved" << std::endl;
+    } else {
+        std::cerr << "Could not lock " << path << ": " << std::strerror(errno)
+                  << "; loading the library read-only" << std::endl;
+    }
+    if (lockFd >= 0) {
+        close(lockFd);
+        lockFd = -1;
+    }
+    readOnly = true;
+}
+
+void LibraryJournal::startLoad() {
+    if (lockFd < 0 && !readOnly) {
+        lockLibrary();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loadRequested = true;
+        loadDone = false;
+    }
+    loading = true;
+    currentChunk = LoadChunk();
+    currentRecord = 0;
+    wake.notify_one();
+}
+
+bool LibraryJournal::applyLoaded(TrackTable& library, std::chrono::steady_clock::duration budget) {
+    if (!loading) {
+        return false;
+    }
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    while (true) {
+        if (currentRecord == currentChunk.records.size()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!loadProgress.wait_until(lock, deadline, [this] { return !loadChunks.empty() || loadDone; })) {
+                return true;
+            }
+            if (loadChunks.empty()) {
+                break;
+            }
+            currentChunk = std::move(loadChunks.front());
+            loadChunks.pop_front();
+            currentRecord = 0;
+            if (currentChunk.clearsLibrary) {
+                library.clear();
+            }
+            loadRoom.notify_one();
+        }
+        // Check the clock every few hundred records rather than every one.
+        std::size_t end = std::min(currentChunk.records.size(), currentRecord + 256);
+        for (; currentRecord < end; ++currentRecord) {
+            applyRecord(currentChunk.records[currentRecord], library);
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return true;
+        }
+    }
+
+    // Everything is applied: fix up the files and start appending.
+    LoadResult result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        result = std::move(loadResult);
+    }
+    snapshotBytes = result.snapshotBytes;
+    journalBytes = result.journalBytes;
+    foundLibrary = result.found;
+    currentChunk = LoadChunk();
+    loading = false;
+    if (readOnly) {
+        // The process holding the lock may still be appending to the tail.
+        return false;
+    }
+    std::error_code error;
+    for (const auto& torn : result.tornJournals) {
+        std::cerr << "Library journal " << torn.first << " damaged after " << torn.second
+                  << " bytes; dropping the rest" << std::endl;
+        std::filesystem::resize_file(torn.first, torn.second, error);
+    }
+    openJournal(result.latestGeneration);
+    return false;
+}
+
+bool LibraryJournal::load(TrackTable& library) {
+    startLoad();
+    while (applyLoaded(library, std::chrono::hours(1))) {
+    }
+    return foundLibrary;
+}
+
+void LibraryJournal::readForLoad() {
+    // Chunks hold views into the mappings, which they keep alive until applied.
+    auto pushChunk = [this](LoadChunk& chunk) {
+        std::unique_lock<std::mutex> lock(mutex);
+        loadRoom.wait(lock, [this] { return stopping || loadChunks.size() < MAX_LOAD_CHUNKS; });
+        if (stopping) {
+            return false;
+        }
+        loadChunks.push_back(std::move(chunk));
+        lock.unlock();
+        loadProgress.notify_one();
+        chunk = LoadChunk();
+        return true;
+    };
+    auto readFile = [&](const std::string& path, const char (&magic)[4], std::size_t headerBytes,
+                        uint32_t* generation, bool& stopped) {
+        auto file = std::make_shared<const MappedFile>(path);
+        LoadChunk chunk;
+        chunk.file = file;
+        uint64_t good = scanRecords(*file, magic, headerBytes, generation, [&](std::string_view body) {
+            if (stopped) {
+                return;
+            }
+            chunk.records.push_back(body);
+            if (chunk.records.size() == LOAD_CHUNK_RECORDS) {
+                stopped = !pushChunk(chunk);
+                chunk.file = file;
+            }
+        });
+        if (!stopped && !chunk.records.empty()) {
+            stopped = !pushChunk(chunk);
+        }
+        return good;
+    };
+
+    LoadResult result;
+    bool stopped = false;
+    // The first chunk resets the table, in case it was loaded before.
+    LoadChunk reset;
+    reset.clearsLibrary = true;
+    stopped = !pushChunk(reset);
+
+    uint32_t snapshotGeneration = 0;
+    if (!stopped) {
+        result.snapshotBytes = readFile(snapshotPath, SNAPSHOT_MAGIC, SNAPSHOT_HEADER_BYTES, &snapshotGeneration,
+                                        stopped);
+    }
+    result.found = result.snapshotBytes > 0;
+    result.latestGeneration = std::max<uint32_t>(snapshotGeneration, 1);
+    for (uint32_t generation : journalGenerations(directory, journalPrefix)) {
+        if (stopped) {
+            break;
+        }
+        std::string path = directory + "/" + journalPrefix + std::to_string(generation);
+        std::error_code error;
+        if (generation < snapshotGeneration) {
+            // Folded into the snapshot by a compaction that did not get to clean up.
+            if (!readOnly) {
+                std::filesystem::remove(path, error);
+            }
+            continue;
+        }
+        uint64_t good = readFile(path, JOURNAL_MAGIC, JOURNAL_HEADER_BYTES, nullptr, stopped);
+        uint64_t size = std::filesystem::file_size(path, error);
+        if (good > 0 && !error && good < size) {
+            // Cut off later, so new records follow the last good one.
+            result.tornJournals.emplace_back(path, good);
+        }
+        result.found = result.found || good > JOURNAL_HEADER_BYTES;
+        result.journalBytes += good;
+        result.latestGeneration = std::max(result.latestGeneration, generation);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loadResult = std::move(result);
+        loadDone = true;
+    }
+    loadProgress.notify_one();
+}
+
+void LibraryJournal::openJournal(uint32_t generation) {
+    if (journal.is_open()) {
+        journal.close();
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string path = directory + "/" + journalPrefix + std::to_string(generation);
+    bool fresh = std::filesystem::file_size(path, error) < JOURNAL_HEADER_BYTES || error;
+
+    journal.clear();
+    journal.rdbuf()->pubsetbuf(journalBuffer.data(), static_cast<std::streamsize>(journalBuffer.size()));
+    journal.open(path, std::ios::binary | (fresh ? std::ios::trunc : std::ios::app));
+    if (!journal) {
+        std::cerr << "Could not open library journal: " << path << std::endl;
+        return;
+    }
+    if (fresh) {
+        journal.write(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        journalBytes += JOURNAL_HEADER_BYTES;
+    }
+    journal.write(pendingRecords.data(), static_cast<std::streamsize>(pendingRecords.size()));
+    pendingRecords.clear();
+    journalGeneration = generation;
+}
+
+void LibraryJournal::appendRecord() {
+    if (readOnly) {
+        return;
+    }
+    finishRecord(record);
+    if (loading) {
+        // The journal to append to is only known once loading has read them all.
+        pendingRecords += record;
+    } else {
+        journal.write(record.data(), static_cast<std::streamsize>(record.size()));
+    }
+    journalBytes += record.size();
+}
+
+void LibraryJournal::recordAdd(std::string_view path) {
+    beginRecord(record, RECORD_ADD);
+    record.append(path.data(), path.size());
+    appendRecord();
+}
+
+void LibraryJournal::recordInfo(TrackId id, const TrackInfo& info) {
+    beginRecord(record, RECORD_INFO);
+    put<uint32_t>(record, id);
+    put<uint32_t>(record, info.durationMs);
+    put<uint16_t>(record, info.trackNumber);
+    put<uint16_t>(record, info.year);
+    put<uint64_t>(record, info.file.size);
+    put<int64_t>(record, info.file.mtime);
+    putString(record, info.title);
+    putString(record, info.artist);
+    putString(record, info.album);
+    appendRecord();
+}
+
+void LibraryJournal::recordPlayed(TrackId id, int64_t when) {
+    beginRecord(record, RECORD_PLAYED);
+    put<uint32_t>(record, id);
+    put<int64_t>(record, when);
+    appendRecord();
+}
+
+void LibraryJournal::recordRemove(TrackId id) {
+    beginRecord(record, RECORD_REMOVE);
+    put<uint32_t>(record, id);
+    appendRecord();
+}
+
+void LibraryJournal::recordClear() {
+    beginRecord(record, RECORD_CLEAR);
+    appendRecord();
+}
+
+void LibraryJournal::flush() {
+    if (journal.is_open()) {
+        journal.flush();
+    }
+}
+
+bool LibraryJournal::wantsCompaction() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (compactionDone) {
+        compactionDone = false;
+        snapshotBytes = compactedSnapshotBytes;
+    }
+    return !loading && !readOnly && compactGeneration == 0 &&
+           journalBytes > std::max(MIN_COMPACT_BYTES, snapshotBytes);
+}
+
+void LibraryJournal::compact() {
+    if (loading || readOnly) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (compactGeneration != 0) {
+            return;
+        }
+    }
+    // Everything before the new generation is closed and can be read by the worker.
+    flush();
+    journalBytes = 0;
+    uint32_t generation = journalGeneration + 1;
+    openJournal(generation);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        compactGeneration = generation;
+    }
+    wake.notify_one();
+}
+
+void LibraryJournal::run() {
+    // Rewriting the snapshot should never compete with playback.
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+
+    while (true) {
+        uint32_t generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || loadRequested || compactGeneration != 0; });
+            if (stopping && compactGeneration == 0) {
+                return;
+            }
+            if (loadRequested) {
+                loadRequested = false;
+                lock.unlock();
+                readForLoad();
+                continue;
+            }
+            generation = compactGeneration;
+        }
+
+        bool ok = writeSnapshot(generation);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ok) {
+            std::error_code error;
+            compactedSnapshotBytes = std::filesystem::file_size(snapshotPath, error);
+            compactionDone = true;
+        }
+        compactGeneration = 0;
+    }
+}
+
+bool LibraryJournal::writeSnapshot(uint32_t generation) {
+    // Rebuilt from the files rather than the live table, which belongs to the UI thread.
+    TrackTable library;
+    uint32_t snapshotGeneration = 0;
+    replayFile(snapshotPath, SNAPSHOT_MAGIC, SNAPSHOT_HEADER_BYTES, library, &snapshotGeneration);
+    std::vector<uint32_t> folded;
+    for (uint32_t journalGen : journalGenerations(directory, journalPrefix)) {
+        if (journalGen >= snapshotGeneration && journalGen < generation) {
+            replayFile(directory + "/" + journalPrefix + std::to_string(journalGen), JOURNAL_MAGIC,
+                       JOURNAL_HEADER_BYTES, library);
+        }
+        if (journalGen < generation) {
+            folded.push_back(journalGen);
+        }
+    }
+
+    std::string tempPath = snapshotPath + ".tmp";
+    {
+        std::vector<char> buffer(WRITE_BUFFER_BYTES);
+        std::ofstream outFile;
+        outFile.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        outFile.open(tempPath, std::ios::binary | std::ios::trunc);
+        if (!outFile) {
+            std::cerr << "Could not write library snapshot: " << tempPath << std::endl;
+            return false;
+        }
+        outFile.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        outFile.write(reinterpret_cast<const char*>(&generation), sizeof(generation));
+
+        std::string out;
+        std::string path;
+        TrackInfo info;
+        for (TrackId id = 0; id < library.size(); ++id) {
+            library.path(id, path);
+            beginRecord(out, RECORD_ADD);
+            out += path;
+            finishRecord(out);
+            outFile.write(out.data(), static_cast<std::streamsize>(out.size()));
+
+            if (library.isRemoved(id)) {
+                // Written as it was made, so the rows after it keep their IDs.
+                beginRecord(out, RECORD_REMOVE);
+                put<uint32_t>(out, id);
+                finishRecord(out);
+                outFile.write(out.data(), static_cast<std::streamsize>(out.size()));
+            }
+            if (library.hasInfo(id)) {
+                beginRecord(out, RECORD_INFO);
+                put<uint32_t>(out, id);
+                put<uint32_t>(out, library.durationsMs()[id]);
+                put<uint16_t>(out, library.trackNumbers()[id]);
+                put<uint16_t>(out, library.years()[id]);
+                put<uint64_t>(out, library.fileSizes()[id]);
+                put<int64_t>(out, library.modifiedTimes()[id]);
+                putString(out, library.title(id));
+                putString(out, library.artist(id));
+                putString(out, library.album(id));
+                finishRecord(out);
+                outFile.write(out.data(), static_cast<std::streamsize>(out.size()));
+            }
+            if (library.playCounts()[id] > 0) {
+                beginRecord(out, RECORD_PLAY_STATS);
+                put<uint32_t>(out, id);
+                put<uint32_t>(out, library.playCounts()[id]);
+                put<int64_t>(out, library.lastPlayed()[id]);
+                finishRecord(out);
+                outFile.write(out.data(), static_cast<std::streamsize>(out.size()));
+            }
+        }
+        outFile.flush();
+        if (!outFile) {
+            std::cerr << "Could not write library snapshot: " << tempPath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    // The snapshot must be on disk before the rename makes it the only copy.
+    if (!syncPath(tempPath) || std::rename(tempPath.c_str(), snapshotPath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    syncPath(directory);
+    for (uint32_t journalGen : folded) {
+        std::error_code error;
+        std::filesystem::remove(directory + "/" + journalPrefix + std::to_string(journalGen), error);
+    }
+    return true;
+}
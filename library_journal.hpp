@@ -0,0 +1,132 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_LIBRARY_JOURNAL_HPP
+#define AECROS_LIBRARY_JOURNAL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "mapped_file.hpp"
+#include "metadata.hpp"
+#include "track_table.hpp"
+
+// Library persistence as a snapshot plus append-only journals of the
+// changes made since. Every record is length-prefixed and CRC-32 checked,
+// so a crash can only lose the unflushed tail, which is dropped on load.
+//
+// Files in the directory:
+//   library.snapshot     the library as of generation G, replaced by rename
+//   library.journal.<N>  changes made while generation N was current
+//   library.lock         flock()ed by the one process allowed to write
+// Loading replays the snapshot, then every journal with N >= G in order.
+// A process that finds the lock taken loads the library read-only.
+class LibraryJournal {
+public:
+    explicit LibraryJournal(const std::string& directory);
+    // Flushes and waits for a running compaction.
+    ~LibraryJournal();
+
+    // Rebuilds library from disk and opens the newest journal for appending.
+    // Returns false when there is nothing stored yet.
+    bool load(TrackTable& library);
+
+    // The same in steps, so the UI can show a partial library while it loads:
+    // startLoad() has the worker map and check the files, and each
+    // applyLoaded() adds what has been read so far to library for up to
+    // budget. Rows keep the IDs they will have once loading is done, but
+    // nothing may add rows or clear the table until applyLoaded() has
+    // returned false. Records made meanwhile are held until then.
+    void startLoad();
+    bool applyLoaded(TrackTable& library, std::chrono::steady_clock::duration budget);
+    bool isLoading() const { return loading; }
+    // After loading: whether there was a stored library at all.
+    bool hasStoredLibrary() const { return foundLibrary; }
+    // Set by startLoad() when another process holds the library. Records are
+    // then dropped and nothing in the directory is changed.
+    bool isReadOnly() const { return readOnly; }
+
+    // Each is one small append to an in-memory buffer; flush() hands the
+    // buffer to the OS.
+    void recordAdd(std::string_view path);
+    void recordInfo(TrackId id, const TrackInfo& info);
+    void recordPlayed(TrackId id, int64_t when);
+    // Leaves a tombstone rather than renumbering, so later records keep their IDs.
+    void recordRemove(TrackId id);
+    void recordClear();
+    void flush();
+
+    // True once the journals outgrow the snapshot enough to be worth folding in.
+    bool wantsCompaction();
+    // Starts a new journal and folds the older ones into a new snapshot on
+    // the worker thread. Ignored while a compaction is already running.
+    void compact();
+
+private:
+    // Validated record bodies, viewing into the file they came from.
+    struct LoadChunk {
+        std::shared_ptr<const MappedFile> file;
+        std::vector<std::string_view> records;
+        bool clearsLibrary = false;
+    };
+    struct LoadResult {
+        uint32_t latestGeneration = 1;
+        uint64_t snapshotBytes = 0;
+        uint64_t journalBytes = 0;
+        bool found = false;
+        std::vector<std::pair<std::string, uint64_t>> tornJournals;  // Path, good length
+    };
+
+    void lockLibrary();
+    void openJournal(uint32_t generation);
+    void appendRecord();
+    void run();
+    void readForLoad();
+    bool writeSnapshot(uint32_t generation);
+
+    std::string directory;
+    std::string snapshotPath;
+    std::string journalPrefix;
+
+    int lockFd = -1;
+    bool readOnly = false;  // Written before the worker is woken, read by it after
+
+    // Appends; only touched by the owning (UI) thread.
+    std::ofstream journal;
+    std::vector<char> journalBuffer;
+    std::string record;
+    uint32_t journalGeneration = 0;
+    uint64_t journalBytes = 0;
+    uint64_t snapshotBytes = 0;
+    std::string pendingRecords;
+    bool loading = false;
+    bool foundLibrary = false;
+    LoadChunk currentChunk;
+    std::size_t currentRecord = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable loadProgress;
+    std::condition_variable loadRoom;
+    std::deque<LoadChunk> loadChunks;
+    LoadResult loadResult;
+    bool loadRequested = false;
+    bool loadDone = false;
+    uint32_t compactGeneration = 0;  // Non-zero while a compaction is pending or running
+    uint64_t compactedSnapshotBytes = 0;
+    bool compactionDone = false;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif //AECROS_LIBRARY_JOURNAL_HPP
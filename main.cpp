@@ -2,11 +2,89 @@
 // Created by mk on 10/28/24.
 //
 
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
+#include "scan_index.hpp"
+#include "startup_bench.hpp"
 
 void openMainWindow();
 
-int main() {
+namespace {
+
+// The most threads per parallel stage --scan will start, so a typo in
+// --jobs cannot ask for millions.
+const unsigned long long MAX_SCAN_JOBS = 256;
+
+// A whole decimal number, and nothing else; std::stoul would throw on
+// "abc" and wrap "-1" around.
+bool parseCount(const char* text, unsigned long long& value) {
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoull(text, &end, 10);
+    return *end == '\0' && errno != ERANGE;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    auto mainEntered = std::chrono::steady_clock::now();
+    if (argc > 1 && std::strcmp(argv[1], "--bench-startup") == 0) {
+        // Optional track counts follow; the default covers small to very large libraries.
+        std::vector<std::size_t> trackCounts;
+        for (int i = 2; i < argc; ++i) {
+            unsigned long long count;
+            if (!parseCount(argv[i], count) || count == 0 || count > UINT32_MAX) {
+                std::cerr << "Usage: " << argv[0] << " --bench-startup [track count...]" << std::endl;
+                return 2;
+            }
+            trackCounts.push_back(static_cast<std::size_t>(count));
+        }
+        if (trackCounts.empty()) {
+            trackCounts = {1000, 100000, 1000000};
+        }
+        return runStartupBench(trackCounts, mainEntered);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--scan") == 0) {
+        ScanOptions options;
+        bool valid = true;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--index" && i + 1 < argc) {
+                options.index = argv[++i];
+            } else if (arg == "--waveforms") {
+                options.waveforms = true;
+            } else if (arg == "--loudness") {
+                options.loudness = true;
+            } else if (arg == "--jobs" && i + 1 < argc) {
+                // 0 keeps the default of one per core.
+                unsigned long long jobs;
+                if (!parseCount(argv[++i], jobs) || jobs > MAX_SCAN_JOBS) {
+                    valid = false;
+                } else {
+                    options.jobs = static_cast<unsigned>(jobs);
+                }
+            } else if (arg.compare(0, 2, "--") == 0) {
+                valid = false;
+            } else {
+                options.roots.push_back(arg);
+            }
+        }
+        if (!valid || options.roots.empty() || options.index.empty()) {
+            std::cerr << "Usage: " << argv[0]
+                      << " --scan <dirs...> --index <library dir> [--waveforms] [--loudness] [--jobs N]" << std::endl;
+            return 2;
+        }
+        return runScanIndex(options);
+    }
     openMainWindow();
     return 0;
 }
@@ -0,0 +1,39 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        opened = true;
+        length = static_cast<std::size_t>(info.st_size);
+        if (length > 0) {
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                opened = false;
+                length = 0;
+            } else {
+                data = static_cast<const char*>(mapping);
+                madvise(mapping, length, MADV_SEQUENTIAL);
+            }
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data) {
+        munmap(const_cast<char*>(data), length);
+    }
+}
@@ -0,0 +1,30 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_MAPPED_FILE_HPP
+#define AECROS_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only mapping of a whole file, hinted for one sequential pass. An
+// empty file opens fine with empty contents.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return opened; }
+    std::string_view contents() const { return std::string_view(data, length); }
+
+private:
+    const char* data = nullptr;
+    std::size_t length = 0;
+    bool opened = false;
+};
+
+#endif //AECROS_MAPPED_FILE_HPP
@@ -0,0 +1,97 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "media_paths.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+const char* const AUDIO_EXTENSIONS[] = {".mp3", ".wav", ".ogg", ".flac", ".aac"};
+
+// Where the data lived before it moved to the project root: media/ under
+// whatever the working directory was, usually the build directory.
+const char* const LEGACY_MEDIA_DIRECTORY = "media";
+
+bool isEmptyDirectory(const std::filesystem::path& path) {
+    std::error_code error;
+    return std::filesystem::is_empty(path, error) || error;
+}
+
+// Copies the old data into the new directory the first time the new one is
+// used. The old copy stays where it is for builds that still look there.
+void migrateMediaDirectory(const std::string& from, const std::string& to) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(from, error) || std::filesystem::equivalent(from, to, error) ||
+        isEmptyDirectory(from)) {
+        return;
+    }
+    if (std::filesystem::exists(to, error) && !isEmptyDirectory(to)) {
+        return;
+    }
+    std::string source = std::filesystem::absolute(from, error).string();
+    std::filesystem::create_directories(to, error);
+    std::filesystem::copy(from, to, std::filesystem::copy_options::recursive, error);
+    if (error) {
+        std::cerr << "Could not copy " << source << " to " << to << ": " << error.message() << std::endl;
+        return;
+    }
+    std::cout << "Copied " << source << " to " << to << std::endl;
+}
+
+}
+
+std::string findProjectRoot() {
+    std::filesystem::path currentPath = std::filesystem::current_path();
+    while (!std::filesystem::exists(currentPath / "CMakeLists.txt")) {
+        if (currentPath.has_parent_path() && currentPath.parent_path() != currentPath) {
+            currentPath = currentPath.parent_path();
+        } else {
+            throw std::runtime_error("Project root not found");
+        }
+    }
+    return currentPath.string();
+}
+
+std::string mediaDirectory() {
+    std::string directory;
+    try {
+        directory = findProjectRoot() + "/media";
+    } catch (const std::exception&) {
+        return "media";
+    }
+    migrateMediaDirectory(LEGACY_MEDIA_DIRECTORY, directory);
+    return directory;
+}
+
+bool isAudioFilePath(const std::string& path) {
+    std::size_t dot = path.rfind('.');
+    // Like std::filesystem::path::extension(): ".flac" alone is a name, not an extension.
+    if (dot == std::string::npos || dot == 0 || path[dot - 1] == '/' || path.size() - dot > 5 ||
+        path.find('/', dot) != std::string::npos) {
+        return false;
+    }
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return std::find(std::begin(AUDIO_EXTENSIONS), std::end(AUDIO_EXTENSIONS), ext) != std::end(AUDIO_EXTENSIONS);
+}
+
+void findAudioFiles(const std::string& directory, std::vector<std::string>& files) {
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(
+            directory, std::filesystem::directory_options::skip_permission_denied, error);
+    for (std::filesystem::recursive_directory_iterator end; !error && it != end; it.increment(error)) {
+        std::error_code entryError;
+        if (it->is_regular_file(entryError)) {
+            std::string path = it->path().string();
+            if (isAudioFilePath(path)) {
+                files.push_back(std::move(path));
+            }
+        }
+    }
+}
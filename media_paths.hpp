@@ -0,0 +1,28 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_MEDIA_PATHS_HPP
+#define AECROS_MEDIA_PATHS_HPP
+
+#include <string>
+#include <vector>
+
+// The checkout the program runs from: the nearest directory at or above the
+// working directory that holds CMakeLists.txt. Throws if there is none.
+std::string findProjectRoot();
+
+// Where every frontend keeps the library, settings and caches:
+// <project root>/media, or ./media when run from outside a checkout.
+// Data left in ./media by older builds is copied over the first time
+// <project root>/media is missing or empty.
+std::string mediaDirectory();
+
+// By extension, ignoring case: .mp3, .wav, .ogg, .flac, .aac.
+bool isAudioFilePath(const std::string& path);
+
+// Appends every audio file below directory, recursively. Unreadable
+// subdirectories are skipped rather than ending the walk.
+void findAudioFiles(const std::string& directory, std::vector<std::string>& files);
+
+#endif //AECROS_MEDIA_PATHS_HPP
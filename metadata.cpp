@@ -0,0 +1,381 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "metadata.hpp"
+#include <SFML/Audio.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Tag blocks bigger than this are almost always embedded artwork.
+const uint32_t MAX_TAG_BLOCK = 1 << 20;
+const std::size_t OGG_SCAN_BYTES = 64 * 1024;
+
+uint32_t readBigEndian32(const unsigned char* bytes) {
+    return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+}
+
+uint32_t readLittleEndian32(const unsigned char* bytes) {
+    return (uint32_t(bytes[3]) << 24) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[1]) << 8) | bytes[0];
+}
+
+uint32_t readSyncsafe32(const unsigned char* bytes) {
+    return (uint32_t(bytes[0] & 0x7F) << 21) | (uint32_t(bytes[1] & 0x7F) << 14) |
+           (uint32_t(bytes[2] & 0x7F) << 7) | (bytes[3] & 0x7F);
+}
+
+void appendUtf8(std::string& out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+std::string decodeUtf16(const unsigned char* data, std::size_t size, bool bigEndian) {
+    std::string out;
+    for (std::size_t i = 0; i + 1 < size; i += 2) {
+        uint32_t unit = bigEndian ? (data[i] << 8) | data[i + 1] : (data[i + 1] << 8) | data[i];
+        if (unit == 0) {
+            break;
+        }
+        if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < size) {
+            uint32_t low = bigEndian ? (data[i + 2] << 8) | data[i + 3] : (data[i + 3] << 8) | data[i + 2];
+            unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+            i += 2;
+        }
+        appendUtf8(out, unit);
+    }
+    return out;
+}
+
+// ID3v2 text frame body: an encoding byte followed by the text. Only the
+// first of several NUL-separated values is kept.
+std::string decodeId3Text(const unsigned char* data, std::size_t size) {
+    if (size < 1) {
+        return std::string();
+    }
+    unsigned char encoding = data[0];
+    data++;
+    size--;
+    switch (encoding) {
+        case 1:
+            if (size >= 2 && data[0] == 0xFE && data[1] == 0xFF) {
+                return decodeUtf16(data + 2, size - 2, true);
+            }
+            if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+                return decodeUtf16(data + 2, size - 2, false);
+            }
+            return decodeUtf16(data, size, false);
+        case 2:
+            return decodeUtf16(data, size, true);
+        case 3:
+            return std::string(reinterpret_cast<const char*>(data), strnlen(reinterpret_cast<const char*>(data), size));
+        default: {
+            std::string out;
+            for (std::size_t i = 0; i < size && data[i] != 0; ++i) {
+                appendUtf8(out, data[i]);  // ISO-8859-1 maps straight onto the first 256 code points
+            }
+            return out;
+        }
+    }
+}
+
+uint16_t parseLeadingNumber(const std::string& text) {
+    unsigned value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9' || value > 6553) {
+            break;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return static_cast<uint16_t>(value);
+}
+
+void applyField(const std::string& key, const std::string& value, TrackInfo& info) {
+    if (key == "TITLE" || key == "TIT2") {
+        info.title = value;
+    } else if (key == "ARTIST" || key == "TPE1") {
+        info.artist = value;
+    } else if (key == "ALBUM" || key == "TALB") {
+        info.album = value;
+    } else if (key == "TRACKNUMBER" || key == "TRCK") {
+        info.trackNumber = parseLeadingNumber(value);
+    } else if (key == "DATE" || key == "TYER" || key == "TDRC") {
+        info.year = parseLeadingNumber(value);
+    }
+}
+
+// Vendor string, then a count of "KEY=value" comments; all lengths little-endian.
+void parseVorbisComment(const unsigned char* data, std::size_t size, TrackInfo& info) {
+    if (size < 8) {
+        return;
+    }
+    std::size_t offset = 4 + std::size_t(readLittleEndian32(data));
+    if (offset + 4 > size) {
+        return;
+    }
+    uint32_t count = readLittleEndian32(data + offset);
+    offset += 4;
+    for (uint32_t i = 0; i < count && offset + 4 <= size; ++i) {
+        std::size_t length = readLittleEndian32(data + offset);
+        offset += 4;
+        if (length > size - offset) {
+            return;
+        }
+        std::string comment(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+        std::size_t equals = comment.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string key = comment.substr(0, equals);
+        std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+        // Keep the first value of repeated fields; TRACKNUMBER=3/12 and DATE=2010-05-01 both parse.
+        if ((key == "TITLE" && info.title.empty()) || (key == "ARTIST" && info.artist.empty()) ||
+            (key == "ALBUM" && info.album.empty()) || key == "TRACKNUMBER" || key == "DATE") {
+            applyField(key, comment.substr(equals + 1), info);
+        }
+    }
+}
+
+// Reads an ID3v2 tag at the start of the stream, if there is one, and leaves
+// the stream positioned just after it.
+void readId3(std::istream& in, TrackInfo& info) {
+    unsigned char header[10];
+    if (!in.read(reinterpret_cast<char*>(header), 10) || std::memcmp(header, "ID3", 3) != 0) {
+        in.clear();
+        in.seekg(0);
+        return;
+    }
+    unsigned version = header[3];
+    unsigned flags = header[5];
+    std::streamoff tagEnd = 10 + std::streamoff(readSyncsafe32(header + 6)) + ((flags & 0x10) ? 10 : 0);
+
+    if (version == 3 || version == 4) {
+        if (flags & 0x40) {
+            unsigned char extended[4];
+            in.read(reinterpret_cast<char*>(extended), 4);
+            uint32_t extendedSize = version == 4 ? readSyncsafe32(extended) - 4 : readBigEndian32(extended);
+            in.seekg(extendedSize, std::ios::cur);
+        }
+        std::vector<unsigned char> body;
+        unsigned char frame[10];
+        while (in.tellg() + std::streamoff(10) <= tagEnd && in.read(reinterpret_cast<char*>(frame), 10)) {
+            if (frame[0] == 0) {
+                break;  // Padding
+            }
+            uint32_t size = version == 4 ? readSyncsafe32(frame + 4) : readBigEndian32(frame + 4);
+            std::string id(reinterpret_cast<const char*>(frame), 4);
+            bool wanted = id == "TIT2" || id == "TPE1" || id == "TALB" || id == "TRCK" || id == "TYER" || id == "TDRC";
+            if (!wanted || size > MAX_TAG_BLOCK) {
+                in.seekg(size, std::ios::cur);
+                continue;
+            }
+            body.resize(size);
+            if (!in.read(reinterpret_cast<char*>(body.data()), size)) {
+                break;
+            }
+            std::size_t skip = (version == 4 && (frame[9] & 0x01)) ? 4 : 0;  // Data length indicator
+            if (skip <= size) {
+                applyField(id, decodeId3Text(body.data() + skip, size - skip), info);
+            }
+        }
+    }
+    in.clear();
+    in.seekg(tagEnd);
+}
+
+void readFlac(std::istream& in, TrackInfo& info) {
+    unsigned char header[4];
+    std::vector<unsigned char> block;
+    bool last = false;
+    while (!last && in.read(reinterpret_cast<char*>(header), 4)) {
+        last = header[0] & 0x80;
+        unsigned type = header[0] & 0x7F;
+        uint32_t length = (uint32_t(header[1]) << 16) | (uint32_t(header[2]) << 8) | header[3];
+        if ((type != 0 && type != 4) || length > MAX_TAG_BLOCK) {
+            in.seekg(length, std::ios::cur);
+            continue;
+        }
+        block.resize(length);
+        if (!in.read(reinterpret_cast<char*>(block.data()), length)) {
+            return;
+        }
+        if (type == 0 && length >= 18) {
+            // STREAMINFO: 20-bit sample rate and 36-bit total sample count.
+            uint32_t sampleRate = (uint32_t(block[10]) << 12) | (uint32_t(block[11]) << 4) | (block[12] >> 4);
+            uint64_t totalSamples = (uint64_t(block[13] & 0x0F) << 32) | readBigEndian32(block.data() + 14);
+            if (sampleRate > 0) {
+                info.durationMs = static_cast<uint32_t>(totalSamples * 1000 / sampleRate);
+            }
+        } else if (type == 4) {
+            parseVorbisComment(block.data(), block.size(), info);
+        }
+    }
+}
+
+const unsigned char* findBytes(const std::vector<unsigned char>& buffer, const char* needle, std::size_t length,
+                               bool fromEnd) {
+    if (buffer.size() < length) {
+        return nullptr;
+    }
+    if (fromEnd) {
+        for (std::size_t i = buffer.size() - length + 1; i-- > 0;) {
+            if (std::memcmp(buffer.data() + i, needle, length) == 0) {
+                return buffer.data() + i;
+            }
+        }
+        return nullptr;
+    }
+    auto it = std::search(buffer.begin(), buffer.end(), needle, needle + length);
+    return it == buffer.end() ? nullptr : &*it;
+}
+
+// Headers are found by signature in the first 64 KB rather than by walking
+// Ogg pages, which is enough for the identification and comment packets of
+// every file not carrying huge embedded artwork. The duration comes from the
+// granule position of the last page.
+void readOggVorbis(std::istream& in, uint64_t fileSize, TrackInfo& info) {
+    std::vector<unsigned char> buffer(static_cast<std::size_t>(std::min<uint64_t>(fileSize, OGG_SCAN_BYTES)));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(buffer.data()), buffer.size())) {
+        return;
+    }
+    uint32_t sampleRate = 0;
+    const unsigned char* identification = findBytes(buffer, "\x01vorbis", 7, false);
+    if (identification && identification + 16 <= buffer.data() + buffer.size()) {
+        sampleRate = readLittleEndian32(identification + 12);
+    }
+    const unsigned char* comment = findBytes(buffer, "\x03vorbis", 7, false);
+    if (comment) {
+        parseVorbisComment(comment + 7, buffer.data() + buffer.size() - (comment + 7), info);
+    }
+
+    uint64_t tailStart = fileSize > OGG_SCAN_BYTES ? fileSize - OGG_SCAN_BYTES : 0;
+    buffer.resize(static_cast<std::size_t>(fileSize - tailStart));
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(tailStart));
+    if (sampleRate == 0 || !in.read(reinterpret_cast<char*>(buffer.data()), buffer.size())) {
+        return;
+    }
+    const unsigned char* lastPage = findBytes(buffer, "OggS", 4, true);
+    if (lastPage && lastPage + 14 <= buffer.data() + buffer.size()) {
+        uint64_t granule = uint64_t(readLittleEndian32(lastPage + 10)) << 32 | readLittleEndian32(lastPage + 6);
+        info.durationMs = static_cast<uint32_t>(granule * 1000 / sampleRate);
+    }
+}
+
+}
+
+bool readTrackInfo(const std::string& path, TrackInfo& info) {
+    if (!statFile(path, info.file)) {
+        return false;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    readId3(in, info);
+    char magic[4] = {};
+    std::streamoff audioStart = in.tellg();
+    in.read(magic, 4);
+    if (std::memcmp(magic, "fLaC", 4) == 0) {
+        readFlac(in, info);
+    } else if (audioStart == 0 && std::memcmp(magic, "OggS", 4) == 0) {
+        readOggVorbis(in, info.file.size, info);
+    }
+
+    if (info.durationMs == 0) {
+        // WAV and anything else the decoder can open knows its length from the header.
+        sf::InputSoundFile file;
+        if (file.openFromFile(path)) {
+            info.durationMs = static_cast<uint32_t>(file.getDuration().asMilliseconds());
+        }
+    }
+    return true;
+}
+
+MetadataScanner::MetadataScanner() : worker(&MetadataScanner::run, this) {}
+
+MetadataScanner::~MetadataScanner() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void MetadataScanner::request(uint32_t id, std::string path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(Job{id, generation, std::move(path)});
+    }
+    wake.notify_one();
+}
+
+void MetadataScanner::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+    finished.clear();
+    generation++;
+}
+
+std::size_t MetadataScanner::backlog() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+bool MetadataScanner::poll(std::vector<Result>& results) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (finished.empty()) {
+        return false;
+    }
+    results.swap(finished);
+    finished.clear();
+    return true;
+}
+
+void MetadataScanner::run() {
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        Result result{job.id, false, TrackInfo()};
+        result.ok = readTrackInfo(job.path, result.info);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job.generation == generation) {
+            finished.push_back(std::move(result));
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_METADATA_HPP
+#define AECROS_METADATA_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "file_info.hpp"
+
+// What the library knows about a track beyond its path.
+struct TrackInfo {
+    FileInfo file;
+    uint32_t durationMs = 0;
+    uint16_t trackNumber = 0;
+    uint16_t year = 0;
+    std::string title;
+    std::string artist;
+    std::string album;
+};
+
+// Reads ID3v2 (MP3), FLAC and Ogg Vorbis tags, and the duration from the
+// stream headers where the format allows it, falling back to the decoder.
+// Never decodes audio. Returns false only if the file cannot be read.
+bool readTrackInfo(const std::string& path, TrackInfo& info);
+
+// Reads track info on a low-priority thread. Results are collected by the
+// UI thread with poll(), so the caller's data structures are only touched there.
+class MetadataScanner {
+public:
+    struct Result {
+        uint32_t id;
+        bool ok;
+        TrackInfo info;
+    };
+
+    MetadataScanner();
+    ~MetadataScanner();
+
+    MetadataScanner(const MetadataScanner&) = delete;
+    MetadataScanner& operator=(const MetadataScanner&) = delete;
+
+    void request(uint32_t id, std::string path);
+    // Drops queued work, e.g. when the library is cleared and IDs start over.
+    void cancel();
+    std::size_t backlog();
+    // Moves finished results into results. Returns false if there were none.
+    bool poll(std::vector<Result>& results);
+
+private:
+    struct Job {
+        uint32_t id;
+        uint64_t generation;
+        std::string path;
+    };
+
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue;
+    std::vector<Result> finished;
+    uint64_t generation = 0;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif //AECROS_METADATA_HPP
@@ -0,0 +1,152 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "path_store.hpp"
+#include "file_info.hpp"
+
+namespace {
+
+bool isSeparator(char c) {
+    return c == '/' || c == '\\';
+}
+
+uint64_t componentKey(uint32_t parent, std::string_view component) {
+    return hashString(component) ^ (static_cast<uint64_t>(parent) * 0x9E3779B97F4A7C15ull);
+}
+
+}
+
+PathStore::PathStore() {
+    clear();
+}
+
+PathId PathStore::add(std::string_view path) {
+    std::size_t separator = path.find_last_of("/\\");
+    std::size_t split = separator == std::string_view::npos ? 0 : separator + 1;
+
+    fileDirectories.push_back(internDirectory(path.substr(0, split)));
+    names.append(path.data() + split, path.size() - split);
+    nameOffsets.push_back(static_cast<uint32_t>(names.size()));
+    return static_cast<PathId>(fileDirectories.size() - 1);
+}
+
+uint32_t PathStore::internDirectory(std::string_view directory) {
+    if (lastDirectoryId != NO_DIRECTORY && directory == lastDirectory) {
+        return lastDirectoryId;
+    }
+    // Walk the components, each one ending just after its separator.
+    uint32_t node = NO_DIRECTORY;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < directory.size(); ++i) {
+        if (isSeparator(directory[i])) {
+            node = internComponent(node, directory.substr(start, i + 1 - start));
+            start = i + 1;
+        }
+    }
+    lastDirectory.assign(directory.data(), directory.size());
+    lastDirectoryId = node;
+    return node;
+}
+
+uint32_t PathStore::findComponent(uint32_t parent, std::string_view component) const {
+    auto range = componentIndex.equal_range(componentKey(parent, component));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (directoryParents[it->second] == parent && slice(components, componentOffsets, it->second) == component) {
+            return it->second;
+        }
+    }
+    return NO_DIRECTORY;
+}
+
+bool PathStore::findDirectory(std::string_view directory, uint32_t& directoryId) const {
+    uint32_t node = NO_DIRECTORY;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < directory.size(); ++i) {
+        if (isSeparator(directory[i])) {
+            node = findComponent(node, directory.substr(start, i + 1 - start));
+            if (node == NO_DIRECTORY) {
+                return false;
+            }
+            start = i + 1;
+        }
+    }
+    directoryId = node;
+    return true;
+}
+
+uint32_t PathStore::internComponent(uint32_t parent, std::string_view component) {
+    uint32_t found = findComponent(parent, component);
+    if (found != NO_DIRECTORY) {
+        return found;
+    }
+    uint64_t key = componentKey(parent, component);
+    uint32_t node = static_cast<uint32_t>(directoryParents.size());
+    directoryParents.push_back(parent);
+    components.append(component.data(), component.size());
+    componentOffsets.push_back(static_cast<uint32_t>(components.size()));
+    componentIndex.emplace(key, node);
+    return node;
+}
+
+void PathStore::clear() {
+    directoryParents.clear();
+    componentOffsets.assign(1, 0);
+    components.clear();
+    componentIndex.clear();
+    fileDirectories.clear();
+    nameOffsets.assign(1, 0);
+    names.clear();
+    lastDirectory.clear();
+    lastDirectoryId = NO_DIRECTORY;
+}
+
+void PathStore::reserve(std::size_t fileCount, std::size_t nameBytes) {
+    fileDirectories.reserve(fileCount);
+    nameOffsets.reserve(fileCount + 1);
+    names.reserve(nameBytes);
+}
+
+void PathStore::shrinkToFit() {
+    directoryParents.shrink_to_fit();
+    componentOffsets.shrink_to_fit();
+    components.shrink_to_fit();
+    fileDirectories.shrink_to_fit();
+    nameOffsets.shrink_to_fit();
+    names.shrink_to_fit();
+}
+
+std::string PathStore::path(PathId id) const {
+    std::string out;
+    path(id, out);
+    return out;
+}
+
+void PathStore::path(PathId id, std::string& out) const {
+    directory(fileDirectories[id], out);
+    std::string_view name = basename(id);
+    out.append(name.data(), name.size());
+}
+
+void PathStore::directory(uint32_t directoryId, std::string& out) const {
+    // Measure first so the components can be written back to front in place.
+    std::size_t length = 0;
+    for (uint32_t node = directoryId; node != NO_DIRECTORY; node = directoryParents[node]) {
+        length += componentOffsets[node + 1] - componentOffsets[node];
+    }
+    out.resize(length);
+    for (uint32_t node = directoryId; node != NO_DIRECTORY; node = directoryParents[node]) {
+        std::string_view component = slice(components, componentOffsets, node);
+        length -= component.size();
+        out.replace(length, component.size(), component.data(), component.size());
+    }
+}
+
+std::size_t PathStore::memoryBytes() const {
+    // Index nodes are estimated: key, value, next pointer and cached hash.
+    const std::size_t indexNodeBytes = sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(void*);
+    return names.capacity() + components.capacity() +
+           (fileDirectories.capacity() + nameOffsets.capacity()) * sizeof(uint32_t) +
+           (directoryParents.capacity() + componentOffsets.capacity()) * sizeof(uint32_t) +
+           componentIndex.size() * indexNodeBytes + componentIndex.bucket_count() * sizeof(void*);
+}
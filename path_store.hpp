@@ -0,0 +1,75 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_PATH_STORE_HPP
+#define AECROS_PATH_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using PathId = uint32_t;
+
+// Append-only store for library paths. Directories form a tree where each
+// node keeps only its own component, and each file is a (directory ID,
+// basename) pair with all names packed into shared buffers. A path costs
+// roughly its basename plus eight bytes instead of a heap-allocated
+// std::string; full paths are only rebuilt when something needs one.
+class PathStore {
+public:
+    PathStore();
+
+    PathId add(std::string_view path);
+    void clear();
+    void reserve(std::size_t fileCount, std::size_t nameBytes);
+    // Drops growth slack after a bulk load.
+    void shrinkToFit();
+
+    std::size_t size() const { return fileDirectories.size(); }
+    bool empty() const { return fileDirectories.empty(); }
+
+    std::string_view basename(PathId id) const { return slice(names, nameOffsets, id); }
+    uint32_t directoryOf(PathId id) const { return fileDirectories[id]; }
+    std::string path(PathId id) const;
+    // Rebuilds into out, reusing its capacity.
+    void path(PathId id, std::string& out) const;
+    // Directory including its trailing separator, so directory + basename is the path.
+    void directory(uint32_t directoryId, std::string& out) const;
+    // Looks up an already stored directory (with its trailing separator)
+    // without adding anything; false if no stored path lives under it.
+    bool findDirectory(std::string_view directory, uint32_t& directoryId) const;
+
+    std::size_t directoryCount() const { return directoryParents.size(); }
+    std::size_t memoryBytes() const;
+
+private:
+    static const uint32_t NO_DIRECTORY = UINT32_MAX;
+
+    static std::string_view slice(const std::string& buffer, const std::vector<uint32_t>& offsets, uint32_t index) {
+        return std::string_view(buffer.data() + offsets[index], offsets[index + 1] - offsets[index]);
+    }
+    uint32_t internDirectory(std::string_view directory);
+    uint32_t internComponent(uint32_t parent, std::string_view component);
+    uint32_t findComponent(uint32_t parent, std::string_view component) const;
+
+    // Directory tree: each node is one component ending in its separator.
+    std::vector<uint32_t> directoryParents;
+    std::vector<uint32_t> componentOffsets;  // directoryCount() + 1 entries
+    std::string components;
+    // Keyed by a hash of (parent, component); collisions are resolved against the tree.
+    std::unordered_multimap<uint64_t, uint32_t> componentIndex;
+
+    std::vector<uint32_t> fileDirectories;
+    std::vector<uint32_t> nameOffsets;  // size() + 1 entries
+    std::string names;
+
+    // Imports usually add many files from the same directory in a row.
+    std::string lastDirectory;
+    uint32_t lastDirectoryId = NO_DIRECTORY;
+};
+
+#endif //AECROS_PATH_STORE_HPP
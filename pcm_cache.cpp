@@ -0,0 +1,160 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "pcm_cache.hpp"
+#include <SFML/Audio.hpp>
+#include <algorithm>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+bool decodeTrack(const std::string& path, DecodedTrack& track, std::size_t maxBytes) {
+    if (!statFile(path, track.file)) {
+        return false;
+    }
+    sf::InputSoundFile file;
+    if (!file.openFromFile(path)) {
+        return false;
+    }
+    uint64_t expected = file.getSampleCount();
+    if (expected == 0 || expected * sizeof(int16_t) > maxBytes) {
+        return false;
+    }
+    track.channelCount = file.getChannelCount();
+    track.sampleRate = file.getSampleRate();
+    track.samples.resize(static_cast<std::size_t>(expected));
+
+    // Some decoders only estimate the length, so keep reading until they stop.
+    std::size_t count = 0;
+    while (true) {
+        if (count == track.samples.size()) {
+            if ((track.samples.size() + 65536) * sizeof(int16_t) > maxBytes) {
+                return false;
+            }
+            track.samples.resize(track.samples.size() + 65536);
+        }
+        std::size_t read = static_cast<std::size_t>(file.read(track.samples.data() + count, track.samples.size() - count));
+        if (read == 0) {
+            break;
+        }
+        count += read;
+    }
+    track.samples.resize(count);
+    track.samples.shrink_to_fit();
+    return count > 0;
+}
+
+PcmCache::PcmCache(std::size_t budgetBytes) : budget(budgetBytes), worker(&PcmCache::run, this) {
+}
+
+PcmCache::~PcmCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void PcmCache::setBudget(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evictToFit(0);
+}
+
+PcmCache::Stats PcmCache::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.usedBytes = usedBytes;
+    stats.budgetBytes = budget;
+    stats.tracks = entries.size();
+    stats.hits = hits;
+    stats.misses = misses;
+    return stats;
+}
+
+std::shared_ptr<const DecodedTrack> PcmCache::find(const std::string& path) {
+    FileInfo current;
+    bool exists = statFile(path, current);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(path);
+    if (it == index.end()) {
+        ++misses;
+        return nullptr;
+    }
+    if (!exists || it->second->track->file != current) {
+        usedBytes -= it->second->track->bytes();
+        entries.erase(it->second);
+        index.erase(it);
+        ++misses;
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    ++hits;
+    return it->second->track;
+}
+
+void PcmCache::insert(const std::string& path, std::shared_ptr<const DecodedTrack> track) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!track || track->bytes() > budget) {
+        return;
+    }
+    auto it = index.find(path);
+    if (it != index.end()) {
+        usedBytes -= it->second->track->bytes();
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    evictToFit(track->bytes());
+    usedBytes += track->bytes();
+    entries.push_front(Entry{path, std::move(track)});
+    index[path] = entries.begin();
+}
+
+void PcmCache::prefill(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (budget == 0 || index.count(path) ||
+            std::find(decodeQueue.begin(), decodeQueue.end(), path) != decodeQueue.end()) {
+            return;
+        }
+        decodeQueue.push_back(path);
+    }
+    wake.notify_one();
+}
+
+void PcmCache::evictToFit(std::size_t incomingBytes) {
+    // Evicted tracks stay alive for as long as a stream still holds them.
+    while (!entries.empty() && usedBytes + incomingBytes > budget) {
+        usedBytes -= entries.back().track->bytes();
+        index.erase(entries.back().path);
+        entries.pop_back();
+    }
+}
+
+void PcmCache::run() {
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+
+    while (true) {
+        std::string path;
+        std::size_t maxBytes;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !decodeQueue.empty(); });
+            if (stopping) {
+                return;
+            }
+            path = std::move(decodeQueue.front());
+            decodeQueue.pop_front();
+            maxBytes = budget;
+        }
+
+        auto track = std::make_shared<DecodedTrack>();
+        if (decodeTrack(path, *track, maxBytes)) {
+            insert(path, std::move(track));
+        }
+    }
+}
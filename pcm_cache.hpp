@@ -0,0 +1,80 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_PCM_CACHE_HPP
+#define AECROS_PCM_CACHE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "file_info.hpp"
+
+// A whole track decoded to interleaved 16-bit PCM.
+struct DecodedTrack {
+    FileInfo file;
+    unsigned channelCount = 0;
+    unsigned sampleRate = 0;
+    std::vector<int16_t> samples;
+
+    std::size_t bytes() const { return samples.size() * sizeof(int16_t); }
+};
+
+// Fails without decoding if the track would not fit in maxBytes.
+bool decodeTrack(const std::string& path, DecodedTrack& track, std::size_t maxBytes = SIZE_MAX);
+
+// Size-bounded LRU of decoded tracks, keyed by path and validated against
+// the file's size and mtime. Tracks that are played but not cached are
+// decoded in full on a background thread so the next play starts from RAM.
+class PcmCache {
+public:
+    struct Stats {
+        std::size_t usedBytes = 0;
+        std::size_t budgetBytes = 0;
+        std::size_t tracks = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    explicit PcmCache(std::size_t budgetBytes);
+    ~PcmCache();
+
+    void setBudget(std::size_t bytes);
+    Stats getStats();
+
+    // Returns nullptr on a miss or if the file changed since it was cached.
+    std::shared_ptr<const DecodedTrack> find(const std::string& path);
+    void insert(const std::string& path, std::shared_ptr<const DecodedTrack> track);
+    void prefill(const std::string& path);
+
+private:
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const DecodedTrack> track;
+    };
+
+    void evictToFit(std::size_t incomingBytes);
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::list<Entry> entries;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    std::size_t usedBytes = 0;
+    std::size_t budget;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    std::deque<std::string> decodeQueue;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif //AECROS_PCM_CACHE_HPP
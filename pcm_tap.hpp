@@ -0,0 +1,88 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_PCM_TAP_HPP
+#define AECROS_PCM_TAP_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Wait-free single-producer / single-consumer ring. The producer drops
+// whatever does not fit instead of waiting, so a slow consumer can never
+// hold up the audio thread.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        buffer.resize(size);
+        mask = size - 1;
+    }
+
+    std::size_t write(const T* data, std::size_t count) {
+        std::size_t head = writeIndex.load(std::memory_order_relaxed);
+        std::size_t tail = readIndex.load(std::memory_order_acquire);
+        std::size_t space = buffer.size() - (head - tail);
+        count = std::min(count, space);
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer[(head + i) & mask] = data[i];
+        }
+        writeIndex.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    std::size_t read(T* data, std::size_t count) {
+        std::size_t tail = readIndex.load(std::memory_order_relaxed);
+        std::size_t head = writeIndex.load(std::memory_order_acquire);
+        count = std::min(count, head - tail);
+        for (std::size_t i = 0; i < count; ++i) {
+            data[i] = buffer[(tail + i) & mask];
+        }
+        readIndex.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    std::size_t available() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_relaxed);
+    }
+
+    // Consumer side: drop everything currently queued.
+    void discard() {
+        readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    std::vector<T> buffer;
+    std::size_t mask = 0;
+    std::atomic<std::size_t> writeIndex{0};
+    std::atomic<std::size_t> readIndex{0};
+};
+
+// Averages interleaved 16-bit frames down to one float channel in -1..1.
+inline void mixToMono(const int16_t* samples, std::size_t frameCount, unsigned channelCount, float* mono) {
+    float scale = 1.0f / (32768.0f * channelCount);
+    for (std::size_t frame = 0; frame < frameCount; ++frame) {
+        int sum = 0;
+        for (unsigned ch = 0; ch < channelCount; ++ch) {
+            sum += samples[frame * channelCount + ch];
+        }
+        mono[frame] = sum * scale;
+    }
+}
+
+// Mono copy of what the audio thread sends to the sound card, for analysis.
+// The audio thread only writes when a consumer has enabled the tap.
+struct PcmTap {
+    SpscRing<float> ring{1 << 16};
+    std::atomic<bool> enabled{false};
+    std::atomic<unsigned> sampleRate{44100};
+};
+
+#endif //AECROS_PCM_TAP_HPP
@@ -0,0 +1,311 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "play_queue.hpp"
+#include <algorithm>
+#include <numeric>
+
+PlayQueue::PlayQueue() : random(std::random_device{}()) {}
+
+void PlayQueue::setLibrary(std::size_t count) {
+    if (count < libraryCount) {
+        // Tracks were removed, so IDs past the end are gone.
+        clear();
+    }
+    libraryCount = count;
+    if (!order) {
+        trackCount = count;
+    }
+}
+
+void PlayQueue::setOrder(std::shared_ptr<const std::vector<TrackId>> newOrder) {
+    if (newOrder == order) {
+        return;
+    }
+    // While an up-next track plays, the place to keep is the interrupted track's.
+    TrackId placed = unlocated ? unlocatedTrack
+                               : (playingUpNext && position < trackCount ? trackAt(position) : currentTrack);
+    order = std::move(newOrder);
+    ownedOrder.reset();
+    trackCount = order ? order->size() : libraryCount;
+    // Keep the current track's place if it is in the new order; otherwise
+    // next() starts from the top. Finding it is a scan, so it waits until
+    // something needs it; a play() straight after makes it unnecessary.
+    unlocatedTrack = placed;
+    unlocated = placed != NO_TRACK;
+    position = trackCount > 0 ? trackCount - 1 : 0;
+    resetShuffle();
+}
+
+void PlayQueue::orderExtended() {
+    // Positions past the old end were never drawn, so the shuffle's virtual
+    // array still holds them in place and can simply grow.
+    if (order && !ownedOrder && order->size() > trackCount) {
+        trackCount = order->size();
+    }
+}
+
+void PlayQueue::clear() {
+    libraryCount = 0;
+    trackCount = 0;
+    order.reset();
+    ownedOrder.reset();
+    position = 0;
+    unlocated = false;
+    currentTrack = NO_TRACK;
+    upNext.clear();
+    playingUpNext = false;
+    resetShuffle();
+}
+
+void PlayQueue::play(TrackId track) {
+    if (track < libraryCount) {
+        playAt(track, positionOf(track));
+    }
+}
+
+void PlayQueue::play(TrackId track, std::size_t basePosition) {
+    if (track >= libraryCount) {
+        return;
+    }
+    playAt(track, basePosition < trackCount && trackAt(basePosition) == track ? basePosition : positionOf(track));
+}
+
+void PlayQueue::playAt(TrackId track, std::size_t found) {
+    currentTrack = track;
+    playingUpNext = false;
+    unlocated = false;
+    if (found == trackCount) {
+        position = trackCount > 0 ? trackCount - 1 : 0;
+        resetShuffle();
+        return;
+    }
+    position = found;
+    // Picking a track by hand starts a new shuffle from it.
+    resetShuffle();
+    if (shuffled) {
+        seedShuffle(position);
+    }
+}
+
+TrackId PlayQueue::next() {
+    TrackId track = advance();
+    // At most one lap past flagged tracks, in case they are all flagged.
+    for (std::size_t steps = 0; track != NO_TRACK && isSkipped(track); ++steps) {
+        if (steps > trackCount + upNext.size()) {
+            return NO_TRACK;
+        }
+        track = advance();
+    }
+    return track;
+}
+
+TrackId PlayQueue::previous() {
+    TrackId track = retreat();
+    for (std::size_t steps = 0; track != NO_TRACK && isSkipped(track); ++steps) {
+        if (steps > trackCount) {
+            return NO_TRACK;
+        }
+        track = retreat();
+    }
+    return track;
+}
+
+TrackId PlayQueue::advance() {
+    locate();
+    if (!upNext.empty()) {
+        currentTrack = upNext.front();
+        upNext.pop_front();
+        playingUpNext = true;
+        return currentTrack;
+    }
+    if (trackCount == 0) {
+        return NO_TRACK;
+    }
+    playingUpNext = false;
+    if (shuffled) {
+        if (shuffleHistory.empty()) {
+            drawShuffle();
+            shuffleCursor = 0;
+        } else if (shuffleCursor + 1 < shuffleHistory.size()) {
+            shuffleCursor++;
+        } else {
+            if (shuffleHistory.size() == trackCount) {
+                // Every track has been played once; start a fresh order.
+                resetShuffle();
+            }
+            drawShuffle();
+            shuffleCursor = shuffleHistory.size() - 1;
+        }
+        position = shuffleHistory[shuffleCursor];
+    } else if (currentTrack == NO_TRACK) {
+        position = 0;
+    } else {
+        position = (position + 1) % trackCount;
+    }
+    currentTrack = trackAt(position);
+    return currentTrack;
+}
+
+TrackId PlayQueue::retreat() {
+    locate();
+    if (trackCount == 0) {
+        return NO_TRACK;
+    }
+    if (playingUpNext) {
+        // Back to the track the up-next one interrupted, which is still at position.
+        playingUpNext = false;
+        currentTrack = trackAt(position);
+        return currentTrack;
+    }
+    if (shuffled && !shuffleHistory.empty()) {
+        if (shuffleCursor > 0) {
+            shuffleCursor--;
+        }
+        position = shuffleHistory[shuffleCursor];
+    } else if (!shuffled) {
+        position = (position + trackCount - 1) % trackCount;
+    }
+    currentTrack = trackAt(position);
+    return currentTrack;
+}
+
+std::vector<TrackId> PlayQueue::peek(std::size_t count) {
+    locate();
+    std::vector<TrackId> tracks;
+    for (std::size_t i = 0; i < upNext.size() && tracks.size() < count; ++i) {
+        if (!isSkipped(upNext[i])) {
+            tracks.push_back(upNext[i]);
+        }
+    }
+    if (trackCount == 0) {
+        return tracks;
+    }
+    if (shuffled) {
+        std::size_t cursor = shuffleHistory.empty() ? 0 : shuffleCursor + 1;
+        while (tracks.size() < count && cursor < trackCount) {
+            if (cursor == shuffleHistory.size()) {
+                drawShuffle();
+            }
+            TrackId track = trackAt(shuffleHistory[cursor++]);
+            if (!isSkipped(track)) {
+                tracks.push_back(track);
+            }
+        }
+    } else {
+        std::size_t start = currentTrack == NO_TRACK ? trackCount - 1 : position;
+        for (std::size_t i = 1; i < trackCount && tracks.size() < count; ++i) {
+            TrackId track = trackAt((start + i) % trackCount);
+            if (!isSkipped(track)) {
+                tracks.push_back(track);
+            }
+        }
+    }
+    return tracks;
+}
+
+void PlayQueue::enqueueNext(TrackId track) {
+    if (track < libraryCount) {
+        upNext.push_front(track);
+    }
+}
+
+void PlayQueue::setShuffle(bool enabled) {
+    if (enabled == shuffled) {
+        return;
+    }
+    locate();
+    shuffled = enabled;
+    // Turning shuffle back on resumes the order drawn so far; position keeps
+    // the current track's base position either way.
+    if (shuffled && shuffleHistory.empty() && currentTrack != NO_TRACK) {
+        seedShuffle(position);
+    }
+}
+
+void PlayQueue::move(std::size_t from, std::size_t to) {
+    if (from >= trackCount || to >= trackCount || from == to) {
+        return;
+    }
+    locate();
+    if (!ownedOrder) {
+        // Copy on first write; whoever shared the order keeps theirs unchanged.
+        if (order) {
+            ownedOrder = std::make_shared<std::vector<TrackId>>(*order);
+        } else {
+            ownedOrder = std::make_shared<std::vector<TrackId>>(trackCount);
+            std::iota(ownedOrder->begin(), ownedOrder->end(), 0);
+        }
+        order = ownedOrder;
+    }
+    std::vector<TrackId>& tracks = *ownedOrder;
+    if (from < to) {
+        std::rotate(tracks.begin() + from, tracks.begin() + from + 1, tracks.begin() + to + 1);
+    } else {
+        std::rotate(tracks.begin() + to, tracks.begin() + from, tracks.begin() + from + 1);
+    }
+
+    if (position == from) {
+        position = to;
+    } else if (from < position && position <= to) {
+        position--;
+    } else if (to <= position && position < from) {
+        position++;
+    }
+    resetShuffle();
+    if (shuffled && currentTrack != NO_TRACK) {
+        seedShuffle(position);
+    }
+}
+
+void PlayQueue::locate() {
+    if (!unlocated) {
+        return;
+    }
+    unlocated = false;
+    std::size_t found = positionOf(unlocatedTrack);
+    position = found < trackCount ? found : (trackCount > 0 ? trackCount - 1 : 0);
+}
+
+TrackId PlayQueue::trackAt(std::size_t basePosition) const {
+    return order ? (*order)[basePosition] : static_cast<TrackId>(basePosition);
+}
+
+std::size_t PlayQueue::positionOf(TrackId track) const {
+    if (!order) {
+        return track < trackCount ? track : trackCount;
+    }
+    return static_cast<std::size_t>(std::find(order->begin(), order->end(), track) - order->begin());
+}
+
+std::size_t PlayQueue::swapped(std::size_t slot) const {
+    auto found = shuffleSwaps.find(slot);
+    return found == shuffleSwaps.end() ? slot : found->second;
+}
+
+std::size_t PlayQueue::drawShuffle() {
+    // One step of Fisher-Yates over the virtual array [0, trackCount), where
+    // untouched slots hold their own index.
+    std::size_t slot = shuffleHistory.size();
+    std::uniform_int_distribution<std::size_t> pick(slot, trackCount - 1);
+    std::size_t other = pick(random);
+    std::size_t drawn = swapped(other);
+    shuffleSwaps[other] = swapped(slot);
+    shuffleSwaps.erase(slot);
+    shuffleHistory.push_back(drawn);
+    return drawn;
+}
+
+void PlayQueue::seedShuffle(std::size_t first) {
+    // Only valid on an empty shuffle, where every slot still holds its own index.
+    shuffleSwaps[first] = 0;
+    shuffleHistory.push_back(first);
+    shuffleCursor = 0;
+}
+
+void PlayQueue::resetShuffle() {
+    shuffleHistory.clear();
+    shuffleSwaps.clear();
+    shuffleCursor = 0;
+}
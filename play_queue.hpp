@@ -0,0 +1,101 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_PLAY_QUEUE_HPP
+#define AECROS_PLAY_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "track_table.hpp"
+
+// Playback order over a library of trackCount tracks, stored as IDs rather
+// than copies of the library. The base order is either implicit (position ==
+// ID) or a list shared with whoever built it, e.g. the sorted view, so
+// setLibrary(), setOrder() and play() never copy it.
+//
+// Shuffle is a Fisher-Yates pass that is only run as far as playback has
+// got: each next() draws one more position, with swaps kept in a sparse
+// map. The drawn history is kept, so previous() walks back through it and
+// turning shuffle off and on again resumes the same order.
+class PlayQueue {
+public:
+    PlayQueue();
+
+    void setLibrary(std::size_t trackCount);
+    // Plays through order instead of the library; nullptr goes back to library
+    // order. The current track's place in it is only looked up when needed.
+    void setOrder(std::shared_ptr<const std::vector<TrackId>> order);
+    // The list given to setOrder() has had tracks appended to it in place.
+    // Takes them in without moving the current track or restarting the shuffle.
+    void orderExtended();
+    void clear();
+    // Tracks flagged non-zero in removed, indexed by ID (TrackTable::removedFlags()),
+    // are passed over by next(), previous() and peek(). It must outlive the queue.
+    void setRemoved(const std::vector<uint8_t>* removed) { removedFlags = removed; }
+
+    // Starts playing track; the queue continues from its place in the base
+    // order. A track outside the order is played without moving in it.
+    // Finding the place is a scan, O(n), when the order is an explicit list.
+    void play(TrackId track);
+    // The same, with the place already known, e.g. the row clicked in the
+    // list given to setOrder(): O(1). Falls back to the scan if track is not
+    // at basePosition.
+    void play(TrackId track, std::size_t basePosition);
+    TrackId current() const { return currentTrack; }
+    TrackId next();
+    TrackId previous();
+    // Tracks that next() would return, without advancing. Draws shuffle positions as needed.
+    std::vector<TrackId> peek(std::size_t count);
+
+    void enqueueNext(TrackId track);
+    void setShuffle(bool enabled);
+    bool isShuffled() const { return shuffled; }
+
+    // Moves the track at base position from to position to. The first move
+    // copies the order, O(n); after that each move rotates the tracks between
+    // the two positions, O(|from - to|), so reordering is not O(1). Restarts
+    // the shuffle from the current track.
+    void move(std::size_t from, std::size_t to);
+    std::size_t size() const { return trackCount; }
+
+private:
+    TrackId advance();
+    TrackId retreat();
+    bool isSkipped(TrackId track) const {
+        return removedFlags && track < removedFlags->size() && (*removedFlags)[track];
+    }
+    void playAt(TrackId track, std::size_t basePosition);
+    void locate();
+    TrackId trackAt(std::size_t position) const;
+    std::size_t positionOf(TrackId track) const;
+    std::size_t swapped(std::size_t position) const;
+    std::size_t drawShuffle();
+    void resetShuffle();
+    void seedShuffle(std::size_t first);
+
+    const std::vector<uint8_t>* removedFlags = nullptr;
+    std::size_t libraryCount = 0;
+    std::size_t trackCount = 0;
+    std::shared_ptr<const std::vector<TrackId>> order;  // Null while the order is the identity
+    std::shared_ptr<std::vector<TrackId>> ownedOrder;   // Same list as order once move() has copied it
+    std::size_t position = 0;    // Base position of the current track
+    bool unlocated = false;      // setOrder() has not looked up position for unlocatedTrack yet
+    TrackId unlocatedTrack = NO_TRACK;
+    TrackId currentTrack = NO_TRACK;
+    std::deque<TrackId> upNext;  // Played before the base order resumes
+    bool playingUpNext = false;  // currentTrack came from upNext; position is still the interrupted track
+
+    bool shuffled = false;
+    std::vector<std::size_t> shuffleHistory;  // Base positions in shuffle order
+    std::size_t shuffleCursor = 0;            // Index into shuffleHistory of the current track
+    std::unordered_map<std::size_t, std::size_t> shuffleSwaps;
+    std::mt19937 random;
+};
+
+#endif //AECROS_PLAY_QUEUE_HPP
@@ -0,0 +1,514 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "playlist.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "mapped_file.hpp"
+
+namespace {
+
+bool isSeparator(char c) {
+    return c == '/' || c == '\\';
+}
+
+char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool startsWithIgnoreCase(std::string_view text, std::string_view prefix) {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < prefix.size(); ++i) {
+        if (lowerAscii(text[i]) != prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void appendUtf8(uint32_t codePoint, std::string& out) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// "#65" or "#x41" without the '#': true and the UTF-8 appended if it names
+// a character, i.e. is all digits of its base and not a surrogate or past U+10FFFF.
+bool decodeCharacterReference(std::string_view digits, std::string& out) {
+    uint32_t base = 10;
+    if (!digits.empty() && (digits[0] == 'x' || digits[0] == 'X')) {
+        base = 16;
+        digits.remove_prefix(1);
+    }
+    if (digits.empty()) {
+        return false;
+    }
+    uint32_t codePoint = 0;
+    for (char c : digits) {
+        int digit = hexValue(c);
+        if (digit < 0 || static_cast<uint32_t>(digit) >= base) {
+            return false;
+        }
+        codePoint = codePoint * base + static_cast<uint32_t>(digit);
+        if (codePoint > 0x10FFFF) {
+            return false;
+        }
+    }
+    if (codePoint == 0 || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        return false;
+    }
+    appendUtf8(codePoint, out);
+    return true;
+}
+
+// Replaces the five named XML entities and numeric references.
+void decodeXmlText(std::string_view text, std::string& out) {
+    out.clear();
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        std::size_t end;
+        if (text[i] != '&' || (end = text.find(';', i)) == std::string_view::npos) {
+            out += text[i];
+            continue;
+        }
+        std::string_view entity = text.substr(i + 1, end - i - 1);
+        if (entity == "amp") out += '&';
+        else if (entity == "lt") out += '<';
+        else if (entity == "gt") out += '>';
+        else if (entity == "quot") out += '"';
+        else if (entity == "apos") out += '\'';
+        else if (entity.size() > 1 && entity[0] == '#') {
+            // A reference that is not a valid character is kept as written.
+            if (!decodeCharacterReference(entity.substr(1), out)) {
+                out.append(text.data() + i, end + 1 - i);
+            }
+        } else {
+            out.append(text.data() + i, end + 1 - i);
+        }
+        i = end;
+    }
+}
+
+void decodePercent(std::string_view text, std::string& out) {
+    out.clear();
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        int high, low;
+        if (text[i] == '%' && i + 2 < text.size() && (high = hexValue(text[i + 1])) >= 0 &&
+            (low = hexValue(text[i + 2])) >= 0) {
+            out += static_cast<char>(high * 16 + low);
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+}
+
+// Turns playlist entries into full paths, reusing its buffers so a 50k-entry
+// playlist does not allocate per entry.
+class EntryResolver {
+public:
+    explicit EntryResolver(const std::string& playlistPath) {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(playlistPath, error);
+        directory = (error ? std::filesystem::path(playlistPath) : absolute).parent_path().string();
+        if (directory.empty() || !isSeparator(directory.back())) {
+            directory += '/';
+        }
+    }
+
+    // False for entries that are not local files, e.g. http:// streams.
+    bool resolve(std::string_view entry, bool isUri, std::string_view& out) {
+        if (startsWithIgnoreCase(entry, "file://")) {
+            entry.remove_prefix(7);
+            // Skip the host ("localhost" or empty); a drive letter follows its slash.
+            std::size_t slash = entry.find('/');
+            if (slash == std::string_view::npos) {
+                return false;
+            }
+            entry.remove_prefix(slash);
+            if (entry.size() > 2 && entry[2] == ':') {
+                entry.remove_prefix(1);
+            }
+            isUri = true;
+        } else if (entry.find("://") != std::string_view::npos) {
+            return false;
+        }
+        if (isUri) {
+            decodePercent(entry, decoded);
+            entry = decoded;
+        }
+        if (entry.empty() || namesDirectory(entry)) {
+            return false;
+        }
+
+        std::size_t rootLength = 0;
+        if (isSeparator(entry[0])) {
+            rootLength = 1;
+            resolved.assign(entry.data(), entry.size());
+        } else if (entry.size() > 2 && entry[1] == ':' && isSeparator(entry[2])) {
+            rootLength = 3;
+            resolved.assign(entry.data(), entry.size());
+        } else {
+            rootLength = 1;
+            resolved = directory;
+            resolved.append(entry.data(), entry.size());
+        }
+        normalize(rootLength);
+        out = resolved;
+        return true;
+    }
+
+private:
+    // Entries ending in a separator, "." or ".." can only be directories.
+    static bool namesDirectory(std::string_view entry) {
+        std::size_t start = entry.size();
+        while (start > 0 && !isSeparator(entry[start - 1])) {
+            --start;
+        }
+        std::string_view last = entry.substr(start);
+        return last.empty() || last == "." || last == "..";
+    }
+
+    // Drops "." and empty segments and resolves ".." in place, leaving '/'
+    // between segments. Never writes ahead of where it reads.
+    void normalize(std::size_t rootLength) {
+        segmentStarts.clear();
+        std::size_t write = rootLength;
+        std::size_t length = resolved.size();
+        for (std::size_t read = rootLength; read <= length;) {
+            std::size_t end = read;
+            while (end < length && !isSeparator(resolved[end])) {
+                ++end;
+            }
+            std::size_t segment = end - read;
+            if (segment == 0 || (segment == 1 && resolved[read] == '.')) {
+                // Nothing to keep.
+            } else if (segment == 2 && resolved[read] == '.' && resolved[read + 1] == '.') {
+                if (!segmentStarts.empty()) {
+                    write = segmentStarts.back();
+                    segmentStarts.pop_back();
+                }
+            } else {
+                segmentStarts.push_back(write);
+                if (write > rootLength) {
+                    resolved[write++] = '/';
+                }
+                std::memmove(&resolved[write], &resolved[read], segment);
+                write += segment;
+            }
+            read = end + 1;
+        }
+        resolved.resize(write);
+    }
+
+    std::string directory;
+    std::string decoded;
+    std::string resolved;
+    std::vector<std::size_t> segmentStarts;
+};
+
+template <typename Callback>
+void forEachLine(std::string_view text, Callback callback) {
+    // A UTF-8 byte order mark is common in .m3u8 files written on Windows.
+    if (text.substr(0, 3) == "\xEF\xBB\xBF") {
+        text.remove_prefix(3);
+    }
+    while (!text.empty()) {
+        const void* newline = std::memchr(text.data(), '\n', text.size());
+        std::size_t end = newline ? static_cast<const char*>(newline) - text.data() : text.size();
+        callback(trim(text.substr(0, end)));
+        text.remove_prefix(std::min(text.size(), end + 1));
+    }
+}
+
+void readM3u(std::string_view text, EntryResolver& resolver, const std::function<void(std::string_view)>& onEntry) {
+    forEachLine(text, [&](std::string_view line) {
+        std::string_view entry;
+        if (!line.empty() && line[0] != '#' && resolver.resolve(line, false, entry)) {
+            onEntry(entry);
+        }
+    });
+}
+
+// Entries are "FileN=path"; they are taken in file order rather than by N.
+void readPls(std::string_view text, EntryResolver& resolver, const std::function<void(std::string_view)>& onEntry) {
+    forEachLine(text, [&](std::string_view line) {
+        if (!startsWithIgnoreCase(line, "file")) {
+            return;
+        }
+        std::size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            return;
+        }
+        // Some writers put spaces around the '=': "File1 = song.mp3".
+        std::string_view key = trim(line.substr(0, equals));
+        if (key.size() == 4) {
+            return;
+        }
+        for (std::size_t i = 4; i < key.size(); ++i) {
+            if (key[i] < '0' || key[i] > '9') {
+                return;
+            }
+        }
+        std::string_view entry;
+        if (resolver.resolve(trim(line.substr(equals + 1)), false, entry)) {
+            onEntry(entry);
+        }
+    });
+}
+
+// Only <location> elements matter here, so they are scanned for directly
+// instead of parsing the document.
+void readXspf(std::string_view text, EntryResolver& resolver, const std::function<void(std::string_view)>& onEntry) {
+    const std::string_view open = "<location>";
+    const std::string_view close = "</location>";
+    std::string location;
+    std::size_t start = 0;
+    while ((start = text.find(open, start)) != std::string_view::npos) {
+        start += open.size();
+        std::size_t end = text.find(close, start);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        decodeXmlText(trim(text.substr(start, end - start)), location);
+        std::string_view entry;
+        if (resolver.resolve(location, true, entry)) {
+            onEntry(entry);
+        }
+        start = end + close.size();
+    }
+}
+
+// Artist and title for the playlist's display field; the file name if untagged.
+void writeDisplayTitle(std::ostream& out, const TrackTable& library, TrackId id) {
+    std::string_view title = library.title(id);
+    if (title.empty()) {
+        out << library.basename(id);
+        return;
+    }
+    std::string_view artist = library.artist(id);
+    if (!artist.empty()) {
+        out << artist << " - ";
+    }
+    out << title;
+}
+
+void writeXmlText(std::ostream& out, std::string_view text) {
+    for (char c : text) {
+        switch (c) {
+            case '&': out << "&amp;"; break;
+            case '<': out << "&lt;"; break;
+            case '>': out << "&gt;"; break;
+            case '"': out << "&quot;"; break;
+            case '\'': out << "&apos;"; break;
+            default: out << c;
+        }
+    }
+}
+
+void writeFileUri(std::ostream& out, std::string_view path) {
+    static const char HEX[] = "0123456789ABCDEF";
+    out << (path.empty() || path[0] != '/' ? "file:///" : "file://");
+    for (char c : path) {
+        bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '/' ||
+                     c == '-' || c == '.' || c == '_' || c == '~' || c == ':';
+        if (plain) {
+            out << c;
+        } else {
+            unsigned char byte = static_cast<unsigned char>(c);
+            out << '%' << HEX[byte >> 4] << HEX[byte & 0xF];
+        }
+    }
+}
+
+void writeM3u(std::ostream& out, const TrackTable& library, const std::vector<TrackId>& tracks) {
+    std::string path;
+    out << "#EXTM3U\n";
+    for (TrackId id : tracks) {
+        if (id >= library.size()) {
+            continue;
+        }
+        if (library.hasInfo(id)) {
+            out << "#EXTINF:" << (library.durationsMs()[id] + 500) / 1000 << ',';
+            writeDisplayTitle(out, library, id);
+            out << '\n';
+        }
+        library.path(id, path);
+        out << path << '\n';
+    }
+}
+
+void writePls(std::ostream& out, const TrackTable& library, const std::vector<TrackId>& tracks) {
+    std::string path;
+    std::size_t number = 0;
+    out << "[playlist]\n";
+    for (TrackId id : tracks) {
+        if (id >= library.size()) {
+            continue;
+        }
+        ++number;
+        library.path(id, path);
+        out << "File" << number << '=' << path << '\n';
+        out << "Title" << number << '=';
+        writeDisplayTitle(out, library, id);
+        out << '\n';
+        long long seconds = library.hasInfo(id) ? (library.durationsMs()[id] + 500) / 1000 : -1;
+        out << "Length" << number << '=' << seconds << '\n';
+    }
+    out << "NumberOfEntries=" << number << "\nVersion=2\n";
+}
+
+void writeXspf(std::ostream& out, const TrackTable& library, const std::vector<TrackId>& tracks) {
+    std::string path;
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+           "  <trackList>\n";
+    for (TrackId id : tracks) {
+        if (id >= library.size()) {
+            continue;
+        }
+        library.path(id, path);
+        out << "    <track><location>";
+        writeFileUri(out, path);
+        out << "</location>";
+        if (!library.title(id).empty()) {
+            out << "<title>";
+            writeXmlText(out, library.title(id));
+            out << "</title>";
+        }
+        if (!library.artist(id).empty()) {
+            out << "<creator>";
+            writeXmlText(out, library.artist(id));
+            out << "</creator>";
+        }
+        if (!library.album(id).empty()) {
+            out << "<album>";
+            writeXmlText(out, library.album(id));
+            out << "</album>";
+        }
+        if (library.hasInfo(id)) {
+            out << "<duration>" << library.durationsMs()[id] << "</duration>";
+        }
+        out << "</track>\n";
+    }
+    out << "  </trackList>\n</playlist>\n";
+}
+
+}
+
+bool playlistFormatFor(std::string_view path, PlaylistFormat& format) {
+    std::size_t dot = path.find_last_of('.');
+    if (dot == std::string_view::npos) {
+        return false;
+    }
+    std::string extension;
+    for (char c : path.substr(dot + 1)) {
+        extension += lowerAscii(c);
+    }
+    if (extension == "m3u" || extension == "m3u8") {
+        format = PlaylistFormat::M3u;
+    } else if (extension == "pls") {
+        format = PlaylistFormat::Pls;
+    } else if (extension == "xspf") {
+        format = PlaylistFormat::Xspf;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool readPlaylist(const std::string& path, const std::function<void(std::string_view entry)>& onEntry) {
+    PlaylistFormat format;
+    if (!playlistFormatFor(path, format)) {
+        return false;
+    }
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        return false;
+    }
+    EntryResolver resolver(path);
+    switch (format) {
+        case PlaylistFormat::M3u: readM3u(file.contents(), resolver, onEntry); break;
+        case PlaylistFormat::Pls: readPls(file.contents(), resolver, onEntry); break;
+        case PlaylistFormat::Xspf: readXspf(file.contents(), resolver, onEntry); break;
+    }
+    return true;
+}
+
+bool importPlaylist(const std::string& path, TrackTable& library, std::vector<TrackId>& tracks) {
+    tracks.clear();
+    return readPlaylist(path, [&](std::string_view entry) {
+        TrackId id = library.find(entry);
+        if (id == NO_TRACK) {
+            // Only entries new to the library are checked on disk. A missing
+            // file is still added, since its drive may just not be mounted.
+            std::error_code error;
+            if (std::filesystem::is_directory(std::string(entry), error)) {
+                return;
+            }
+            id = library.add(entry);
+        }
+        tracks.push_back(id);
+    });
+}
+
+bool writePlaylist(const std::string& path, const TrackTable& library, const std::vector<TrackId>& tracks) {
+    PlaylistFormat format;
+    if (!playlistFormatFor(path, format)) {
+        return false;
+    }
+    std::string tempPath = path + ".tmp";
+    {
+        std::vector<char> buffer(1 << 16);
+        std::ofstream outFile;
+        outFile.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        outFile.open(tempPath, std::ios::binary | std::ios::trunc);
+        if (!outFile) {
+            return false;
+        }
+        switch (format) {
+            case PlaylistFormat::M3u: writeM3u(outFile, library, tracks); break;
+            case PlaylistFormat::Pls: writePls(outFile, library, tracks); break;
+            case PlaylistFormat::Xspf: writeXspf(outFile, library, tracks); break;
+        }
+        outFile.flush();
+        if (!outFile) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,39 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_PLAYLIST_HPP
+#define AECROS_PLAYLIST_HPP
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "track_table.hpp"
+
+enum class PlaylistFormat {
+    M3u,   // .m3u and .m3u8; both are read and written as UTF-8
+    Pls,
+    Xspf
+};
+
+// From the file extension, case-insensitively. False for anything else.
+bool playlistFormatFor(std::string_view path, PlaylistFormat& format);
+
+// Streams a playlist's entries to onEntry in file order, as full paths with
+// relative ones resolved against the playlist's directory and file:// URIs
+// decoded. Entries that can only name a directory ("..", "dir/") and
+// streams are skipped. The file is mapped, not read into memory, and the
+// entry view is only valid during the call. False if the file could not be opened.
+bool readPlaylist(const std::string& path, const std::function<void(std::string_view entry)>& onEntry);
+
+// Reads a playlist into library IDs, adding entries the library does not
+// have yet. Lookups go through TrackTable::find, so each entry is one hash
+// probe; only entries not in the library are stat'ed, to leave out directories.
+bool importPlaylist(const std::string& path, TrackTable& library, std::vector<TrackId>& tracks);
+
+// Writes one entry at a time through the stream's buffer, to a temporary file
+// that replaces path once complete. The format comes from path's extension.
+bool writePlaylist(const std::string& path, const TrackTable& library, const std::vector<TrackId>& tracks);
+
+#endif //AECROS_PLAYLIST_HPP
@@ -0,0 +1,143 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "prefetcher.hpp"
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// linux/ioprio.h is not shipped everywhere, so spell out the bits we need.
+const int IOPRIO_CLASS_SHIFT = 13;
+const int IOPRIO_CLASS_IDLE = 3;
+const int IOPRIO_WHO_PROCESS = 1;
+
+void lowerIoPriority() {
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 10);
+#ifdef SYS_ioprio_set
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+#endif
+}
+
+// True if every page of the file's first probeBytes is in the page cache.
+bool isResident(int fd, uint64_t fileSize, uint64_t probeBytes) {
+    std::size_t length = static_cast<std::size_t>(std::min(fileSize, probeBytes));
+    if (length == 0) {
+        return false;
+    }
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> pages((length + pageSize - 1) / pageSize);
+    bool resident = mincore(mapping, length, pages.data()) == 0 &&
+                    std::all_of(pages.begin(), pages.end(), [](unsigned char page) { return page & 1; });
+    munmap(mapping, length);
+    return resident;
+}
+
+}
+
+Prefetcher::Prefetcher() : worker(&Prefetcher::run, this) {}
+
+Prefetcher::~Prefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void Prefetcher::schedule(const std::vector<std::string>& paths) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.assign(paths.begin(), paths.end());
+        stats.scheduled += paths.size();
+    }
+    wake.notify_one();
+}
+
+void Prefetcher::noteOpen(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    bool hit = fstat(fd, &info) == 0 && isResident(fd, static_cast<uint64_t>(info.st_size), PREFETCH_PROBE_BYTES);
+    close(fd);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    (hit ? stats.hits : stats.misses)++;
+}
+
+Prefetcher::Stats Prefetcher::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+uint64_t Prefetcher::warm(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return 0;
+    }
+    uint64_t length = std::min(static_cast<uint64_t>(info.st_size), PREFETCH_MAX_BYTES);
+    posix_fadvise(fd, 0, static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+
+    // readahead() blocks until the pages are queued, which keeps this thread
+    // from racing ahead of the disk. Filesystems without it get plain reads
+    // through one reused buffer instead.
+    if (readahead(fd, 0, static_cast<std::size_t>(length)) != 0) {
+        readBuffer.resize(1 << 20);
+        uint64_t done = 0;
+        while (done < length) {
+            ssize_t count = read(fd, readBuffer.data(), readBuffer.size());
+            if (count <= 0) {
+                break;
+            }
+            done += static_cast<uint64_t>(count);
+        }
+        length = done;
+    }
+    close(fd);
+    return length;
+}
+
+void Prefetcher::run() {
+    lowerIoPriority();
+
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            path = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        uint64_t bytes = warm(path);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (bytes > 0) {
+            stats.warmed++;
+            stats.bytesWarmed += bytes;
+        }
+    }
+}
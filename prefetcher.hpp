@@ -0,0 +1,57 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_PREFETCHER_HPP
+#define AECROS_PREFETCHER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const uint64_t PREFETCH_MAX_BYTES = 64ull << 20;  // Per track; long mixes only get their start warmed
+const uint64_t PREFETCH_PROBE_BYTES = 1ull << 20;  // Checked at open time to count hits
+
+// Warms the page cache for the next few queue entries so a track's first
+// reads do not wait on a slow disk or network share. Work runs on one
+// thread at idle I/O priority and is replaced wholesale on every schedule().
+class Prefetcher {
+public:
+    struct Stats {
+        uint64_t scheduled = 0;
+        uint64_t warmed = 0;
+        uint64_t bytesWarmed = 0;
+        uint64_t hits = 0;    // Opens whose first PREFETCH_PROBE_BYTES were resident
+        uint64_t misses = 0;
+    };
+
+    Prefetcher();
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    // Replaces any pending work with these paths, nearest first.
+    void schedule(const std::vector<std::string>& paths);
+    // Call just before a track is opened for playback.
+    void noteOpen(const std::string& path);
+    Stats getStats();
+
+private:
+    void run();
+    uint64_t warm(const std::string& path);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::string> pending;
+    Stats stats;
+    bool stopping = false;
+    std::vector<char> readBuffer;  // Fallback when readahead() is unsupported
+    std::thread worker;
+};
+
+#endif //AECROS_PREFETCHER_HPP
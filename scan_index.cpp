@@ -0,0 +1,502 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "scan_index.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include "file_info.hpp"
+#include "library_journal.hpp"
+#include "media_paths.hpp"
+#include "metadata.hpp"
+#include "track_table.hpp"
+#include "waveform.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Paths are small and cheap to hold, so the walk may run well ahead; tag
+// results wait for the slower stages in a shorter queue.
+const std::size_t FOUND_QUEUE_CAPACITY = 4096;
+const std::size_t TRACK_QUEUE_CAPACITY = 512;
+// Journal flushes while writing, so a run that is killed keeps most of its work.
+const uint64_t FLUSH_EVERY_TRACKS = 4096;
+
+double secondsOf(Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+// A FIFO of fixed capacity between two pipeline stages. push() blocks while
+// it is full and pop() while it is empty; once every producer has called
+// producerDone(), pop() drains what is left and then returns false.
+template <typename T>
+class BoundedQueue {
+public:
+    struct Stats {
+        std::size_t capacity = 0;
+        std::size_t peak = 0;
+        uint64_t fullStalls = 0;
+        Clock::duration producerBlocked{};  // Summed over producer threads
+        Clock::duration consumerIdle{};     // Summed over consumer threads
+    };
+
+    BoundedQueue(std::size_t capacity, unsigned producerCount) : producers(producerCount) {
+        stats.capacity = capacity;
+    }
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.size() >= stats.capacity) {
+            auto start = Clock::now();
+            notFull.wait(lock, [this] { return items.size() < stats.capacity; });
+            stats.producerBlocked += Clock::now() - start;
+            ++stats.fullStalls;
+        }
+        items.push_back(std::move(item));
+        stats.peak = std::max(stats.peak, items.size());
+        lock.unlock();
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.empty() && producers > 0) {
+            auto start = Clock::now();
+            notEmpty.wait(lock, [this] { return !items.empty() || producers == 0; });
+            stats.consumerIdle += Clock::now() - start;
+        }
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void producerDone() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (--producers == 0) {
+            lock.unlock();
+            notEmpty.notify_all();
+        }
+    }
+
+    Stats snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    unsigned producers;
+    Stats stats;
+};
+
+struct FoundFile {
+    std::string path;
+    FileInfo file;
+    bool needsTags = true;  // False when the index already has this version
+};
+
+struct ScannedTrack {
+    std::string path;
+    FileInfo file;
+    bool needsTags = true;
+    bool tagsOk = false;
+    TrackInfo info;
+    bool measuredLoudness = false;
+    TrackLoudness loudness;
+};
+
+struct StageStats {
+    std::atomic<uint64_t> items{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<int64_t> busyNs{0};
+
+    void addBusy(Clock::duration busy) {
+        busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count();
+    }
+    double busySeconds() const { return busyNs.load() / 1e9; }
+};
+
+struct LoudnessEntry {
+    FileInfo file;
+    TrackLoudness loudness;
+};
+
+using LoudnessMap = std::unordered_map<std::string, LoudnessEntry>;
+
+// One line per track: size, mtime, RMS dB, peak dB, then the path, which
+// runs to the end of the line.
+bool loadLoudness(const std::string& path, LoudnessMap& entries) {
+    std::ifstream inFile(path);
+    if (!inFile) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(inFile, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        LoudnessEntry entry;
+        std::string trackPath;
+        if (fields >> entry.file.size >> entry.file.mtime >> entry.loudness.rmsDb >> entry.loudness.peakDb &&
+            fields.get() == '\t' && std::getline(fields, trackPath)) {
+            entries[trackPath] = entry;
+        }
+    }
+    return true;
+}
+
+bool saveLoudness(const std::string& path, const LoudnessMap& entries) {
+    std::vector<const std::pair<const std::string, LoudnessEntry>*> sorted;
+    sorted.reserve(entries.size());
+    for (const auto& entry : entries) {
+        sorted.push_back(&entry);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream outFile(tempPath, std::ios::trunc);
+        if (!outFile) {
+            return false;
+        }
+        outFile << "# size\tmtime_ns\trms_db\tpeak_db\tpath\n";
+        char levels[48];
+        for (const auto* entry : sorted) {
+            std::snprintf(levels, sizeof(levels), "%.2f\t%.2f", entry->second.loudness.rmsDb,
+                          entry->second.loudness.peakDb);
+            outFile << entry->second.file.size << '\t' << entry->second.file.mtime << '\t' << levels << '\t'
+                    << entry->first << '\n';
+        }
+        if (!outFile) {
+            return false;
+        }
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+class ScanPipeline {
+public:
+    ScanPipeline(const ScanOptions& options, const std::string& indexDirectory)
+            : options(options),
+              waveformDirectory(indexDirectory + "/waveforms"),
+              jobs(options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency())),
+              found(FOUND_QUEUE_CAPACITY, 1),
+              tagged(TRACK_QUEUE_CAPACITY, jobs),
+              analysed(TRACK_QUEUE_CAPACITY, jobs) {}
+
+    // What the stages consult; must be filled in before run(), and stays
+    // read-only while it runs.
+    std::unordered_map<std::string, FileInfo> indexedFiles;
+    LoudnessMap loudness;
+    // Filled in by the writer.
+    LoudnessMap measuredLoudness;
+
+    // Runs the stages and applies their results to library and journal on
+    // the calling thread, which is the only one to touch them.
+    void run(TrackTable& library, LibraryJournal& journal);
+    void printStats(Clock::duration loadTime, Clock::duration elapsed, std::size_t librarySize);
+    bool changedLibrary() const { return tracksAdded || tracksUpdated; }
+
+private:
+    bool analysing() const { return options.waveforms || options.loudness; }
+    void walk();
+    void offer(const std::string& path);
+    void readTags();
+    void analyse();
+    BoundedQueue<ScannedTrack>& writerInput() { return analysing() ? analysed : tagged; }
+
+    const ScanOptions& options;
+    std::string waveformDirectory;
+    unsigned jobs;
+
+    BoundedQueue<FoundFile> found;
+    BoundedQueue<ScannedTrack> tagged;
+    BoundedQueue<ScannedTrack> analysed;
+
+    StageStats walkStats;
+    StageStats tagStats;
+    StageStats analysisStats;
+    uint64_t filesSeen = 0;  // Walk thread only until it has finished
+    std::atomic<uint64_t> unchanged{0};
+    uint64_t tracksAdded = 0;  // Writer
+    uint64_t tracksUpdated = 0;
+    uint64_t tagFailures = 0;
+    uint64_t waveformsWritten = 0;
+    uint64_t loudnessMeasured = 0;
+    std::atomic<uint64_t> analysisFailures{0};
+};
+
+void ScanPipeline::run(TrackTable& library, LibraryJournal& journal) {
+    std::vector<std::thread> threads;
+    threads.emplace_back(&ScanPipeline::walk, this);
+    for (unsigned i = 0; i < jobs; ++i) {
+        threads.emplace_back(&ScanPipeline::readTags, this);
+    }
+    if (analysing()) {
+        std::error_code error;
+        std::filesystem::create_directories(waveformDirectory, error);
+        for (unsigned i = 0; i < jobs; ++i) {
+            threads.emplace_back(&ScanPipeline::analyse, this);
+        }
+    }
+
+    ScannedTrack track;
+    uint64_t sinceFlush = 0;
+    while (writerInput().pop(track)) {
+        if (track.measuredLoudness) {
+            measuredLoudness[track.path] = LoudnessEntry{track.file, track.loudness};
+            ++loudnessMeasured;
+        }
+        if (!track.needsTags) {
+            continue;
+        }
+        TrackId id = library.find(track.path);
+        if (id == NO_TRACK) {
+            id = library.add(track.path);
+            journal.recordAdd(track.path);
+            ++tracksAdded;
+        } else {
+            ++tracksUpdated;
+        }
+        if (track.tagsOk) {
+            library.setInfo(id, track.info);
+            journal.recordInfo(id, track.info);
+        } else {
+            ++tagFailures;
+        }
+        if (++sinceFlush == FLUSH_EVERY_TRACKS) {
+            journal.flush();
+            sinceFlush = 0;
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ScanPipeline::walk() {
+    auto start = Clock::now();
+    for (const auto& root : options.roots) {
+        std::error_code error;
+        std::filesystem::path base = std::filesystem::absolute(root, error).lexically_normal();
+        if (std::filesystem::is_regular_file(base, error)) {
+            offer(base.string());
+            continue;
+        }
+        std::filesystem::recursive_directory_iterator it(
+                base, std::filesystem::directory_options::skip_permission_denied, error);
+        if (error) {
+            std::cerr << "Cannot scan " << root << ": " << error.message() << std::endl;
+            continue;
+        }
+        for (std::filesystem::recursive_directory_iterator end; it != end; it.increment(error)) {
+            if (error) {
+                std::cerr << "Stopped scanning " << root << ": " << error.message() << std::endl;
+                break;
+            }
+            // A separate code, so one unreadable entry does not end the walk.
+            std::error_code entryError;
+            if (it->is_regular_file(entryError)) {
+                std::string path = it->path().string();
+                if (isAudioFilePath(path)) {
+                    offer(path);
+                }
+            }
+        }
+    }
+    walkStats.addBusy(Clock::now() - start);
+    found.producerDone();
+}
+
+void ScanPipeline::offer(const std::string& path) {
+    FoundFile item;
+    if (!statFile(path, item.file)) {
+        return;
+    }
+    ++filesSeen;
+    auto indexed = indexedFiles.find(path);
+    item.needsTags = indexed == indexedFiles.end() || indexed->second != item.file;
+    if (!item.needsTags && !analysing()) {
+        ++unchanged;
+        return;
+    }
+    item.path = path;
+    ++walkStats.items;
+    walkStats.bytes += item.file.size;
+    found.push(std::move(item));
+}
+
+void ScanPipeline::readTags() {
+    Clock::duration busy{};
+    FoundFile item;
+    while (found.pop(item)) {
+        ScannedTrack track;
+        track.path = std::move(item.path);
+        track.file = item.file;
+        track.needsTags = item.needsTags;
+        if (track.needsTags) {
+            auto start = Clock::now();
+            track.tagsOk = readTrackInfo(track.path, track.info);
+            busy += Clock::now() - start;
+            ++tagStats.items;
+            tagStats.bytes += track.file.size;
+        }
+        tagged.push(std::move(track));
+    }
+    tagStats.addBusy(busy);
+    tagged.producerDone();
+}
+
+void ScanPipeline::analyse() {
+    Clock::duration busy{};
+    ScannedTrack track;
+    WaveformSummary summary;
+    while (tagged.pop(track)) {
+        std::string cachePath = waveformCachePath(waveformDirectory, track.path);
+        bool wantWaveform = options.waveforms && !loadWaveform(cachePath, track.file, summary);
+        auto known = loudness.find(track.path);
+        bool wantLoudness = options.loudness && (known == loudness.end() || known->second.file != track.file);
+        if (wantWaveform || wantLoudness) {
+            auto start = Clock::now();
+            if (computeWaveform(track.path, summary, wantLoudness ? &track.loudness : nullptr)) {
+                track.measuredLoudness = wantLoudness;
+                if (wantWaveform && !saveWaveform(cachePath, summary)) {
+                    std::cerr << "Could not write waveform cache: " << cachePath << std::endl;
+                }
+            } else {
+                ++analysisFailures;
+            }
+            busy += Clock::now() - start;
+            ++analysisStats.items;
+            analysisStats.bytes += track.file.size;
+        } else if (!track.needsTags) {
+            // Nothing new about this file at all.
+            ++unchanged;
+            continue;
+        }
+        analysed.push(std::move(track));
+    }
+    analysisStats.addBusy(busy);
+    analysed.producerDone();
+}
+
+template <typename T>
+void printQueue(const char* name, BoundedQueue<T>& queue) {
+    auto stats = queue.snapshot();
+    std::printf("  queue %-15s peak %5zu/%zu, full %llu times, producers blocked %.2f s, consumers idle %.2f s\n",
+                name, stats.peak, stats.capacity, static_cast<unsigned long long>(stats.fullStalls),
+                secondsOf(stats.producerBlocked), secondsOf(stats.consumerIdle));
+}
+
+void printStage(const char* name, const StageStats& stats, unsigned threads, double elapsed) {
+    double busy = stats.busySeconds();
+    std::printf("  %-9s %2u thread%s %8llu files %9.1f files/s %8.1f MB/s  busy %.2f thread-s (%.0f%%)\n",
+                name, threads, threads == 1 ? " " : "s", static_cast<unsigned long long>(stats.items.load()),
+                elapsed > 0 ? stats.items / elapsed : 0.0, elapsed > 0 ? stats.bytes / elapsed / 1e6 : 0.0, busy,
+                elapsed > 0 ? 100.0 * busy / (elapsed * threads) : 0.0);
+}
+
+void ScanPipeline::printStats(Clock::duration loadTime, Clock::duration elapsed, std::size_t librarySize) {
+    double seconds = secondsOf(elapsed);
+    uint64_t bytes = tagStats.bytes;
+    std::printf("Scanned %llu files in %.2f s (index loaded in %.2f s): %llu added, %llu updated, %llu unchanged\n",
+                static_cast<unsigned long long>(filesSeen), seconds, secondsOf(loadTime),
+                static_cast<unsigned long long>(tracksAdded), static_cast<unsigned long long>(tracksUpdated),
+                static_cast<unsigned long long>(unchanged.load()));
+    printStage("walk", walkStats, 1, seconds);
+    printStage("tags", tagStats, jobs, seconds);
+    if (analysing()) {
+        printStage("analysis", analysisStats, jobs, seconds);
+    }
+    printQueue("walk->tags", found);
+    if (analysing()) {
+        printQueue("tags->analysis", tagged);
+        printQueue("analysis->index", analysed);
+    } else {
+        printQueue("tags->index", tagged);
+    }
+    if (tagFailures || analysisFailures) {
+        std::printf("  unreadable: %llu tags, %llu decodes\n", static_cast<unsigned long long>(tagFailures),
+                    static_cast<unsigned long long>(analysisFailures.load()));
+    }
+    if (options.loudness) {
+        std::printf("  loudness measured for %llu tracks\n", static_cast<unsigned long long>(loudnessMeasured));
+    }
+    std::printf("Throughput: %.1f files/s, %.1f MB/s; library now has %zu tracks\n",
+                seconds > 0 ? filesSeen / seconds : 0.0, seconds > 0 ? bytes / seconds / 1e6 : 0.0, librarySize);
+    std::fflush(stdout);
+}
+
+}
+
+int runScanIndex(const ScanOptions& options) {
+    auto start = Clock::now();
+    std::filesystem::path indexPath(options.index);
+    std::string indexDirectory =
+            indexPath.filename() == "library.snapshot" ? indexPath.parent_path().string() : indexPath.string();
+    if (indexDirectory.empty()) {
+        indexDirectory = ".";
+    }
+
+    TrackTable library;
+    ScanPipeline pipeline(options, indexDirectory);
+    int exitCode = 0;
+    {
+        LibraryJournal journal(indexDirectory);
+        journal.load(library);
+        // Nothing found here could be saved while another process has the library.
+        if (journal.isReadOnly()) {
+            return 1;
+        }
+        for (TrackId id = 0; id < library.size(); ++id) {
+            if (library.hasInfo(id)) {
+                pipeline.indexedFiles[library.path(id)] = FileInfo{library.fileSizes()[id], library.modifiedTimes()[id]};
+            }
+        }
+        std::string loudnessPath = indexDirectory + "/loudness.tsv";
+        if (options.loudness) {
+            loadLoudness(loudnessPath, pipeline.loudness);
+        }
+        auto loaded = Clock::now();
+
+        pipeline.run(library, journal);
+
+        // One snapshot for the whole run; the destructor waits for it to be written.
+        journal.flush();
+        if (pipeline.changedLibrary()) {
+            journal.compact();
+        }
+        for (auto& entry : pipeline.measuredLoudness) {
+            pipeline.loudness[entry.first] = entry.second;
+        }
+        if (options.loudness && !saveLoudness(loudnessPath, pipeline.loudness)) {
+            std::cerr << "Could not write " << loudnessPath << std::endl;
+            exitCode = 1;
+        }
+        pipeline.printStats(loaded - start, Clock::now() - loaded, library.trackCount());
+    }
+    return exitCode;
+}
@@ -0,0 +1,32 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_SCAN_INDEX_HPP
+#define AECROS_SCAN_INDEX_HPP
+
+#include <string>
+#include <vector>
+
+struct ScanOptions {
+    std::vector<std::string> roots;
+    // The library directory (what media/ is to the app). A path naming
+    // library.snapshot itself is taken to mean its directory.
+    std::string index;
+    bool waveforms = false;  // Into <index>/waveforms, where the app looks for them
+    bool loudness = false;   // Into <index>/loudness.tsv
+    unsigned jobs = 0;       // Threads per parallel stage; 0 for one per core
+};
+
+// Builds or updates a library index without a window, as a pipeline:
+//
+//   walk (1 thread) -> tags (jobs) -> [analysis (jobs)] -> index writer (1)
+//
+// with a bounded queue between stages, so a slow stage holds back the ones
+// before it instead of the backlog filling memory. Files whose size and
+// modification time match the existing index are not read again; tracks
+// that have gone from disk are kept. Throughput and queue statistics go to
+// stdout when done. Returns the process exit code.
+int runScanIndex(const ScanOptions& options);
+
+#endif //AECROS_SCAN_INDEX_HPP
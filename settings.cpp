@@ -0,0 +1,128 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "settings.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const char* const FILTER_TYPE_NAMES[] = {"peaking", "low_shelf", "high_shelf", "low_pass", "high_pass"};
+const char* const BAND_KEY = "dsp_band_";
+
+bool parseFilterType(const std::string& name, FilterType& type) {
+    for (std::size_t i = 0; i < std::size(FILTER_TYPE_NAMES); ++i) {
+        if (name == FILTER_TYPE_NAMES[i]) {
+            type = static_cast<FilterType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// "dsp_band_<index>=<type> <frequency> <gain dB> <Q>"; false leaves the band as it was.
+bool parseBand(const std::string& value, EqBand& band) {
+    std::istringstream fields(value);
+    std::string typeName;
+    EqBand parsed;
+    if (!(fields >> typeName >> parsed.frequency >> parsed.gainDb >> parsed.q) ||
+        !parseFilterType(typeName, parsed.type) || !(parsed.frequency > 0) || !(parsed.q > 0) ||
+        !std::isfinite(parsed.frequency) || !std::isfinite(parsed.gainDb) || !std::isfinite(parsed.q)) {
+        return false;
+    }
+    band = parsed;
+    return true;
+}
+
+}
+
+AppSettings loadSettings(const std::string& path) {
+    AppSettings settings;
+    std::ifstream inFile(path);
+    std::string line;
+    while (std::getline(inFile, line)) {
+        std::size_t separator = line.find('=');
+        if (separator == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, separator);
+        std::string value = line.substr(separator + 1);
+        try {
+            if (key == "pcm_cache_mb") {
+                settings.pcmCacheMb = std::stoul(value);
+            } else if (key == "prefetch_tracks") {
+                settings.prefetchTracks = std::stoul(value);
+            } else if (key == "resume_path") {
+                settings.resumePath = value;
+            } else if (key == "resume_position_ms") {
+                settings.resumePositionMs = static_cast<uint32_t>(std::stoul(value));
+            } else if (key == "dsp_preamp_db") {
+                settings.dsp.preampDb = std::stof(value);
+            } else if (key == "dsp_limiter") {
+                settings.dsp.limiterEnabled = value == "1";
+            } else if (key == "dsp_limiter_ceiling_db") {
+                settings.dsp.limiterCeilingDb = std::stof(value);
+            } else if (key == "dsp_limiter_release_ms") {
+                settings.dsp.limiterReleaseMs = std::stof(value);
+            } else if (key == "dsp_room_correction") {
+                settings.dsp.roomCorrectionEnabled = value == "1";
+            } else if (key == "dsp_impulse_response") {
+                settings.impulseResponsePath = value;
+            } else if (key == "dsp_band_count") {
+                settings.dsp.bandCount = static_cast<int>(std::min<unsigned long>(std::stoul(value), MAX_EQ_BANDS));
+            } else if (key.compare(0, std::strlen(BAND_KEY), BAND_KEY) == 0) {
+                std::size_t index = std::stoul(key.substr(std::strlen(BAND_KEY)));
+                if (index >= MAX_EQ_BANDS || !parseBand(value, settings.dsp.bands[index])) {
+                    std::cerr << "Ignoring bad setting: " << line << std::endl;
+                }
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Ignoring bad setting: " << line << std::endl;
+        }
+    }
+    return settings;
+}
+
+void saveSettings(const std::string& path, const AppSettings& settings) {
+    std::ofstream outFile(path, std::ofstream::out | std::ofstream::trunc);
+    if (!outFile.is_open()) {
+        std::cerr << "Could not open file for writing: " << path << std::endl;
+        return;
+    }
+    outFile << "pcm_cache_mb=" << settings.pcmCacheMb << '\n';
+    outFile << "prefetch_tracks=" << settings.prefetchTracks << '\n';
+    outFile << "resume_path=" << settings.resumePath << '\n';
+    outFile << "resume_position_ms=" << settings.resumePositionMs << '\n';
+
+    const DspSettings& dsp = settings.dsp;
+    outFile << "dsp_preamp_db=" << dsp.preampDb << '\n';
+    outFile << "dsp_limiter=" << (dsp.limiterEnabled ? 1 : 0) << '\n';
+    outFile << "dsp_limiter_ceiling_db=" << dsp.limiterCeilingDb << '\n';
+    outFile << "dsp_limiter_release_ms=" << dsp.limiterReleaseMs << '\n';
+    outFile << "dsp_room_correction=" << (dsp.roomCorrectionEnabled ? 1 : 0) << '\n';
+    outFile << "dsp_impulse_response=" << settings.impulseResponsePath << '\n';
+    outFile << "dsp_band_count=" << dsp.bandCount << '\n';
+    for (int i = 0; i < dsp.bandCount; ++i) {
+        const EqBand& band = dsp.bands[i];
+        outFile << BAND_KEY << i << '=' << FILTER_TYPE_NAMES[static_cast<int>(band.type)] << ' ' << band.frequency
+                << ' ' << band.gainDb << ' ' << band.q << '\n';
+    }
+}
+
+std::shared_ptr<const ImpulseResponse> loadRoomCorrection(AppSettings& settings) {
+    if (!settings.impulseResponsePath.empty()) {
+        auto impulseResponse = std::make_shared<ImpulseResponse>();
+        if (loadImpulseResponse(settings.impulseResponsePath, *impulseResponse)) {
+            return impulseResponse;
+        }
+        settings.impulseResponsePath.clear();
+    }
+    settings.dsp.roomCorrectionEnabled = false;
+    return nullptr;
+}
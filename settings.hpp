@@ -0,0 +1,36 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_SETTINGS_HPP
+#define AECROS_SETTINGS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "convolver.hpp"
+#include "dsp.hpp"
+
+struct AppSettings {
+    std::size_t pcmCacheMb = 512;
+    std::size_t prefetchTracks = 3;  // Upcoming queue entries to warm in the page cache
+    // Last track played and where it was stopped, offered again at startup.
+    std::string resumePath;
+    uint32_t resumePositionMs = 0;
+    // EQ, preamp and limiter, shared by both frontends.
+    DspSettings dsp = defaultDspSettings();
+    // WAV file for the room correction convolver; dsp.roomCorrectionEnabled needs one.
+    std::string impulseResponsePath;
+};
+
+// Plain key=value lines; unknown keys are ignored so older builds can read newer files.
+AppSettings loadSettings(const std::string& path);
+void saveSettings(const std::string& path, const AppSettings& settings);
+
+// Reads settings.impulseResponsePath for a frontend starting up. If there is
+// none or it cannot be read, room correction is switched off in settings.dsp
+// and nullptr comes back.
+std::shared_ptr<const ImpulseResponse> loadRoomCorrection(AppSettings& settings);
+
+#endif //AECROS_SETTINGS_HPP
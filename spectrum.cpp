@@ -0,0 +1,136 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "spectrum.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+const float MIN_FREQUENCY = 30.0f;
+const float MAX_FREQUENCY = 20000.0f;
+const float DB_RANGE = 90.0f;
+
+// Highest magnitude of the FFT bins covering [low, high) Hz.
+float peakInBand(const std::vector<float>& magnitudes, float low, float high, unsigned sampleRate) {
+    float binWidth = static_cast<float>(sampleRate) / SPECTRUM_FFT_SIZE;
+    std::size_t first = static_cast<std::size_t>(low / binWidth);
+    std::size_t last = std::max(first + 1, static_cast<std::size_t>(std::ceil(high / binWidth)));
+    last = std::min(last, magnitudes.size());
+    float peak = 0.0f;
+    for (std::size_t k = first; k < last; ++k) {
+        peak = std::max(peak, magnitudes[k]);
+    }
+    return peak;
+}
+
+float toLevel(float magnitude) {
+    float db = 20.0f * std::log10(magnitude + 1e-9f);
+    return std::max(0.0f, std::min(1.0f, (db + DB_RANGE) / DB_RANGE));
+}
+
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(PcmTap& tap)
+    : tap(tap), fft(SPECTRUM_FFT_SIZE), hannWindow(SPECTRUM_FFT_SIZE), history(SPECTRUM_FFT_SIZE, 0.0f),
+      windowed(SPECTRUM_FFT_SIZE), spectrumRe(SPECTRUM_FFT_SIZE / 2 + 1), spectrumIm(SPECTRUM_FFT_SIZE / 2 + 1),
+      magnitudes(SPECTRUM_FFT_SIZE / 2 + 1) {
+    const double pi = 3.14159265358979323846;
+    for (std::size_t i = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        hannWindow[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / SPECTRUM_FFT_SIZE));
+    }
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    stop();
+}
+
+void SpectrumAnalyzer::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    tap.ring.discard();
+    tap.enabled = true;
+    worker = std::thread(&SpectrumAnalyzer::run, this);
+}
+
+void SpectrumAnalyzer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    tap.enabled = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool SpectrumAnalyzer::poll(SpectrumFrame& frame) {
+    frames.update();
+    const SpectrumFrame& latest = frames.read();
+    if (latest.sequence == lastSequence) {
+        return false;
+    }
+    lastSequence = latest.sequence;
+    frame = latest;
+    return true;
+}
+
+void SpectrumAnalyzer::run() {
+    std::vector<float> incoming(SPECTRUM_FFT_SIZE);
+    std::fill(history.begin(), history.end(), 0.0f);
+
+    while (running.load()) {
+        unsigned sampleRate = std::max(1u, tap.sampleRate.load());
+        std::size_t hop = std::max<std::size_t>(1, sampleRate / SPECTRUM_FRAMES_PER_SECOND);
+        std::size_t available = tap.ring.available();
+        if (available < hop) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(4));
+            continue;
+        }
+
+        // If we fell behind, skip straight to the most recent window.
+        while (available > SPECTRUM_FFT_SIZE + hop) {
+            available -= tap.ring.read(incoming.data(), std::min(incoming.size(), available - SPECTRUM_FFT_SIZE));
+        }
+
+        std::size_t count = tap.ring.read(incoming.data(), std::min(hop, incoming.size()));
+        std::copy(history.begin() + count, history.end(), history.begin());
+        std::copy(incoming.begin(), incoming.begin() + count, history.end() - count);
+
+        SpectrumFrame frame;
+        frame.sequence = ++producedSequence;
+        analyze(history.data(), sampleRate, frame);
+        frames.write(frame);
+    }
+}
+
+void SpectrumAnalyzer::analyze(const float* window, unsigned sampleRate, SpectrumFrame& frame) {
+    for (std::size_t i = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        windowed[i] = window[i] * hannWindow[i];
+    }
+    fft.forward(windowed.data(), spectrumRe.data(), spectrumIm.data());
+
+    // A full-scale sine reads as 0 dB: the Hann window sums to N / 2.
+    float scale = 4.0f / SPECTRUM_FFT_SIZE;
+    for (std::size_t k = 0; k < magnitudes.size(); ++k) {
+        magnitudes[k] = std::sqrt(spectrumRe[k] * spectrumRe[k] + spectrumIm[k] * spectrumIm[k]) * scale;
+    }
+
+    float maxFrequency = std::min(MAX_FREQUENCY, sampleRate * 0.5f);
+    float ratio = maxFrequency / MIN_FREQUENCY;
+    for (int b = 0; b < SPECTRUM_BARS; ++b) {
+        float low = MIN_FREQUENCY * std::pow(ratio, static_cast<float>(b) / SPECTRUM_BARS);
+        float high = MIN_FREQUENCY * std::pow(ratio, static_cast<float>(b + 1) / SPECTRUM_BARS);
+        float level = toLevel(peakInBand(magnitudes, low, high, sampleRate));
+        // Bars jump up instantly and fall back slowly, which reads better than raw frames.
+        smoothedBars[b] = std::max(level, smoothedBars[b] * 0.92f);
+        frame.bars[b] = smoothedBars[b];
+    }
+    for (int row = 0; row < SPECTROGRAM_ROWS; ++row) {
+        float low = MIN_FREQUENCY * std::pow(ratio, static_cast<float>(row) / SPECTROGRAM_ROWS);
+        float high = MIN_FREQUENCY * std::pow(ratio, static_cast<float>(row + 1) / SPECTROGRAM_ROWS);
+        frame.column[row] = toLevel(peakInBand(magnitudes, low, high, sampleRate));
+    }
+}
@@ -0,0 +1,63 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_SPECTRUM_HPP
+#define AECROS_SPECTRUM_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "fft.hpp"
+#include "pcm_tap.hpp"
+#include "triple_buffer.hpp"
+
+const std::size_t SPECTRUM_FFT_SIZE = 4096;
+const int SPECTRUM_BARS = 64;
+const int SPECTROGRAM_ROWS = 256;
+const int SPECTRUM_FRAMES_PER_SECOND = 60;
+
+// One analysis result. Levels are normalised to 0..1 over a 90 dB range and
+// laid out on a log-frequency axis, lowest frequency first.
+struct SpectrumFrame {
+    uint64_t sequence = 0;
+    float bars[SPECTRUM_BARS] = {};
+    float column[SPECTROGRAM_ROWS] = {};
+};
+
+// Reads the output tap on its own thread, runs Hann-windowed FFTs about
+// sixty times a second and publishes the latest frame without locking.
+class SpectrumAnalyzer {
+public:
+    explicit SpectrumAnalyzer(PcmTap& tap);
+    ~SpectrumAnalyzer();
+
+    void start();
+    void stop();
+    bool isRunning() const { return running.load(); }
+
+    // UI thread: returns true and fills frame if a new result is available.
+    bool poll(SpectrumFrame& frame);
+
+    // Analyse one window directly; used by the worker thread.
+    void analyze(const float* window, unsigned sampleRate, SpectrumFrame& frame);
+
+private:
+    void run();
+
+    PcmTap& tap;
+    RealFft fft;
+    std::vector<float> hannWindow;
+    std::vector<float> history;
+    std::vector<float> windowed;
+    std::vector<float> spectrumRe, spectrumIm, magnitudes;
+    float smoothedBars[SPECTRUM_BARS] = {};
+    TripleBuffer<SpectrumFrame> frames;
+    uint64_t lastSequence = 0;       // UI thread only
+    uint64_t producedSequence = 0;   // Worker only; keeps counting across restarts
+    std::atomic<bool> running{false};
+    std::thread worker;
+};
+
+#endif //AECROS_SPECTRUM_HPP
@@ -0,0 +1,267 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "startup_bench.hpp"
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include "library_journal.hpp"
+#include "pcm_cache.hpp"
+#include "prefetcher.hpp"
+#include "track_loader.hpp"
+#include "track_table.hpp"
+
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const auto FRAME_LOAD_BUDGET = std::chrono::milliseconds(6);  // Same as updateLibraryLoad()
+const char* const FONT_PATHS[] = {"arial.ttf", "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"};
+const char* const ICON_NAMES[] = {"play.png", "pause.png", "next.png", "previous.png"};
+
+double millisecondsBetween(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Time from the kernel creating the process to now, or -1 where /proc is
+// not available. Covers the dynamic loader and static initialisers.
+double processAgeMs() {
+    std::ifstream statFile("/proc/self/stat");
+    std::ifstream uptimeFile("/proc/uptime");
+    std::string stat;
+    double uptime = 0;
+    if (!std::getline(statFile, stat) || !(uptimeFile >> uptime)) {
+        return -1;
+    }
+    // Field 22 is the start time in clock ticks; count from after the
+    // command name, which may itself contain spaces.
+    std::size_t close = stat.rfind(')');
+    if (close == std::string::npos) {
+        return -1;
+    }
+    std::istringstream fields(stat.substr(close + 2));
+    std::string field;
+    for (int i = 3; i < 22 && fields >> field; ++i) {
+    }
+    unsigned long long startTicks = 0;
+    if (!(fields >> startTicks)) {
+        return -1;
+    }
+    return (uptime - static_cast<double>(startTicks) / sysconf(_SC_CLK_TCK)) * 1000.0;
+}
+
+// Five seconds of a 440 Hz tone, standing in for the track being resumed.
+bool writeTestTone(const std::string& path) {
+    const uint32_t sampleRate = 44100;
+    const uint16_t channels = 2;
+    const uint32_t frames = sampleRate * 5;
+    const uint32_t dataBytes = frames * channels * sizeof(int16_t);
+
+    std::ofstream outFile(path, std::ios::binary | std::ios::trunc);
+    auto put32 = [&outFile](uint32_t value) { outFile.write(reinterpret_cast<const char*>(&value), 4); };
+    auto put16 = [&outFile](uint16_t value) { outFile.write(reinterpret_cast<const char*>(&value), 2); };
+    outFile.write("RIFF", 4);
+    put32(36 + dataBytes);
+    outFile.write("WAVEfmt ", 8);
+    put32(16);
+    put16(1);
+    put16(channels);
+    put32(sampleRate);
+    put32(sampleRate * channels * sizeof(int16_t));
+    put16(channels * sizeof(int16_t));
+    put16(16);
+    outFile.write("data", 4);
+    put32(dataBytes);
+    for (uint32_t frame = 0; frame < frames; ++frame) {
+        int16_t sample = static_cast<int16_t>(8000 * std::sin(2 * M_PI * 440 * frame / sampleRate));
+        put16(static_cast<uint16_t>(sample));
+        put16(static_cast<uint16_t>(sample));
+    }
+    return static_cast<bool>(outFile);
+}
+
+// A tagged library of trackCount rows, stored as one compacted snapshot the
+// way a long-running install ends up. Paths do not need to exist.
+void generateLibrary(const std::string& directory, std::size_t trackCount) {
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    LibraryJournal journal(directory);
+    TrackTable table;
+    journal.load(table);
+
+    char path[128];
+    char title[64];
+    TrackInfo info;
+    for (std::size_t i = 0; i < trackCount; ++i) {
+        std::snprintf(path, sizeof(path), "/bench/Artist %04zu/Album %03zu/%02zu Track %07zu.flac", i % 5000,
+                      (i / 12) % 400, i % 12 + 1, i);
+        std::snprintf(title, sizeof(title), "Track %07zu", i);
+        info.title = title;
+        info.artist = "Artist " + std::to_string(i % 5000);
+        info.album = "Album " + std::to_string((i / 12) % 400);
+        info.trackNumber = static_cast<uint16_t>(i % 12 + 1);
+        info.durationMs = static_cast<uint32_t>(120000 + (i * 7919) % 240000);
+        journal.recordAdd(path);
+        journal.recordInfo(static_cast<TrackId>(i), info);
+    }
+    journal.flush();
+    // The destructor waits for the snapshot to be written.
+    journal.compact();
+}
+
+// Icons are looked up the way findProjectRoot() does, walking up from the
+// working directory.
+std::string findIconDirectory() {
+    std::filesystem::path current = std::filesystem::current_path();
+    while (true) {
+        if (std::filesystem::exists(current / "icons" / ICON_NAMES[0])) {
+            return (current / "icons").string();
+        }
+        if (!current.has_parent_path() || current.parent_path() == current) {
+            return "";
+        }
+        current = current.parent_path();
+    }
+}
+
+struct RunResult {
+    std::size_t trackCount = 0;
+    std::size_t loadedTracks = 0;
+    bool assetsFound = false;
+    std::vector<std::pair<const char*, double>> milestones;
+    std::size_t frames = 0;
+    double longestFrameMs = 0;
+};
+
+// Mirrors openMainWindow(): background work first, then assets, then frames
+// that each apply up to FRAME_LOAD_BUDGET of library and build the rows.
+// Frames stop short of laying out and drawing the rows, which needs a
+// window; aecros_bench's list/ cases time that part.
+RunResult runOnce(const std::string& directory, const std::string& tonePath, std::size_t trackCount) {
+    RunResult result;
+    result.trackCount = trackCount;
+    Clock::time_point start = Clock::now();
+    auto mark = [&](const char* name) { result.milestones.emplace_back(name, millisecondsBetween(start, Clock::now())); };
+
+    PcmCache pcmCache(0);
+    Prefetcher prefetcher;
+    TrackLoader trackLoader(pcmCache, prefetcher);
+    LibraryJournal journal(directory);
+    TrackTable library;
+    journal.startLoad();
+    trackLoader.request(tonePath);
+    mark("backgroundStarted");
+
+    // Images rather than textures: there is no GL context headless.
+    std::string iconDirectory = findIconDirectory();
+    result.assetsFound = !iconDirectory.empty();
+    sf::Image icon;
+    for (const char* name : ICON_NAMES) {
+        result.assetsFound = result.assetsFound && icon.loadFromFile(iconDirectory + "/" + name);
+    }
+    sf::Font font;
+    bool fontFound = false;
+    for (const char* path : FONT_PATHS) {
+        fontFound = fontFound || font.loadFromFile(path);
+    }
+    result.assetsFound = result.assetsFound && fontFound;
+    mark("assetsLoaded");
+
+    bool loading = true;
+    bool audioReady = false;
+    bool sawRows = false;
+    std::vector<TrackId> rows;
+    while (loading || !audioReady) {
+        Clock::time_point frameStart = Clock::now();
+        if (loading) {
+            loading = journal.applyLoaded(library, FRAME_LOAD_BUDGET);
+            library.search("", rows);
+        }
+        TrackLoader::Result loaded;
+        if (!audioReady && trackLoader.poll(loaded)) {
+            audioReady = true;
+            if (loaded.ok && !loaded.source.primed.empty()) {
+                // The primed block is what the stream hands the device first.
+                mark("firstAudioBuffer");
+            }
+        }
+        result.frames++;
+        result.longestFrameMs = std::max(result.longestFrameMs, millisecondsBetween(frameStart, Clock::now()));
+        if (result.frames == 1) {
+            // Only the frame's update: with no window there is no text
+            // layout or drawing to time, so this is not a first paint.
+            mark("firstUpdate");
+        }
+        if (!sawRows && !rows.empty()) {
+            sawRows = true;
+            mark("firstRows");
+        }
+        if (!loading && result.loadedTracks == 0) {
+            result.loadedTracks = library.size();
+            mark("libraryLoaded");
+        }
+        if (!audioReady) {
+            // Stand-in for the 60 Hz frame limit, so the loader is not polled in a spin.
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return result;
+}
+
+void printJson(double processToMainMs, const std::vector<RunResult>& runs) {
+    std::cout << "{\n  \"benchmark\": \"startup\",\n  \"processStartToMainMs\": " << processToMainMs
+              << ",\n  \"runs\": [";
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        const RunResult& run = runs[i];
+        std::cout << (i ? "," : "") << "\n    {\"tracks\": " << run.trackCount << ", \"loadedTracks\": "
+                  << run.loadedTracks << ", \"assetsFound\": " << (run.assetsFound ? "true" : "false")
+                  << ", \"frames\": " << run.frames << ", \"longestFrameMs\": " << run.longestFrameMs
+                  << ", \"milestonesMs\": {";
+        for (std::size_t m = 0; m < run.milestones.size(); ++m) {
+            std::cout << (m ? ", " : "") << '"' << run.milestones[m].first << "\": " << run.milestones[m].second;
+        }
+        std::cout << "}}";
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+}
+
+}
+
+int runStartupBench(const std::vector<std::size_t>& trackCounts, Clock::time_point mainEntered) {
+    double processToMainMs = processAgeMs();
+    if (processToMainMs >= 0) {
+        processToMainMs -= millisecondsBetween(mainEntered, Clock::now());
+    }
+
+    std::string root = (std::filesystem::temp_directory_path() / "aecros-bench-startup").string();
+    std::error_code error;
+    std::filesystem::create_directories(root, error);
+    std::string tonePath = root + "/resume.wav";
+    if (!writeTestTone(tonePath)) {
+        std::cerr << "Could not write " << tonePath << std::endl;
+        return 1;
+    }
+
+    std::vector<RunResult> runs;
+    for (std::size_t trackCount : trackCounts) {
+        std::string directory = root + "/library-" + std::to_string(trackCount);
+        std::cerr << "Generating " << trackCount << " tracks..." << std::endl;
+        generateLibrary(directory, trackCount);
+        std::cerr << "Timing startup with " << trackCount << " tracks..." << std::endl;
+        runs.push_back(runOnce(directory, tonePath, trackCount));
+    }
+    printJson(processToMainMs, runs);
+    std::filesystem::remove_all(root, error);
+    return 0;
+}
@@ -0,0 +1,18 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_STARTUP_BENCH_HPP
+#define AECROS_STARTUP_BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// Headless replay of the startup sequence in openMainWindow() against
+// synthetic libraries of each size, printed to stdout as JSON. Milestones
+// are milliseconds since the run started; the library is generated first
+// and not timed. Returns the process exit code.
+int runStartupBench(const std::vector<std::size_t>& trackCounts, std::chrono::steady_clock::time_point mainEntered);
+
+#endif //AECROS_STARTUP_BENCH_HPP
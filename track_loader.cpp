@@ -0,0 +1,86 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "track_loader.hpp"
+
+TrackLoader::TrackLoader(PcmCache& cache, Prefetcher& prefetcher)
+    : cache(cache), prefetcher(prefetcher), worker(&TrackLoader::run, this) {}
+
+TrackLoader::~TrackLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void TrackLoader::request(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingPath = path;
+        requested++;
+        hasResult = false;
+    }
+    wake.notify_one();
+}
+
+void TrackLoader::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Bumping the generation orphans both the queued and the in-flight open.
+    requested++;
+    started = requested;
+    pendingPath.clear();
+    hasResult = false;
+}
+
+bool TrackLoader::isLoading() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return started != requested || (!hasResult && !pendingPath.empty());
+}
+
+bool TrackLoader::poll(Result& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!hasResult) {
+        return false;
+    }
+    result = std::move(finished);
+    hasResult = false;
+    pendingPath.clear();
+    return true;
+}
+
+void TrackLoader::run() {
+    while (true) {
+        std::string path;
+        uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || started != requested; });
+            if (stopping) {
+                return;
+            }
+            path = pendingPath;
+            generation = started = requested;
+        }
+
+        Result result;
+        result.path = path;
+        if (auto cached = cache.find(path)) {
+            result.fromCache = true;
+            result.ok = openStreamSource(std::move(cached), result.source);
+        } else {
+            prefetcher.noteOpen(path);
+            result.ok = openStreamSource(path, result.source);
+        }
+        result.source.path = path;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (generation == requested) {
+            finished = std::move(result);
+            hasResult = true;
+        }
+        // Otherwise a newer click superseded this open; the decoder is closed as result goes out of scope.
+    }
+}
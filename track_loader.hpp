@@ -0,0 +1,58 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_TRACK_LOADER_HPP
+#define AECROS_TRACK_LOADER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "audio_stream.hpp"
+#include "pcm_cache.hpp"
+#include "prefetcher.hpp"
+
+// Opens tracks on a worker thread so slow disks never stall the UI. Only
+// the most recent request matters: a newer request replaces one that has
+// not started, and the result of one already in flight is thrown away.
+class TrackLoader {
+public:
+    struct Result {
+        std::string path;
+        bool ok = false;
+        bool fromCache = false;
+        StreamSource source;
+    };
+
+    TrackLoader(PcmCache& cache, Prefetcher& prefetcher);
+    ~TrackLoader();
+
+    TrackLoader(const TrackLoader&) = delete;
+    TrackLoader& operator=(const TrackLoader&) = delete;
+
+    void request(const std::string& path);
+    void cancel();
+    bool isLoading();
+    // UI thread: returns true once per finished, still-current request.
+    bool poll(Result& result);
+
+private:
+    void run();
+
+    PcmCache& cache;
+    Prefetcher& prefetcher;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::string pendingPath;
+    uint64_t requested = 0;   // Generation of the newest request
+    uint64_t started = 0;     // Generation the worker last picked up
+    bool hasResult = false;
+    Result finished;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif //AECROS_TRACK_LOADER_HPP
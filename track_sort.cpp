@@ -0,0 +1,356 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "track_sort.hpp"
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include "collation.hpp"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const int RADIX_BITS = 11;  // 2048 counters per pass stay in L1
+const int RADIX_BUCKETS = 1 << RADIX_BITS;
+const int MAX_RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+// Tied title runs shorter than this are ordered with std::sort; clearing
+// the radix histograms would cost more than sorting them.
+const std::size_t SMALL_RUN = 64;
+
+// Stable LSD radix sort of count tracks by values, RADIX_BITS per pass and
+// only as many passes as bits needs. All histograms come from a single read,
+// and passes where every value has the same digit are skipped. The scratch
+// vectors grow to count and are kept by the caller for the next sort.
+void radixSort(uint64_t* values, TrackId* tracks, std::size_t count, int bits,
+               std::vector<uint64_t>& valueScratch, std::vector<TrackId>& trackScratch) {
+    const int passes = (bits + RADIX_BITS - 1) / RADIX_BITS;
+    if (valueScratch.size() < count) {
+        valueScratch.resize(count);
+        trackScratch.resize(count);
+    }
+
+    std::vector<uint32_t> histograms(static_cast<std::size_t>(MAX_RADIX_PASSES) * RADIX_BUCKETS);
+    for (std::size_t i = 0; i < count; ++i) {
+        uint64_t value = values[i];
+        for (int pass = 0; pass < passes; ++pass) {
+            histograms[pass * RADIX_BUCKETS + ((value >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+        }
+    }
+
+    uint64_t* valuesIn = values;
+    TrackId* tracksIn = tracks;
+    uint64_t* valuesOut = valueScratch.data();
+    TrackId* tracksOut = trackScratch.data();
+    for (int pass = 0; pass < passes; ++pass) {
+        uint32_t* histogram = histograms.data() + pass * RADIX_BUCKETS;
+        if (std::any_of(histogram, histogram + RADIX_BUCKETS, [count](uint32_t n) { return n == count; })) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+            uint32_t n = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += n;
+        }
+        const int shift = pass * RADIX_BITS;
+        for (std::size_t i = 0; i < count; ++i) {
+            uint32_t slot = histogram[(valuesIn[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            valuesOut[slot] = valuesIn[i];
+            tracksOut[slot] = tracksIn[i];
+        }
+        std::swap(valuesIn, valuesOut);
+        std::swap(tracksIn, tracksOut);
+    }
+    if (valuesIn != values) {
+        std::copy(valuesIn, valuesIn + count, values);
+        std::copy(tracksIn, tracksIn + count, tracks);
+    }
+}
+
+// Shifts each track's key into its packed word: one tight loop per key
+// rather than a switch per track and key. flip is all ones in the key's
+// width for descending keys, which turns v into max - v.
+template <typename Lookup>
+void packKey(uint64_t* values, const TrackId* tracks, std::size_t count, int width, uint64_t flip, Lookup lookup) {
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = (values[i] << width) | (static_cast<uint64_t>(lookup(tracks[i])) ^ flip);
+    }
+}
+
+int bitWidth(uint64_t value) {
+    int bits = 0;
+    while (value) {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+template <typename T>
+uint64_t maxOf(const std::vector<T>& values) {
+    return values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+}
+
+// The sort titles of a table, copied so that ranks can be built on another
+// thread while the table keeps changing. Answers the same two calls as
+// TrackTable, so the rank builder takes either.
+class TitleColumn {
+public:
+    explicit TitleColumn(const TrackTable& table) : keys(table.titleKeys()) {
+        ends.reserve(table.size());
+        for (TrackId id = 0; id < table.size(); ++id) {
+            chars += table.sortTitle(id);
+            ends.push_back(chars.size());
+        }
+    }
+
+    std::size_t size() const { return ends.size(); }
+    const std::vector<uint64_t>& titleKeys() const { return keys; }
+    std::string_view sortTitle(TrackId id) const {
+        std::size_t begin = id ? ends[id - 1] : 0;
+        return std::string_view(chars.data() + begin, ends[id] - begin);
+    }
+
+private:
+    std::vector<uint64_t> keys;
+    std::string chars;
+    std::vector<std::size_t> ends;
+};
+
+struct RankScratch {
+    std::vector<uint64_t> values;
+    std::vector<TrackId> tracks;
+    std::vector<std::pair<uint64_t, TrackId>> run;
+};
+
+// Ranks titles already ordered by their key at depth - 1. A run of equal
+// keys that may continue past them is re-keyed 8 bytes further in and
+// ordered again; any other run collates equal and shares one rank.
+template <typename Titles>
+void rankTitleRuns(const Titles& titles, uint64_t* values, TrackId* tracks, std::size_t count, std::size_t depth,
+                   std::vector<uint32_t>& ranks, uint32_t& nextRank, RankScratch& scratch) {
+    std::size_t start = 0;
+    while (start < count) {
+        std::size_t stop = start + 1;
+        while (stop < count && values[stop] == values[start]) {
+            ++stop;
+        }
+        std::size_t length = stop - start;
+        if (length > 1 && collationKeyIsPrefix(values[start])) {
+            uint64_t* runValues = values + start;
+            TrackId* runTracks = tracks + start;
+            for (std::size_t i = 0; i < length; ++i) {
+                runValues[i] = collationKey(titles.sortTitle(runTracks[i]), depth * 8);
+            }
+            if (length < SMALL_RUN) {
+                scratch.run.clear();
+                for (std::size_t i = 0; i < length; ++i) {
+                    scratch.run.emplace_back(runValues[i], runTracks[i]);
+                }
+                std::sort(scratch.run.begin(), scratch.run.end());
+                for (std::size_t i = 0; i < length; ++i) {
+                    runValues[i] = scratch.run[i].first;
+                    runTracks[i] = scratch.run[i].second;
+                }
+            } else {
+                radixSort(runValues, runTracks, length, 64, scratch.values, scratch.tracks);
+            }
+            rankTitleRuns(titles, runValues, runTracks, length, depth + 1, ranks, nextRank, scratch);
+        } else {
+            for (std::size_t i = start; i < stop; ++i) {
+                ranks[tracks[i]] = nextRank;
+            }
+            nextRank++;
+        }
+        start = stop;
+    }
+}
+
+// Fills ranks with each title's place in collated order, equal titles
+// sharing one, and returns the largest.
+template <typename Titles>
+uint32_t buildTitleRanks(const Titles& titles, std::size_t count, std::vector<uint32_t>& ranks) {
+    std::vector<TrackId> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<uint64_t> values(titles.titleKeys().begin(), titles.titleKeys().begin() + count);
+    RankScratch scratch;
+    radixSort(values.data(), order.data(), count, 64, scratch.values, scratch.tracks);
+
+    ranks.assign(count, 0);
+    uint32_t nextRank = 0;
+    rankTitleRuns(titles, values.data(), order.data(), count, 1, ranks, nextRank, scratch);
+    return nextRank > 0 ? nextRank - 1 : 0;
+}
+
+}
+
+const char* sortColumnName(SortColumn column) {
+    switch (column) {
+        case SortColumn::Added: return "Added";
+        case SortColumn::Artist: return "Artist";
+        case SortColumn::Album: return "Album";
+        case SortColumn::TrackNumber: return "#";
+        case SortColumn::Title: return "Title";
+        case SortColumn::Duration: return "Time";
+    }
+    return "";
+}
+
+TrackSorter::~TrackSorter() {
+    if (titleWorker.joinable()) {
+        titleWorker.join();
+    }
+}
+
+bool TrackSorter::titleRanksCurrent(const TrackTable& table) const {
+    return cachedTitleVersion == table.titleVersion() && cachedTitleCount == table.size();
+}
+
+void TrackSorter::collectTitleWorker(const TrackTable& table) {
+    if (!titleWorker.joinable() || !titleWorkerDone) {
+        return;
+    }
+    titleWorker.join();
+    if (workerVersion == table.titleVersion() && workerCount == table.size()) {
+        cachedTitleRanks.swap(workerRanks);
+        cachedTitleMax = workerMax;
+        cachedTitleVersion = workerVersion;
+        cachedTitleCount = workerCount;
+    } else {
+        titleWorkerStale = true;
+    }
+    workerRanks.clear();
+}
+
+bool TrackSorter::prepare(const TrackTable& table, const std::vector<SortKey>& keys) {
+    bool byTitle = std::any_of(keys.begin(), keys.end(), [](const SortKey& key) { return key.column == SortColumn::Title; });
+    if (!byTitle) {
+        return true;
+    }
+    collectTitleWorker(table);
+    if (titleRanksCurrent(table)) {
+        return true;
+    }
+    if (titleWorker.joinable()) {
+        return false;
+    }
+    if (titleWorkerStale) {
+        // Titles are changing faster than a build finishes (a scan is
+        // running); let sort() build them rather than wait forever.
+        titleWorkerStale = false;
+        return true;
+    }
+    workerVersion = table.titleVersion();
+    workerCount = table.size();
+    titleWorkerDone = false;
+    titleWorker = std::thread([this, titles = TitleColumn(table)] {
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+        workerMax = buildTitleRanks(titles, titles.size(), workerRanks);
+        titleWorkerDone = true;
+    });
+    return false;
+}
+
+const std::vector<uint32_t>& TrackSorter::titleRanks(const TrackTable& table) {
+    collectTitleWorker(table);
+    if (!titleRanksCurrent(table)) {
+        cachedTitleMax = buildTitleRanks(table, table.size(), cachedTitleRanks);
+        cachedTitleVersion = table.titleVersion();
+        cachedTitleCount = table.size();
+    }
+    return cachedTitleRanks;
+}
+
+const TrackSorter::RankCache& TrackSorter::poolRanks(const TrackTable& table, SortColumn column) {
+    bool artist = column == SortColumn::Artist;
+    RankCache& cache = artist ? artistRanks : albumRanks;
+    uint64_t version = artist ? table.artistVersion() : table.albumVersion();
+    if (cache.version != version) {
+        cache.ranks = artist ? table.artistRanks() : table.albumRanks();
+        cache.maxRank = static_cast<uint32_t>(maxOf(cache.ranks));
+        cache.version = version;
+    }
+    return cache;
+}
+
+void TrackSorter::sort(const TrackTable& table, const std::vector<SortKey>& keys, std::vector<TrackId>& tracks) {
+    std::vector<uint64_t> maxValues(keys.size());
+    std::vector<int> widths(keys.size());
+    for (std::size_t k = 0; k < keys.size(); ++k) {
+        switch (keys[k].column) {
+            case SortColumn::Artist:
+            case SortColumn::Album:
+                maxValues[k] = poolRanks(table, keys[k].column).maxRank;
+                break;
+            case SortColumn::Title:
+                titleRanks(table);
+                maxValues[k] = cachedTitleMax;
+                break;
+            case SortColumn::TrackNumber:
+                maxValues[k] = maxOf(table.trackNumbers());
+                break;
+            case SortColumn::Duration:
+                maxValues[k] = maxOf(table.durationsMs());
+                break;
+            case SortColumn::Added:
+                maxValues[k] = table.size();
+                break;
+        }
+        widths[k] = std::max(1, bitWidth(maxValues[k]));
+    }
+
+    // Least significant keys first; stability carries their order into the
+    // later passes. Each pass packs as many neighbouring keys as fit in 64 bits.
+    const std::size_t count = tracks.size();
+    if (values.size() < count) {
+        values.resize(count);
+    }
+    std::size_t next = keys.size();
+    while (next > 0) {
+        std::size_t first = next - 1;
+        int totalBits = widths[first];
+        while (first > 0 && totalBits + widths[first - 1] <= 64) {
+            first--;
+            totalBits += widths[first];
+        }
+        std::fill(values.begin(), values.begin() + count, 0);
+        for (std::size_t k = first; k < next; ++k) {
+            int width = widths[k];
+            uint64_t flip = keys[k].descending ? (width == 64 ? ~0ull : (1ull << width) - 1) : 0;
+            switch (keys[k].column) {
+                case SortColumn::Artist:
+                case SortColumn::Album: {
+                    const uint32_t* ranks = poolRanks(table, keys[k].column).ranks.data();
+                    const uint32_t* ids = (keys[k].column == SortColumn::Artist ? table.artistColumn() : table.albumColumn()).data();
+                    packKey(values.data(), tracks.data(), count, width, flip, [=](TrackId track) { return ranks[ids[track]]; });
+                    break;
+                }
+                case SortColumn::Title: {
+                    const uint32_t* ranks = cachedTitleRanks.data();
+                    packKey(values.data(), tracks.data(), count, width, flip, [=](TrackId track) { return ranks[track]; });
+                    break;
+                }
+                case SortColumn::TrackNumber: {
+                    const uint16_t* numbers = table.trackNumbers().data();
+                    packKey(values.data(), tracks.data(), count, width, flip, [=](TrackId track) { return numbers[track]; });
+                    break;
+                }
+                case SortColumn::Duration: {
+                    const uint32_t* durations = table.durationsMs().data();
+                    packKey(values.data(), tracks.data(), count, width, flip, [=](TrackId track) { return durations[track]; });
+                    break;
+                }
+                case SortColumn::Added:
+                    packKey(values.data(), tracks.data(), count, width, flip, [](TrackId track) { return track; });
+                    break;
+            }
+        }
+        radixSort(values.data(), tracks.data(), count, totalBits, valueScratch, trackScratch);
+        next = first;
+    }
+}
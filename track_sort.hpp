@@ -0,0 +1,95 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_TRACK_SORT_HPP
+#define AECROS_TRACK_SORT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "track_table.hpp"
+
+enum class SortColumn {
+    Added,  // Insertion order, i.e. TrackId
+    Artist,
+    Album,
+    TrackNumber,
+    Title,
+    Duration
+};
+
+const int SORT_COLUMN_COUNT = 6;
+const std::size_t MAX_SORT_KEYS = 3;
+
+struct SortKey {
+    SortColumn column = SortColumn::Added;
+    bool descending = false;
+};
+
+const char* sortColumnName(SortColumn column);
+
+// Sorts track lists by any combination of columns, most significant key
+// first. Every column is reduced to a small integer (collation ranks for
+// text, the value itself otherwise) and neighbouring keys are packed into
+// 64-bit words, so a typical multi-column sort is one stable LSD radix sort.
+// Tracks that tie on all keys keep their incoming order.
+//
+// Ranks are cached: artist and album ranks until their string pool gains a
+// string, title ranks until a title changes. With them cached a sort is one
+// column-wise gather per key into the packed words plus the radix passes,
+// into buffers kept between calls.
+//
+// Building title ranks means sorting every title in the table. prepare()
+// does that on a worker thread from a copy of the titles, so the UI can keep
+// drawing the rows it has until the ranks are there.
+class TrackSorter {
+public:
+    TrackSorter() = default;
+    ~TrackSorter();
+
+    TrackSorter(const TrackSorter&) = delete;
+    TrackSorter& operator=(const TrackSorter&) = delete;
+
+    void sort(const TrackTable& table, const std::vector<SortKey>& keys, std::vector<TrackId>& tracks);
+
+    // Returns false while title ranks that keys need are being built in the
+    // background, starting the build if they are out of date. Once a build
+    // finishes it returns true, even if titles changed in the meantime; the
+    // next sort() then rebuilds them itself rather than waiting again.
+    bool prepare(const TrackTable& table, const std::vector<SortKey>& keys);
+
+private:
+    struct RankCache {
+        std::vector<uint32_t> ranks;
+        uint32_t maxRank = 0;
+        uint64_t version = UINT64_MAX;
+    };
+
+    const std::vector<uint32_t>& titleRanks(const TrackTable& table);
+    const RankCache& poolRanks(const TrackTable& table, SortColumn column);
+    bool titleRanksCurrent(const TrackTable& table) const;
+    void collectTitleWorker(const TrackTable& table);
+
+    std::vector<uint32_t> cachedTitleRanks;
+    uint32_t cachedTitleMax = 0;
+    uint64_t cachedTitleVersion = UINT64_MAX;
+    std::size_t cachedTitleCount = 0;
+    RankCache artistRanks;
+    RankCache albumRanks;
+
+    std::vector<uint64_t> values;
+    std::vector<uint64_t> valueScratch;
+    std::vector<TrackId> trackScratch;
+
+    std::thread titleWorker;
+    std::atomic<bool> titleWorkerDone{false};
+    bool titleWorkerStale = false;     // The last background build finished after titles had changed
+    std::vector<uint32_t> workerRanks;  // The worker's until titleWorkerDone
+    uint32_t workerMax = 0;
+    uint64_t workerVersion = 0;
+    std::size_t workerCount = 0;
+};
+
+#endif //AECROS_TRACK_SORT_HPP
@@ -0,0 +1,336 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "track_table.hpp"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include "collation.hpp"
+#include "file_info.hpp"
+
+namespace {
+
+char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// needle must already be lower case.
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    if (needle.empty()) {
+        return true;
+    }
+    if (haystack.size() < needle.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+        std::size_t j = 0;
+        while (j < needle.size() && lowerAscii(haystack[i + j]) == needle[j]) {
+            ++j;
+        }
+        if (j == needle.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t pathKey(uint32_t directoryId, std::string_view name) {
+    return hashString(name) ^ ((static_cast<uint64_t>(directoryId) + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+const std::size_t MIN_PATH_SLOTS = 1024;
+
+std::atomic<uint64_t> nextPoolGeneration{0};
+
+}
+
+StringPool::StringPool() {
+    clear();
+}
+
+uint32_t StringPool::intern(std::string_view text) {
+    auto found = index.find(text);
+    if (found != index.end()) {
+        return found->second;
+    }
+    uint32_t id = static_cast<uint32_t>(strings.size());
+    strings.emplace_back(text);
+    keys.push_back(collationKey(text));
+    index.emplace(strings.back(), id);
+    generation = ++nextPoolGeneration;
+    return id;
+}
+
+void StringPool::clear() {
+    index.clear();
+    strings.clear();
+    keys.clear();
+    strings.emplace_back();
+    keys.push_back(collationKey(std::string_view()));
+    index.emplace(strings.back(), 0);
+    generation = ++nextPoolGeneration;
+}
+
+std::vector<uint32_t> StringPool::collationRanks() const {
+    std::vector<uint32_t> order(strings.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto compare = [this](uint32_t a, uint32_t b) {
+        if (keys[a] != keys[b]) {
+            return keys[a] < keys[b] ? -1 : 1;
+        }
+        return collationKeyIsPrefix(keys[a]) ? compareCollated(strings[a], strings[b]) : 0;
+    };
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return compare(a, b) < 0; });
+
+    std::vector<uint32_t> ranks(strings.size());
+    uint32_t rank = 0;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        if (i > 0 && compare(order[i - 1], order[i]) != 0) {
+            rank++;
+        }
+        ranks[order[i]] = rank;
+    }
+    return ranks;
+}
+
+TrackTable::TrackTable() = default;
+
+TrackId TrackTable::add(std::string_view path) {
+    pathRefs.push_back(pathStore.add(path));
+    scanned.push_back(0);
+    removedColumn.push_back(0);
+    durationColumn.push_back(0);
+    sizeColumn.push_back(0);
+    mtimeColumn.push_back(0);
+    artistIds.push_back(0);
+    albumIds.push_back(0);
+    trackNumberColumn.push_back(0);
+    yearColumn.push_back(0);
+    playCountColumn.push_back(0);
+    lastPlayedColumn.push_back(0);
+    titleOffsets.push_back(0);
+    titleLengths.push_back(0);
+    TrackId id = static_cast<TrackId>(pathRefs.size() - 1);
+    titleKeyColumn.push_back(collationKey(basename(id)));
+    indexPath(id);
+    changeCount++;
+    titleChangeCount++;
+    return id;
+}
+
+void TrackTable::indexPath(TrackId id) {
+    // Kept at most 3/4 full; growing re-inserts every row from its stored key parts.
+    if ((static_cast<std::size_t>(id) + 1) * 4 > pathSlots.size() * 3) {
+        pathSlots.assign(std::max(MIN_PATH_SLOTS, pathSlots.size() * 2), NO_TRACK);
+        for (TrackId row = 0; row < id; ++row) {
+            indexPath(row);
+        }
+    }
+    PathId ref = pathRefs[id];
+    std::size_t mask = pathSlots.size() - 1;
+    std::size_t slot = pathKey(pathStore.directoryOf(ref), pathStore.basename(ref)) & mask;
+    while (pathSlots[slot] != NO_TRACK) {
+        slot = (slot + 1) & mask;
+    }
+    pathSlots[slot] = id;
+}
+
+TrackId TrackTable::find(std::string_view path) const {
+    if (pathSlots.empty()) {
+        return NO_TRACK;
+    }
+    std::size_t separator = path.find_last_of("/\\");
+    std::size_t split = separator == std::string_view::npos ? 0 : separator + 1;
+    uint32_t directoryId;
+    if (!pathStore.findDirectory(path.substr(0, split), directoryId)) {
+        return NO_TRACK;
+    }
+    std::string_view name = path.substr(split);
+
+    // Rows are inserted in ID order, so the first match found is the oldest row.
+    std::size_t mask = pathSlots.size() - 1;
+    for (std::size_t slot = pathKey(directoryId, name) & mask; pathSlots[slot] != NO_TRACK; slot = (slot + 1) & mask) {
+        PathId ref = pathRefs[pathSlots[slot]];
+        if (!removedColumn[pathSlots[slot]] && pathStore.directoryOf(ref) == directoryId &&
+            pathStore.basename(ref) == name) {
+            return pathSlots[slot];
+        }
+    }
+    return NO_TRACK;
+}
+
+void TrackTable::remove(TrackId id) {
+    if (id >= size() || removedColumn[id]) {
+        return;
+    }
+    removedColumn[id] = 1;
+    removedCount++;
+    // The path stays, so the row can still be written out and replayed;
+    // everything else goes, which keeps the totals right without a check.
+    scanned[id] = 0;
+    durationColumn[id] = 0;
+    sizeColumn[id] = 0;
+    mtimeColumn[id] = 0;
+    artistIds[id] = 0;
+    albumIds[id] = 0;
+    trackNumberColumn[id] = 0;
+    yearColumn[id] = 0;
+    playCountColumn[id] = 0;
+    lastPlayedColumn[id] = 0;
+    titleGarbage += titleLengths[id];
+    titleLengths[id] = 0;
+    titleKeyColumn[id] = collationKey(basename(id));
+    changeCount++;
+    titleChangeCount++;
+}
+
+void TrackTable::setInfo(TrackId id, const TrackInfo& info) {
+    if (id >= size() || removedColumn[id]) {
+        return;
+    }
+    scanned[id] = 1;
+    durationColumn[id] = info.durationMs;
+    sizeColumn[id] = info.file.size;
+    mtimeColumn[id] = info.file.mtime;
+    artistIds[id] = artistPool.intern(info.artist);
+    albumIds[id] = albumPool.intern(info.album);
+    trackNumberColumn[id] = info.trackNumber;
+    yearColumn[id] = info.year;
+
+    // A title no longer than the one before reuses its bytes; otherwise the
+    // old ones are left for shrinkToFit() to reclaim.
+    std::size_t length = std::min<std::size_t>(info.title.size(), UINT16_MAX);
+    titleGarbage += titleLengths[id] - std::min<std::size_t>(titleLengths[id], length);
+    if (length > titleLengths[id]) {
+        titleGarbage += titleLengths[id];
+        titleOffsets[id] = static_cast<uint32_t>(titleChars.size());
+        titleChars.append(info.title, 0, length);
+    } else {
+        titleChars.replace(titleOffsets[id], length, info.title, 0, length);
+    }
+    titleLengths[id] = static_cast<uint16_t>(length);
+
+    uint64_t titleKey = collationKey(sortTitle(id));
+    if (titleKey != titleKeyColumn[id] || collationKeyIsPrefix(titleKey)) {
+        titleKeyColumn[id] = titleKey;
+        titleChangeCount++;
+    }
+    changeCount++;
+}
+
+void TrackTable::notePlayed(TrackId id, int64_t when) {
+    if (id >= size() || removedColumn[id]) {
+        return;
+    }
+    playCountColumn[id]++;
+    lastPlayedColumn[id] = when;
+    changeCount++;
+}
+
+void TrackTable::setPlayStats(TrackId id, uint32_t playCount, int64_t lastPlayed) {
+    if (id >= size() || removedColumn[id]) {
+        return;
+    }
+    playCountColumn[id] = playCount;
+    lastPlayedColumn[id] = lastPlayed;
+    changeCount++;
+}
+
+void TrackTable::clear() {
+    pathStore.clear();
+    artistPool.clear();
+    albumPool.clear();
+    pathRefs.clear();
+    scanned.clear();
+    removedColumn.clear();
+    removedCount = 0;
+    durationColumn.clear();
+    sizeColumn.clear();
+    mtimeColumn.clear();
+    artistIds.clear();
+    albumIds.clear();
+    trackNumberColumn.clear();
+    yearColumn.clear();
+    playCountColumn.clear();
+    lastPlayedColumn.clear();
+    titleKeyColumn.clear();
+    titleChars.clear();
+    titleOffsets.clear();
+    titleLengths.clear();
+    titleGarbage = 0;
+    pathSlots.clear();
+    changeCount++;
+    titleChangeCount++;
+}
+
+void TrackTable::shrinkToFit() {
+    pathStore.shrinkToFit();
+    pathRefs.shrink_to_fit();
+    scanned.shrink_to_fit();
+    removedColumn.shrink_to_fit();
+    durationColumn.shrink_to_fit();
+    sizeColumn.shrink_to_fit();
+    mtimeColumn.shrink_to_fit();
+    artistIds.shrink_to_fit();
+    albumIds.shrink_to_fit();
+    trackNumberColumn.shrink_to_fit();
+    yearColumn.shrink_to_fit();
+    playCountColumn.shrink_to_fit();
+    lastPlayedColumn.shrink_to_fit();
+    titleKeyColumn.shrink_to_fit();
+    if (titleGarbage > 0) {
+        // Repack the titles that are still in use, in row order.
+        std::string packed;
+        packed.reserve(titleChars.size() - titleGarbage);
+        for (TrackId id = 0; id < size(); ++id) {
+            std::size_t offset = packed.size();
+            packed.append(titleChars, titleOffsets[id], titleLengths[id]);
+            titleOffsets[id] = static_cast<uint32_t>(offset);
+        }
+        titleChars.swap(packed);
+        titleGarbage = 0;
+    }
+    titleChars.shrink_to_fit();
+    titleOffsets.shrink_to_fit();
+    titleLengths.shrink_to_fit();
+}
+
+void TrackTable::search(std::string_view query, std::vector<TrackId>& results) const {
+    results.clear();
+    std::string needle(query);
+    std::transform(needle.begin(), needle.end(), needle.begin(), lowerAscii);
+
+    // Artists and albums repeat, so test each distinct one once up front.
+    std::vector<uint8_t> artistMatches(artistPool.size());
+    for (uint32_t i = 0; i < artistPool.size(); ++i) {
+        artistMatches[i] = containsIgnoreCase(artistPool.get(i), needle);
+    }
+    std::vector<uint8_t> albumMatches(albumPool.size());
+    for (uint32_t i = 0; i < albumPool.size(); ++i) {
+        albumMatches[i] = containsIgnoreCase(albumPool.get(i), needle);
+    }
+
+    std::string fullPath;
+    for (TrackId id = 0; id < size(); ++id) {
+        if (removedColumn[id]) {
+            continue;
+        }
+        if (artistMatches[artistIds[id]] || albumMatches[albumIds[id]] || containsIgnoreCase(title(id), needle)) {
+            results.push_back(id);
+            continue;
+        }
+        path(id, fullPath);
+        if (containsIgnoreCase(fullPath, needle)) {
+            results.push_back(id);
+        }
+    }
+}
+
+uint64_t TrackTable::totalDurationMs() const {
+    return std::accumulate(durationColumn.begin(), durationColumn.end(), uint64_t(0));
+}
+
+uint64_t TrackTable::totalBytes() const {
+    return std::accumulate(sizeColumn.begin(), sizeColumn.end(), uint64_t(0));
+}
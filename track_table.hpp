@@ -0,0 +1,158 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_TRACK_TABLE_HPP
+#define AECROS_TRACK_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "metadata.hpp"
+#include "path_store.hpp"
+
+// Tracks are identified by their row in the table. IDs are handed out in
+// order and never reused until the whole library is cleared; a removed track
+// keeps its row as an empty tombstone so the IDs after it stay put.
+using TrackId = uint32_t;
+const TrackId NO_TRACK = UINT32_MAX;
+
+// Repeated strings (artists, albums) stored once with their collation keys;
+// ID 0 is the empty string.
+class StringPool {
+public:
+    StringPool();
+
+    uint32_t intern(std::string_view text);
+    std::string_view get(uint32_t id) const { return strings[id]; }
+    std::size_t size() const { return strings.size(); }
+    void clear();
+
+    // Position of each string in collated order, indexed by ID. Strings that
+    // collate equal ("ABBA", "abba") share a rank.
+    std::vector<uint32_t> collationRanks() const;
+    // Changes whenever the set of strings does, and is never shared with
+    // another pool, so ranks can be cached against it.
+    uint64_t version() const { return generation; }
+
+private:
+    // A deque so that growing it never moves the strings the index points into.
+    std::deque<std::string> strings;
+    std::vector<uint64_t> keys;
+    std::unordered_map<std::string_view, uint32_t> index;
+    uint64_t generation = 0;
+};
+
+// The library as one column per field (structure of arrays), so filtering,
+// sorting and statistics are tight loops over contiguous memory. Everything
+// else (queue, selection, search results, history) refers to rows by ID.
+class TrackTable {
+public:
+    TrackTable();
+
+    TrackId add(std::string_view path);
+    // Empties the row and leaves it out of find() and search(); tags and play
+    // counts recorded for it afterwards are ignored.
+    void remove(TrackId id);
+    void setInfo(TrackId id, const TrackInfo& info);
+    void notePlayed(TrackId id, int64_t when);
+    // Restores counters saved by a snapshot.
+    void setPlayStats(TrackId id, uint32_t playCount, int64_t lastPlayed);
+    void clear();
+    void shrinkToFit();
+
+    // Rows, removed ones included; every ID below it is valid.
+    std::size_t size() const { return pathRefs.size(); }
+    bool empty() const { return pathRefs.empty(); }
+    // Rows that have not been removed.
+    std::size_t trackCount() const { return pathRefs.size() - removedCount; }
+    bool isRemoved(TrackId id) const { return removedColumn[id] != 0; }
+    const std::vector<uint8_t>& removedFlags() const { return removedColumn; }
+    bool hasInfo(TrackId id) const { return scanned[id] != 0; }
+    // Bumped by every change, so views can tell when to rebuild.
+    uint64_t version() const { return changeCount; }
+    // Bumped only when some sortTitle() changes.
+    uint64_t titleVersion() const { return titleChangeCount; }
+
+    const PathStore& paths() const { return pathStore; }
+    std::string path(TrackId id) const { return pathStore.path(pathRefs[id]); }
+    void path(TrackId id, std::string& out) const { pathStore.path(pathRefs[id], out); }
+    std::string_view basename(TrackId id) const { return pathStore.basename(pathRefs[id]); }
+    // Hash lookup by full path; the first track added with it, or NO_TRACK.
+    TrackId find(std::string_view path) const;
+
+    std::string_view title(TrackId id) const {
+        return std::string_view(titleChars.data() + titleOffsets[id], titleLengths[id]);
+    }
+    std::string_view artist(TrackId id) const { return artistPool.get(artistIds[id]); }
+    std::string_view album(TrackId id) const { return albumPool.get(albumIds[id]); }
+    // The title, or the file name for untagged tracks.
+    std::string_view sortTitle(TrackId id) const {
+        return titleLengths[id] ? title(id) : basename(id);
+    }
+
+    // Columns, indexed by TrackId.
+    const std::vector<uint32_t>& durationsMs() const { return durationColumn; }
+    const std::vector<uint64_t>& fileSizes() const { return sizeColumn; }
+    const std::vector<int64_t>& modifiedTimes() const { return mtimeColumn; }
+    const std::vector<uint32_t>& artistColumn() const { return artistIds; }
+    const std::vector<uint32_t>& albumColumn() const { return albumIds; }
+    const std::vector<uint16_t>& trackNumbers() const { return trackNumberColumn; }
+    const std::vector<uint16_t>& years() const { return yearColumn; }
+    const std::vector<uint32_t>& playCounts() const { return playCountColumn; }
+    const std::vector<int64_t>& lastPlayed() const { return lastPlayedColumn; }
+    // Titles keep an 8-byte collation key (see collation.hpp) per row;
+    // artists and albums, being interned, are ranked through their pools.
+    const std::vector<uint64_t>& titleKeys() const { return titleKeyColumn; }
+    std::vector<uint32_t> artistRanks() const { return artistPool.collationRanks(); }
+    std::vector<uint32_t> albumRanks() const { return albumPool.collationRanks(); }
+    uint64_t artistVersion() const { return artistPool.version(); }
+    uint64_t albumVersion() const { return albumPool.version(); }
+
+    // Case-insensitive (ASCII) substring match over path, title, artist and album.
+    void search(std::string_view query, std::vector<TrackId>& results) const;
+    uint64_t totalDurationMs() const;
+    uint64_t totalBytes() const;
+
+private:
+    PathStore pathStore;
+    StringPool artistPool;
+    StringPool albumPool;
+
+    std::vector<PathId> pathRefs;
+    std::vector<uint8_t> scanned;
+    std::vector<uint8_t> removedColumn;
+    std::size_t removedCount = 0;
+    std::vector<uint32_t> durationColumn;
+    std::vector<uint64_t> sizeColumn;
+    std::vector<int64_t> mtimeColumn;
+    std::vector<uint32_t> artistIds;
+    std::vector<uint32_t> albumIds;
+    std::vector<uint16_t> trackNumberColumn;
+    std::vector<uint16_t> yearColumn;
+    std::vector<uint32_t> playCountColumn;
+    std::vector<int64_t> lastPlayedColumn;
+    std::vector<uint64_t> titleKeyColumn;
+
+    // Titles are nearly all unique, so they are packed rather than interned.
+    // A rescan overwrites the old title when the new one fits in its place
+    // and appends it otherwise; shrinkToFit() repacks the bytes left behind.
+    std::string titleChars;
+    std::vector<uint32_t> titleOffsets;
+    std::vector<uint16_t> titleLengths;
+    std::size_t titleGarbage = 0;  // Bytes of titleChars no row refers to
+
+    // Open-addressed index of rows by (directory, basename), so finding a
+    // path never rebuilds the stored ones. Costs 4-8 bytes per track.
+    void indexPath(TrackId id);
+    std::vector<TrackId> pathSlots;
+
+    uint64_t changeCount = 0;
+    uint64_t titleChangeCount = 0;
+};
+
+#endif //AECROS_TRACK_TABLE_HPP
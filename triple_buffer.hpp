@@ -0,0 +1,51 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_TRIPLE_BUFFER_HPP
+#define AECROS_TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Single-writer / single-reader value exchange. The writer never blocks the
+// reader and neither side allocates, so it is safe to read from the audio
+// thread while the UI thread publishes new values.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) {
+        buffers[0] = buffers[1] = buffers[2] = initial;
+    }
+
+    // Writer side: publish a new value.
+    void write(const T& value) {
+        buffers[backIndex] = value;
+        backIndex = state.exchange(backIndex | DIRTY_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side: pick up the latest published value. Returns true if it changed.
+    bool update() {
+        if (!(state.load(std::memory_order_acquire) & DIRTY_BIT)) {
+            return false;
+        }
+        frontIndex = state.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& read() const {
+        return buffers[frontIndex];
+    }
+
+private:
+    static constexpr uint8_t DIRTY_BIT = 0x4;
+    static constexpr uint8_t INDEX_MASK = 0x3;
+
+    T buffers[3] = {};
+    std::atomic<uint8_t> state{1};
+    uint8_t backIndex = 0;
+    uint8_t frontIndex = 2;
+};
+
+#endif //AECROS_TRIPLE_BUFFER_HPP
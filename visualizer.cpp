@@ -0,0 +1,162 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "visualizer.hpp"
+#include <algorithm>
+
+namespace {
+
+// Black -> blue -> red -> yellow.
+sf::Color heatColor(float level) {
+    auto channel = [](float value) {
+        return static_cast<sf::Uint8>(std::max(0.0f, std::min(1.0f, value)) * 255.0f);
+    };
+    if (level < 0.33f) {
+        return sf::Color(0, 0, channel(level * 3.0f));
+    }
+    if (level < 0.66f) {
+        float t = (level - 0.33f) * 3.0f;
+        return sf::Color(channel(t), 0, channel(1.0f - t));
+    }
+    float t = (level - 0.66f) * 3.0f;
+    return sf::Color(255, channel(t), 0);
+}
+
+}
+
+Visualizer::Visualizer(PcmTap& tap)
+    : analyzer(tap), barGeometry(SPECTRUM_BARS * 4), columnPixels(SPECTROGRAM_ROWS * 4, 0) {
+    background.setFillColor(sf::Color(20, 20, 20, 230));
+}
+
+void Visualizer::setMode(VisualMode newMode) {
+    mode = newMode;
+    if (mode == VisualMode::Off) {
+        analyzer.stop();
+        return;
+    }
+    if (mode == VisualMode::Bars && !barBufferCreated && sf::VertexBuffer::isAvailable()) {
+        barBufferCreated = barBuffer.create(barGeometry.size());
+        barsChanged = true;
+    }
+    if (mode == VisualMode::Spectrogram && !spectrogramCreated) {
+        spectrogramCreated = spectrogram.create(SPECTROGRAM_COLUMNS, SPECTROGRAM_ROWS);
+        std::vector<sf::Uint8> blank(SPECTROGRAM_COLUMNS * SPECTROGRAM_ROWS * 4, 0);
+        for (std::size_t i = 3; i < blank.size(); i += 4) {
+            blank[i] = 255;
+        }
+        spectrogram.update(blank.data());
+        olderColumns.setTexture(spectrogram);
+        newerColumns.setTexture(spectrogram);
+    }
+    analyzer.start();
+}
+
+void Visualizer::cycleMode() {
+    switch (mode) {
+        case VisualMode::Off: setMode(VisualMode::Bars); break;
+        case VisualMode::Bars: setMode(VisualMode::Spectrogram); break;
+        case VisualMode::Spectrogram: setMode(VisualMode::Off); break;
+    }
+}
+
+const char* Visualizer::getModeName() const {
+    switch (mode) {
+        case VisualMode::Bars: return "Visuals: Bars";
+        case VisualMode::Spectrogram: return "Visuals: Spectrum";
+        default: return "Visuals: Off";
+    }
+}
+
+void Visualizer::setArea(const sf::FloatRect& newArea) {
+    area = newArea;
+    background.setPosition(area.left, area.top);
+    background.setSize(sf::Vector2f(area.width, area.height));
+    updateBars();
+}
+
+void Visualizer::update() {
+    if (mode == VisualMode::Off || !analyzer.poll(frame)) {
+        return;
+    }
+    if (mode == VisualMode::Bars) {
+        updateBars();
+    } else if (spectrogramCreated) {
+        pushSpectrogramColumn();
+    }
+}
+
+void Visualizer::updateBars() {
+    float barWidth = area.width / SPECTRUM_BARS;
+    float bottom = area.top + area.height;
+    for (int b = 0; b < SPECTRUM_BARS; ++b) {
+        float left = area.left + b * barWidth;
+        float right = left + std::max(1.0f, barWidth - 2.0f);
+        float top = bottom - frame.bars[b] * area.height;
+        sf::Color topColor = heatColor(0.4f + frame.bars[b] * 0.6f);
+        sf::Color bottomColor(40, 40, 160);
+
+        sf::Vertex* quad = &barGeometry[b * 4];
+        quad[0].position = sf::Vector2f(left, bottom);
+        quad[1].position = sf::Vector2f(left, top);
+        quad[2].position = sf::Vector2f(right, top);
+        quad[3].position = sf::Vector2f(right, bottom);
+        quad[0].color = bottomColor;
+        quad[1].color = topColor;
+        quad[2].color = topColor;
+        quad[3].color = bottomColor;
+    }
+    barsChanged = true;
+}
+
+void Visualizer::pushSpectrogramColumn() {
+    // Low frequencies go at the bottom of the texture.
+    for (int row = 0; row < SPECTROGRAM_ROWS; ++row) {
+        sf::Color color = heatColor(frame.column[row]);
+        sf::Uint8* pixel = &columnPixels[(SPECTROGRAM_ROWS - 1 - row) * 4];
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+        pixel[3] = 255;
+    }
+    spectrogram.update(columnPixels.data(), 1, SPECTROGRAM_ROWS, writeColumn, 0);
+    writeColumn = (writeColumn + 1) % SPECTROGRAM_COLUMNS;
+}
+
+void Visualizer::draw(sf::RenderTarget& target) {
+    if (mode == VisualMode::Off) {
+        return;
+    }
+    target.draw(background);
+    if (mode == VisualMode::Bars) {
+        if (!barBufferCreated) {
+            target.draw(barGeometry.data(), barGeometry.size(), sf::Quads);
+            return;
+        }
+        if (barsChanged) {
+            barBuffer.update(barGeometry.data());
+            barsChanged = false;
+        }
+        target.draw(barBuffer);
+        return;
+    }
+    if (!spectrogramCreated) {
+        return;
+    }
+
+    // writeColumn is the oldest column; unroll the ring so time runs left to right.
+    float scaleX = area.width / SPECTROGRAM_COLUMNS;
+    float scaleY = area.height / SPECTROGRAM_ROWS;
+    int olderWidth = static_cast<int>(SPECTROGRAM_COLUMNS - writeColumn);
+    olderColumns.setTextureRect(sf::IntRect(writeColumn, 0, olderWidth, SPECTROGRAM_ROWS));
+    olderColumns.setPosition(area.left, area.top);
+    olderColumns.setScale(scaleX, scaleY);
+    target.draw(olderColumns);
+    if (writeColumn > 0) {
+        newerColumns.setTextureRect(sf::IntRect(0, 0, writeColumn, SPECTROGRAM_ROWS));
+        newerColumns.setPosition(area.left + olderWidth * scaleX, area.top);
+        newerColumns.setScale(scaleX, scaleY);
+        target.draw(newerColumns);
+    }
+}
@@ -0,0 +1,59 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_VISUALIZER_HPP
+#define AECROS_VISUALIZER_HPP
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "spectrum.hpp"
+
+const unsigned SPECTROGRAM_COLUMNS = 512;
+
+enum class VisualMode {
+    Off,
+    Bars,
+    Spectrogram
+};
+
+// Draws the analyzer output. Bar geometry lives in one persistent vertex
+// buffer on the GPU, re-uploaded only when a new frame arrives, and the
+// spectrogram in a ring texture that gets one new column per frame, so
+// drawing costs the same no matter how long it has been running.
+class Visualizer {
+public:
+    explicit Visualizer(PcmTap& tap);
+
+    VisualMode getMode() const { return mode; }
+    void setMode(VisualMode newMode);
+    void cycleMode();
+    const char* getModeName() const;
+
+    void setArea(const sf::FloatRect& newArea);
+    void update();
+    void draw(sf::RenderTarget& target);
+
+private:
+    void updateBars();
+    void pushSpectrogramColumn();
+
+    SpectrumAnalyzer analyzer;
+    SpectrumFrame frame;
+    VisualMode mode = VisualMode::Off;
+    sf::FloatRect area;
+
+    sf::RectangleShape background;
+    std::vector<sf::Vertex> barGeometry;
+    sf::VertexBuffer barBuffer{sf::Quads, sf::VertexBuffer::Stream};
+    bool barBufferCreated = false;  // Without VBO support the geometry is drawn from memory
+    bool barsChanged = true;
+
+    sf::Texture spectrogram;
+    bool spectrogramCreated = false;
+    std::vector<sf::Uint8> columnPixels;
+    unsigned writeColumn = 0;
+    sf::Sprite olderColumns, newerColumns;
+};
+
+#endif //AECROS_VISUALIZER_HPP
@@ -0,0 +1,249 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "waveform.hpp"
+#include <SFML/Audio.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const char WAVEFORM_MAGIC[4] = {'A', 'W', 'F', '1'};
+const std::size_t MAX_IN_MEMORY = 64;
+
+}
+
+bool computeWaveform(const std::string& path, WaveformSummary& summary, TrackLoudness* loudness) {
+    if (!statFile(path, summary.file)) {
+        return false;
+    }
+    sf::InputSoundFile file;
+    if (!file.openFromFile(path)) {
+        return false;
+    }
+    unsigned channelCount = file.getChannelCount();
+    uint64_t totalFrames = channelCount ? file.getSampleCount() / channelCount : 0;
+    if (totalFrames == 0) {
+        return false;
+    }
+
+    std::vector<int16_t> low(WAVEFORM_BUCKETS, 0), high(WAVEFORM_BUCKETS, 0);
+    std::vector<sf::Int16> buffer(65536 - 65536 % channelCount);
+
+    int bucket = 0;
+    uint64_t frame = 0;
+    uint64_t bucketEnd = totalFrames / WAVEFORM_BUCKETS;
+    int16_t bucketLow = 0, bucketHigh = 0;
+    double sumSquares = 0.0;
+    uint64_t sampleCount = 0;
+    while (true) {
+        std::size_t count = static_cast<std::size_t>(file.read(buffer.data(), buffer.size()));
+        if (count == 0) {
+            break;
+        }
+        if (loudness) {
+            // Integer partial sums: exact, and cheap next to decoding.
+            int64_t blockSum = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                blockSum += static_cast<int32_t>(buffer[i]) * buffer[i];
+            }
+            sumSquares += static_cast<double>(blockSum);
+            sampleCount += count;
+        }
+        for (std::size_t i = 0; i < count; i += channelCount, ++frame) {
+            while (frame >= bucketEnd && bucket < WAVEFORM_BUCKETS - 1) {
+                low[bucket] = bucketLow;
+                high[bucket] = bucketHigh;
+                bucketLow = bucketHigh = 0;
+                ++bucket;
+                bucketEnd = totalFrames * (bucket + 1) / WAVEFORM_BUCKETS;
+            }
+            for (unsigned ch = 0; ch < channelCount; ++ch) {
+                bucketLow = std::min<int16_t>(bucketLow, buffer[i + ch]);
+                bucketHigh = std::max<int16_t>(bucketHigh, buffer[i + ch]);
+            }
+        }
+    }
+    low[bucket] = bucketLow;
+    high[bucket] = bucketHigh;
+
+    if (loudness) {
+        int peak = 0;
+        for (int b = 0; b < WAVEFORM_BUCKETS; ++b) {
+            peak = std::max({peak, -static_cast<int>(low[b]), static_cast<int>(high[b])});
+        }
+        double meanSquare = sampleCount ? sumSquares / sampleCount / (32768.0 * 32768.0) : 0.0;
+        loudness->rmsDb = meanSquare > 1e-12 ? static_cast<float>(10.0 * std::log10(meanSquare)) : -120.0f;
+        loudness->peakDb = peak > 0 ? static_cast<float>(20.0 * std::log10(peak / 32768.0)) : -120.0f;
+    }
+
+    summary.minimum.resize(WAVEFORM_BUCKETS);
+    summary.maximum.resize(WAVEFORM_BUCKETS);
+    for (int b = 0; b < WAVEFORM_BUCKETS; ++b) {
+        summary.minimum[b] = static_cast<int8_t>(std::max(-127, low[b] / 258));
+        summary.maximum[b] = static_cast<int8_t>(std::min(127, high[b] / 258));
+    }
+    return true;
+}
+
+bool loadWaveform(const std::string& cachePath, const FileInfo& file, WaveformSummary& summary) {
+    std::ifstream inFile(cachePath, std::ios::binary);
+    if (!inFile) {
+        return false;
+    }
+    char magic[4];
+    FileInfo stored;
+    uint32_t buckets = 0;
+    inFile.read(magic, sizeof(magic));
+    inFile.read(reinterpret_cast<char*>(&stored.size), sizeof(stored.size));
+    inFile.read(reinterpret_cast<char*>(&stored.mtime), sizeof(stored.mtime));
+    inFile.read(reinterpret_cast<char*>(&buckets), sizeof(buckets));
+    if (!inFile || std::memcmp(magic, WAVEFORM_MAGIC, 4) != 0 || stored != file || buckets != WAVEFORM_BUCKETS) {
+        return false;
+    }
+    summary.file = stored;
+    summary.minimum.resize(buckets);
+    summary.maximum.resize(buckets);
+    inFile.read(reinterpret_cast<char*>(summary.minimum.data()), buckets);
+    inFile.read(reinterpret_cast<char*>(summary.maximum.data()), buckets);
+    return static_cast<bool>(inFile);
+}
+
+bool saveWaveform(const std::string& cachePath, const WaveformSummary& summary) {
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream outFile(tempPath, std::ios::binary | std::ios::trunc);
+        if (!outFile) {
+            return false;
+        }
+        uint32_t buckets = static_cast<uint32_t>(summary.minimum.size());
+        outFile.write(WAVEFORM_MAGIC, sizeof(WAVEFORM_MAGIC));
+        outFile.write(reinterpret_cast<const char*>(&summary.file.size), sizeof(summary.file.size));
+        outFile.write(reinterpret_cast<const char*>(&summary.file.mtime), sizeof(summary.file.mtime));
+        outFile.write(reinterpret_cast<const char*>(&buckets), sizeof(buckets));
+        outFile.write(reinterpret_cast<const char*>(summary.minimum.data()), buckets);
+        outFile.write(reinterpret_cast<const char*>(summary.maximum.data()), buckets);
+        if (!outFile) {
+            return false;
+        }
+    }
+    return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
+
+WaveformCache::WaveformCache(const std::string& cacheDirectory, unsigned workerCount) : directory(cacheDirectory) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&WaveformCache::run, this);
+    }
+}
+
+WaveformCache::~WaveformCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::string waveformCachePath(const std::string& cacheDirectory, const std::string& path) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.peaks", static_cast<unsigned long long>(hashString(path)));
+    return cacheDirectory + "/" + name;
+}
+
+std::string WaveformCache::cachePathFor(const std::string& path) const {
+    return waveformCachePath(directory, path);
+}
+
+void WaveformCache::request(const std::string& path, bool urgent) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (urgent && ready.count(path)) {
+            return;
+        }
+        auto pendingJob = pending.find(path);
+        if (pendingJob != pending.end()) {
+            if (urgent) {
+                pendingJob->second = true;
+                auto it = std::find_if(queue.begin(), queue.end(), [&](const Job& job) { return job.path == path; });
+                if (it != queue.end()) {
+                    queue.erase(it);
+                    queue.push_front(Job{path});
+                }
+            }
+            return;
+        }
+        pending[path] = urgent;
+        if (urgent) {
+            queue.push_front(Job{path});
+        } else {
+            queue.push_back(Job{path});
+        }
+    }
+    wake.notify_one();
+}
+
+std::shared_ptr<const WaveformSummary> WaveformCache::find(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ready.find(path);
+    return it == ready.end() ? nullptr : it->second;
+}
+
+void WaveformCache::run() {
+    // Background decoding should never compete with playback.
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        auto summary = std::make_shared<WaveformSummary>();
+        std::string cachePath = cachePathFor(job.path);
+        FileInfo info;
+        bool ok = statFile(job.path, info) && loadWaveform(cachePath, info, *summary);
+        if (!ok && computeWaveform(job.path, *summary)) {
+            ok = true;
+            if (!saveWaveform(cachePath, *summary)) {
+                std::cerr << "Could not write waveform cache: " << cachePath << std::endl;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto pendingJob = pending.find(job.path);
+        bool keepInMemory = pendingJob != pending.end() && pendingJob->second;
+        if (pendingJob != pending.end()) {
+            pending.erase(pendingJob);
+        }
+        if (ok && keepInMemory) {
+            if (ready.size() >= MAX_IN_MEMORY) {
+                ready.clear();
+            }
+            ready[job.path] = summary;
+        }
+    }
+}
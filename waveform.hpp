@@ -0,0 +1,74 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_WAVEFORM_HPP
+#define AECROS_WAVEFORM_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "file_info.hpp"
+
+const int WAVEFORM_BUCKETS = 2000;
+
+// Per-bucket min/max peaks of a whole track, scaled to -127..127.
+struct WaveformSummary {
+    FileInfo file;
+    std::vector<int8_t> minimum;
+    std::vector<int8_t> maximum;
+};
+
+// Level of a whole track in dB relative to full scale: the mean square over
+// all channels (ungated, unweighted) and the highest sample.
+struct TrackLoudness {
+    float rmsDb = -120.0f;
+    float peakDb = -120.0f;
+};
+
+// Decodes the whole file. loudness, if given, is measured in the same pass.
+bool computeWaveform(const std::string& path, WaveformSummary& summary, TrackLoudness* loudness = nullptr);
+bool loadWaveform(const std::string& cachePath, const FileInfo& file, WaveformSummary& summary);
+bool saveWaveform(const std::string& cachePath, const WaveformSummary& summary);
+// Where a cache directory keeps the summary of path.
+std::string waveformCachePath(const std::string& cacheDirectory, const std::string& path);
+
+// Generates summaries on one worker per core and keeps them on disk, so each
+// track is decoded for its waveform once. Urgent requests (the track that is
+// playing) jump the queue and are kept in memory for the UI to pick up.
+class WaveformCache {
+public:
+    explicit WaveformCache(const std::string& cacheDirectory, unsigned workerCount = 0);
+    ~WaveformCache();
+
+    void request(const std::string& path, bool urgent);
+    // Non-blocking: returns nullptr until the summary is ready.
+    std::shared_ptr<const WaveformSummary> find(const std::string& path);
+
+private:
+    struct Job {
+        std::string path;
+    };
+
+    void run();
+    std::string cachePathFor(const std::string& path) const;
+
+    std::string directory;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue;
+    // Every path queued or being computed, and whether its result is to be
+    // kept in memory. An urgent request upgrades a job already under way.
+    std::unordered_map<std::string, bool> pending;
+    std::unordered_map<std::string, std::shared_ptr<const WaveformSummary>> ready;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
+
+#endif //AECROS_WAVEFORM_HPP
@@ -0,0 +1,78 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#include "waveform_bar.hpp"
+#include <algorithm>
+
+namespace {
+
+const sf::Color PLAYED_COLOR(230, 230, 230);
+const sf::Color UNPLAYED_COLOR(110, 110, 110);
+
+}
+
+WaveformBar::WaveformBar() : vertices(sf::Lines) {
+}
+
+void WaveformBar::setBounds(const sf::FloatRect& newBounds) {
+    bounds = newBounds;
+    rebuild();
+}
+
+void WaveformBar::setSummary(std::shared_ptr<const WaveformSummary> newSummary) {
+    summary = std::move(newSummary);
+    rebuild();
+}
+
+void WaveformBar::setProgress(float progress) {
+    progress = std::max(0.0f, std::min(1.0f, progress));
+    std::size_t played = static_cast<std::size_t>(progress * columnCount);
+    if (played != playedColumns) {
+        playedColumns = played;
+        recolor();
+    }
+}
+
+void WaveformBar::rebuild() {
+    columnCount = summary && !summary->minimum.empty() ? static_cast<std::size_t>(std::max(1.0f, bounds.width)) : 0;
+    vertices.resize(columnCount * 2);
+    if (columnCount == 0) {
+        return;
+    }
+
+    std::size_t buckets = summary->minimum.size();
+    float center = bounds.top + bounds.height / 2.0f;
+    float halfHeight = bounds.height / 2.0f;
+    for (std::size_t column = 0; column < columnCount; ++column) {
+        std::size_t first = column * buckets / columnCount;
+        std::size_t last = std::max(first + 1, (column + 1) * buckets / columnCount);
+        int low = 0, high = 0;
+        for (std::size_t b = first; b < last && b < buckets; ++b) {
+            low = std::min<int>(low, summary->minimum[b]);
+            high = std::max<int>(high, summary->maximum[b]);
+        }
+        float x = bounds.left + column + 0.5f;
+        float top = center - high * halfHeight / 127.0f;
+        float bottom = center - low * halfHeight / 127.0f;
+        // Keep silent passages visible as a hairline.
+        bottom = std::max(bottom, top + 1.0f);
+        vertices[column * 2].position = sf::Vector2f(x, top);
+        vertices[column * 2 + 1].position = sf::Vector2f(x, bottom);
+    }
+    recolor();
+}
+
+void WaveformBar::recolor() {
+    for (std::size_t column = 0; column < columnCount; ++column) {
+        sf::Color color = column < playedColumns ? PLAYED_COLOR : UNPLAYED_COLOR;
+        vertices[column * 2].color = color;
+        vertices[column * 2 + 1].color = color;
+    }
+}
+
+void WaveformBar::draw(sf::RenderTarget& target) {
+    if (columnCount > 0) {
+        target.draw(vertices);
+    }
+}
@@ -0,0 +1,36 @@
+//
+// Created by mk on 10/19/26.
+//
+
+#ifndef AECROS_WAVEFORM_BAR_HPP
+#define AECROS_WAVEFORM_BAR_HPP
+
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include "waveform.hpp"
+
+// Seek bar background: the track's peak summary drawn as one line per pixel
+// column, all in a single vertex array. The played part is highlighted by
+// recolouring vertices, not by rebuilding them.
+class WaveformBar {
+public:
+    WaveformBar();
+
+    void setBounds(const sf::FloatRect& newBounds);
+    void setSummary(std::shared_ptr<const WaveformSummary> newSummary);
+    bool hasSummary() const { return summary != nullptr; }
+    void setProgress(float progress);
+    void draw(sf::RenderTarget& target);
+
+private:
+    void rebuild();
+    void recolor();
+
+    std::shared_ptr<const WaveformSummary> summary;
+    sf::FloatRect bounds;
+    sf::VertexArray vertices;
+    std::size_t columnCount = 0;
+    std::size_t playedColumns = 0;
+};
+
+#endif //AECROS_WAVEFORM_BAR_HPP
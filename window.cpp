@@ -13,11 +13,29 @@
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <ctime>
 
 #include <unistd.h>
-
-const std::string mediaDir = "media";
-const std::string mediaFilePath = mediaDir + "/directories.txt";
+#include "audio_stream.hpp"
+#include "library_journal.hpp"
+#include "media_paths.hpp"
+#include "metadata.hpp"
+#include "pcm_cache.hpp"
+#include "play_queue.hpp"
+#include "playlist.hpp"
+#include "prefetcher.hpp"
+#include "settings.hpp"
+#include "track_loader.hpp"
+#include "track_sort.hpp"
+#include "track_table.hpp"
+#include "visualizer.hpp"
+#include "waveform_bar.hpp"
+
+const std::string mediaDir = mediaDirectory();
+const std::string mediaFilePath = mediaDir + "/directories.txt";  // Pre-journal library, read once to migrate
+const std::string waveformCacheDir = mediaDir + "/waveforms";
+const std::string settingsFilePath = mediaDir + "/settings.txt";
 const std::string iconPath = "/icons";
 const std::string playIconPath = iconPath + "/play.png";
 const std::string pauseIconPath = iconPath + "/pause.png";
@@ -26,18 +44,11 @@ const std::string prevIconPath = iconPath + "/previous.png";
 
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
-
-std::string findProjectRoot() {
-    std::filesystem::path currentPath = std::filesystem::current_path();
-    while (!std::filesystem::exists(currentPath / "CMakeLists.txt")) {
-        if (currentPath.has_parent_path()) {
-            currentPath = currentPath.parent_path();
-        } else {
-            throw std::runtime_error("Project root not found");
-        }
-    }
-    return currentPath.string();
-}
+const int VISUALS_HEIGHT = 160;
+// The track list starts below the sort headers and runs down to the footer.
+const int LIST_TOP = 50;
+const int LIST_ROW_HEIGHT = 30;
+const int LIST_LEFT = 100;
 
 std::string toLowerCase(const std::string& str) {
     std::string lowerStr = str;
@@ -45,50 +56,10 @@ std::string toLowerCase(const std::string& str) {
     return lowerStr;
 }
 
-void saveMediaPaths(const std::vector<std::string>& paths){
-    std::ofstream outFile(mediaFilePath);
-    if (outFile.is_open()){
-        for(const auto& path : paths) {
-            outFile << path << std::endl;
-        }
-        outFile.close();
-    } else {
-        std::cerr << "Could not open file for writing: " << mediaFilePath << std::endl;
-    }
-}
-
-std::vector<std::string> loadMediaPaths() {
-    std::vector<std::string> paths;
-    std::ifstream inFile(mediaFilePath);
-    std::string line;
-
-    while(std::getline(inFile, line)) {
-        paths.push_back(line);
-    }
-    return paths;
-}
-
-void clearMediaPaths(std::vector<std::string>& mediaPaths) {
-    // Clear the contents of the directories.txt file
-    std::ofstream outFile(mediaFilePath, std::ofstream::out | std::ofstream::trunc);
-    if (outFile.is_open()) {
-        outFile.close();
-    } else {
-        std::cerr << "Could not open file for writing: " << mediaFilePath << std::endl;
-    }
-    mediaPaths.clear();
-}
-
 void addAudioFilesFromDirectory(const std::string& directory, std::vector<std::string>& selectedFiles) {
-    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
-        if (entry.is_regular_file()) {
-            std::string ext = entry.path().extension().string();
-            if (ext == ".mp3" || ext == ".wav" || ext == ".ogg" || ext == ".flac" || ext == ".aac") {
-                std::cout << "Adding: " << entry.path().string() << std::endl;
-                selectedFiles.push_back(entry.path().string());
-            }
-        }
-    }
+    std::size_t first = selectedFiles.size();
+    findAudioFiles(directory, selectedFiles);
+    std::cout << "Adding " << selectedFiles.size() - first << " files from " << directory << std::endl;
 }
 
 std::vector<std::string> splitPaths(const std::string& input, char delimiter) {
@@ -134,12 +105,59 @@ std::vector<std::string> openFolderDialog(sf::RenderWindow& window) {
     return selectedFiles;
 }
 
+const char* PLAYLIST_FILTERS[] = {"*.m3u", "*.m3u8", "*.pls", "*.xspf"};
+
+std::string openPlaylistDialog() {
+    const char* path = tinyfd_openFileDialog("Import Playlist", "", 4, PLAYLIST_FILTERS, "Playlists", 0);
+    return path ? path : "";
+}
+
+std::string savePlaylistDialog() {
+    const char* path = tinyfd_saveFileDialog("Export Playlist", "playlist.m3u8", 4, PLAYLIST_FILTERS, "Playlists");
+    if (!path) {
+        return "";
+    }
+    std::string playlistPath(path);
+    PlaylistFormat format;
+    if (!playlistFormatFor(playlistPath, format)) {
+        playlistPath += ".m3u8";
+    }
+    return playlistPath;
+}
+
+
+AudioStream music;
+AppSettings appSettings;
+PcmCache pcmCache(0);
+Prefetcher prefetcher;
+TrackLoader trackLoader(pcmCache, prefetcher);
+
+const float EQ_MAX_GAIN_DB = 12.0f;
+const float EQ_FREQUENCY_STEP = 1.122462f;  // A sixth of an octave
+const float EQ_Q_STEP = 1.25f;
+const FilterType EQ_TYPES[] = {FilterType::Peaking, FilterType::LowShelf, FilterType::HighShelf,
+                               FilterType::LowPass, FilterType::HighPass};
+const char* const EQ_TYPE_NAMES[] = {"Peaking", "Low shelf", "High shelf", "Low pass", "High pass"};
+
+std::string formatFrequency(float frequency) {
+    char label[16];
+    if (frequency >= 1000.0f) {
+        std::snprintf(label, sizeof(label), frequency >= 10000.0f ? "%.0fk" : "%.1fk", frequency / 1000.0f);
+    } else {
+        std::snprintf(label, sizeof(label), "%.0f", frequency);
+    }
+    return label;
+}
+const std::size_t PCM_CACHE_STEPS_MB[] = {0, 64, 128, 256, 512, 1024, 2048, 4096, 8192};
 
 void openSettingsWindow() {
-    sf::RenderWindow settingsWindow(sf::VideoMode(400, 300), "Settings");
-    sf::RectangleShape applyButton(sf::Vector2f(100,40));
-    applyButton.setFillColor(sf::Color::Blue);
-    applyButton.setPosition(150, 200);
+    const int SETTINGS_WIDTH = 520;
+    const int SETTINGS_HEIGHT = 510;
+    const float EQ_TRACK_TOP = 60.0f;
+    const float EQ_TRACK_HEIGHT = 160.0f;
+    const int EQ_SLIDER_COUNT = MAX_EQ_BANDS + 1;  // Preamp + bands
+
+    sf::RenderWindow settingsWindow(sf::VideoMode(SETTINGS_WIDTH, SETTINGS_HEIGHT), "Settings");
 
     sf::Font font;
     if(!font.loadFromFile("arial.ttf")) {
@@ -149,9 +167,133 @@ void openSettingsWindow() {
         }
     }
 
+    // Edits are published live so the EQ can be heard while dragging,
+    // and only kept if the user presses Apply.
+    DspSettings editedSettings = appSettings.dsp;
+
+    sf::Text eqTitle("Equalizer", font, 15);
+    eqTitle.setFillColor(sf::Color::White);
+    eqTitle.setPosition(20, 15);
+
+    std::vector<sf::RectangleShape> eqTracks(EQ_SLIDER_COUNT, sf::RectangleShape(sf::Vector2f(6, EQ_TRACK_HEIGHT)));
+    std::vector<sf::RectangleShape> eqKnobs(EQ_SLIDER_COUNT, sf::RectangleShape(sf::Vector2f(20, 8)));
+    std::vector<sf::Text> eqLabels;
+    for (int i = 0; i < EQ_SLIDER_COUNT; ++i) {
+        float x = (i == 0) ? 30.0f : 80.0f + (i - 1) * 42.0f;
+        eqTracks[i].setFillColor(sf::Color(80, 80, 80));
+        eqTracks[i].setPosition(x + 7, EQ_TRACK_TOP);
+        eqKnobs[i].setFillColor(i == 0 ? sf::Color(200, 200, 120) : sf::Color::White);
+
+        sf::Text labelText("Pre", font, 12);
+        labelText.setFillColor(sf::Color::White);
+        labelText.setPosition(x, EQ_TRACK_TOP + EQ_TRACK_HEIGHT + 8);
+        eqLabels.push_back(labelText);
+    }
+
+    sf::Text gainText("", font, 12);
+    gainText.setFillColor(sf::Color(180, 180, 180));
+    gainText.setPosition(20, EQ_TRACK_TOP + EQ_TRACK_HEIGHT + 28);
+
+    // Type, frequency and Q of the band last clicked; the sliders set gain.
+    const float BAND_ROW_TOP = 270.0f;
+    int selectedBand = 0;
+    auto makeButton = [](sf::Vector2f size, float x, float y) {
+        sf::RectangleShape button(size);
+        button.setFillColor(sf::Color(90, 90, 90));
+        button.setPosition(x, y);
+        return button;
+    };
+    auto makeText = [&font](const std::string& text, unsigned size, float x, float y) {
+        sf::Text label(text, font, size);
+        label.setFillColor(sf::Color::White);
+        label.setPosition(x, y);
+        return label;
+    };
+    sf::RectangleShape bandTypeButton = makeButton(sf::Vector2f(110, 28), 20, BAND_ROW_TOP);
+    sf::Text bandTypeText = makeText("", 14, 28, BAND_ROW_TOP + 5);
+    sf::RectangleShape frequencyLessButton = makeButton(sf::Vector2f(28, 28), 145, BAND_ROW_TOP);
+    sf::Text frequencyLessText = makeText("-", 18, 154, BAND_ROW_TOP + 2);
+    sf::Text frequencyText = makeText("", 14, 180, BAND_ROW_TOP + 5);
+    sf::RectangleShape frequencyMoreButton = makeButton(sf::Vector2f(28, 28), 262, BAND_ROW_TOP);
+    sf::Text frequencyMoreText = makeText("+", 18, 269, BAND_ROW_TOP + 2);
+    sf::RectangleShape qLessButton = makeButton(sf::Vector2f(28, 28), 310, BAND_ROW_TOP);
+    sf::Text qLessText = makeText("-", 18, 319, BAND_ROW_TOP + 2);
+    sf::Text qText = makeText("", 14, 345, BAND_ROW_TOP + 5);
+    sf::RectangleShape qMoreButton = makeButton(sf::Vector2f(28, 28), 412, BAND_ROW_TOP);
+    sf::Text qMoreText = makeText("+", 18, 419, BAND_ROW_TOP + 2);
+
+    sf::RectangleShape roomCorrectionButton(sf::Vector2f(160, 40));
+    roomCorrectionButton.setPosition(20, 330);
+    sf::Text roomCorrectionText("", font, 15);
+    roomCorrectionText.setFillColor(sf::Color::White);
+    roomCorrectionText.setPosition(30, 340);
+
+    sf::RectangleShape loadImpulseButton(sf::Vector2f(100, 40));
+    loadImpulseButton.setFillColor(sf::Color(90, 90, 90));
+    loadImpulseButton.setPosition(200, 330);
+    sf::Text loadImpulseText("Load IR...", font, 15);
+    loadImpulseText.setFillColor(sf::Color::White);
+    loadImpulseText.setPosition(212, 340);
+
+    sf::Text impulseNameText("", font, 12);
+    impulseNameText.setFillColor(sf::Color(180, 180, 180));
+    impulseNameText.setPosition(315, 343);
+
+    AppSettings editedAppSettings = appSettings;
+
+    sf::Text cacheText("", font, 15);
+    cacheText.setFillColor(sf::Color::White);
+    cacheText.setPosition(20, 400);
+
+    sf::RectangleShape cacheLessButton(sf::Vector2f(40, 40));
+    cacheLessButton.setFillColor(sf::Color(90, 90, 90));
+    cacheLessButton.setPosition(200, 390);
+    sf::Text cacheLessText("-", font, 20);
+    cacheLessText.setFillColor(sf::Color::White);
+    cacheLessText.setPosition(215, 396);
+
+    sf::RectangleShape cacheMoreButton(sf::Vector2f(40, 40));
+    cacheMoreButton.setFillColor(sf::Color(90, 90, 90));
+    cacheMoreButton.setPosition(250, 390);
+    sf::Text cacheMoreText("+", font, 20);
+    cacheMoreText.setFillColor(sf::Color::White);
+    cacheMoreText.setPosition(263, 396);
+
+    sf::Text cacheUsageText("", font, 12);
+    cacheUsageText.setFillColor(sf::Color(180, 180, 180));
+    cacheUsageText.setPosition(305, 403);
+
+    sf::Text prefetchText("", font, 12);
+    prefetchText.setFillColor(sf::Color(180, 180, 180));
+    prefetchText.setPosition(20, 430);
+
+    sf::RectangleShape limiterButton(sf::Vector2f(120, 40));
+    limiterButton.setPosition(20, 450);
+    sf::Text limiterText("", font, 15);
+    limiterText.setFillColor(sf::Color::White);
+    limiterText.setPosition(30, 460);
+
+    sf::RectangleShape resetButton(sf::Vector2f(100, 40));
+    resetButton.setFillColor(sf::Color(90, 90, 90));
+    resetButton.setPosition(160, 450);
+    sf::Text resetText("Reset", font, 15);
+    resetText.setFillColor(sf::Color::White);
+    resetText.setPosition(185, 460);
+
+    sf::RectangleShape applyButton(sf::Vector2f(100,40));
+    applyButton.setFillColor(sf::Color::Blue);
+    applyButton.setPosition(SETTINGS_WIDTH - 120, 450);
+
     sf::Text buttonText("Apply", font, 20);
     buttonText.setFillColor(sf::Color::White);
-    buttonText.setPosition(170, 210);
+    buttonText.setPosition(SETTINGS_WIDTH - 100, 458);
+
+    auto sliderGain = [&](int slider) -> float& {
+        return slider == 0 ? editedSettings.preampDb : editedSettings.bands[slider - 1].gainDb;
+    };
+
+    int draggingSlider = -1;
+    bool applied = false;
 
     while (settingsWindow.isOpen()) {
         sf::Event event;
@@ -160,24 +302,214 @@ void openSettingsWindow() {
                 settingsWindow.close();
             }
             if(event.type == sf::Event::MouseButtonPressed) {
-                if (applyButton.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
+                float mouseX = event.mouseButton.x;
+                float mouseY = event.mouseButton.y;
+                for (int i = 0; i < EQ_SLIDER_COUNT; ++i) {
+                    sf::FloatRect hitBox = eqTracks[i].getGlobalBounds();
+                    hitBox.left -= 10;
+                    hitBox.width += 20;
+                    if (hitBox.contains(mouseX, mouseY)) {
+                        draggingSlider = i;
+                        if (i > 0) {
+                            selectedBand = i - 1;
+                        }
+                    }
+                }
+                EqBand& band = editedSettings.bands[selectedBand];
+                bool bandChanged = true;
+                if (bandTypeButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    const std::size_t typeCount = sizeof(EQ_TYPES) / sizeof(EQ_TYPES[0]);
+                    std::size_t type = 0;
+                    while (type + 1 < typeCount && EQ_TYPES[type] != band.type) {
+                        ++type;
+                    }
+                    band.type = EQ_TYPES[(type + 1) % typeCount];
+                } else if (frequencyLessButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    band.frequency = std::max(20.0f, band.frequency / EQ_FREQUENCY_STEP);
+                } else if (frequencyMoreButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    band.frequency = std::min(20000.0f, band.frequency * EQ_FREQUENCY_STEP);
+                } else if (qLessButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    band.q = std::max(0.1f, band.q / EQ_Q_STEP);
+                } else if (qMoreButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    band.q = std::min(10.0f, band.q * EQ_Q_STEP);
+                } else {
+                    bandChanged = false;
+                }
+                if (bandChanged) {
+                    music.setDspSettings(editedSettings);
+                }
+                if (roomCorrectionButton.getGlobalBounds().contains(mouseX, mouseY) && !appSettings.impulseResponsePath.empty()) {
+                    editedSettings.roomCorrectionEnabled = !editedSettings.roomCorrectionEnabled;
+                    music.setDspSettings(editedSettings);
+                }
+                if (loadImpulseButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    const char* filters[] = {"*.wav"};
+                    const char* path = tinyfd_openFileDialog("Select Impulse Response", "", 1, filters, nullptr, 0);
+                    auto impulseResponse = std::make_shared<ImpulseResponse>();
+                    if (path && loadImpulseResponse(path, *impulseResponse)) {
+                        std::cout << "Loaded impulse response: " << path << " ("
+                                  << impulseResponse->frameCount() << " taps)" << std::endl;
+                        // The response is swapped in straight away, so it is
+                        // kept whether or not the rest is applied.
+                        appSettings.impulseResponsePath = path;
+                        editedAppSettings.impulseResponsePath = path;
+                        music.setImpulseResponse(impulseResponse);
+                        editedSettings.roomCorrectionEnabled = true;
+                        music.setDspSettings(editedSettings);
+                    }
+                }
+                if (cacheLessButton.getGlobalBounds().contains(mouseX, mouseY) ||
+                    cacheMoreButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    bool more = cacheMoreButton.getGlobalBounds().contains(mouseX, mouseY);
+                    const std::size_t stepCount = sizeof(PCM_CACHE_STEPS_MB) / sizeof(PCM_CACHE_STEPS_MB[0]);
+                    std::size_t step = 0;
+                    while (step + 1 < stepCount && PCM_CACHE_STEPS_MB[step] < editedAppSettings.pcmCacheMb) {
+                        ++step;
+                    }
+                    if (more && step + 1 < stepCount && PCM_CACHE_STEPS_MB[step] <= editedAppSettings.pcmCacheMb) {
+                        ++step;
+                    } else if (!more && step > 0) {
+                        --step;
+                    }
+                    editedAppSettings.pcmCacheMb = PCM_CACHE_STEPS_MB[step];
+                }
+                if (limiterButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    editedSettings.limiterEnabled = !editedSettings.limiterEnabled;
+                    music.setDspSettings(editedSettings);
+                }
+                if (resetButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    editedSettings = defaultDspSettings();
+                    music.setDspSettings(editedSettings);
+                }
+                if (applyButton.getGlobalBounds().contains(mouseX, mouseY)) {
+                    appSettings = editedAppSettings;
+                    appSettings.dsp = editedSettings;
+                    pcmCache.setBudget(appSettings.pcmCacheMb << 20);
+                    saveSettings(settingsFilePath, appSettings);
+                    applied = true;
                     std::cout << "Settings applied!" << std::endl;
                     settingsWindow.close();
                 }
             }
+            if (event.type == sf::Event::MouseButtonReleased) {
+                draggingSlider = -1;
+            }
+            if (draggingSlider >= 0 && (event.type == sf::Event::MouseMoved || event.type == sf::Event::MouseButtonPressed)) {
+                sf::Vector2i mousePos = sf::Mouse::getPosition(settingsWindow);
+                float progress = (mousePos.y - EQ_TRACK_TOP) / EQ_TRACK_HEIGHT;
+                progress = std::max(0.0f, std::min(1.0f, progress));
+                float gain = EQ_MAX_GAIN_DB - progress * 2.0f * EQ_MAX_GAIN_DB;
+                sliderGain(draggingSlider) = std::round(gain * 2.0f) / 2.0f;  // 0.5 dB steps
+                music.setDspSettings(editedSettings);
+            }
+        }
 
+        for (int i = 0; i < EQ_SLIDER_COUNT; ++i) {
+            float progress = (EQ_MAX_GAIN_DB - sliderGain(i)) / (2.0f * EQ_MAX_GAIN_DB);
+            eqKnobs[i].setPosition(eqTracks[i].getPosition().x - 7, EQ_TRACK_TOP + progress * EQ_TRACK_HEIGHT - 4);
+            if (i > 0) {
+                eqKnobs[i].setFillColor(i - 1 == selectedBand ? sf::Color(120, 200, 255) : sf::Color::White);
+                eqLabels[i].setString(formatFrequency(editedSettings.bands[i - 1].frequency));
+            }
+        }
+        const EqBand& shownBand = editedSettings.bands[selectedBand];
+        for (std::size_t type = 0; type < sizeof(EQ_TYPES) / sizeof(EQ_TYPES[0]); ++type) {
+            if (EQ_TYPES[type] == shownBand.type) {
+                bandTypeText.setString(EQ_TYPE_NAMES[type]);
+            }
+        }
+        char bandLabel[32];
+        std::snprintf(bandLabel, sizeof(bandLabel), "%.0f Hz", shownBand.frequency);
+        frequencyText.setString(bandLabel);
+        std::snprintf(bandLabel, sizeof(bandLabel), "Q %.2f", shownBand.q);
+        qText.setString(bandLabel);
+        if (draggingSlider >= 0) {
+            char gainLabel[64];
+            if (draggingSlider == 0) {
+                std::snprintf(gainLabel, sizeof(gainLabel), "Preamp: %+.1f dB", sliderGain(0));
+            } else {
+                std::snprintf(gainLabel, sizeof(gainLabel), "%.0f Hz: %+.1f dB",
+                              editedSettings.bands[draggingSlider - 1].frequency, sliderGain(draggingSlider));
+            }
+            gainText.setString(gainLabel);
+        } else {
+            gainText.setString("");
         }
+        roomCorrectionButton.setFillColor(editedSettings.roomCorrectionEnabled ? sf::Color(40, 120, 40) : sf::Color(90, 90, 90));
+        roomCorrectionText.setString(editedSettings.roomCorrectionEnabled ? "Room EQ: On" : "Room EQ: Off");
+        impulseNameText.setString(appSettings.impulseResponsePath.empty() ? "No impulse response"
+                                  : std::filesystem::path(appSettings.impulseResponsePath).filename().string());
+        PcmCache::Stats cacheStats = pcmCache.getStats();
+        cacheText.setString("Track cache: " + std::to_string(editedAppSettings.pcmCacheMb) + " MB");
+        cacheUsageText.setString(std::to_string(cacheStats.usedBytes >> 20) + " MB used, " +
+                                 std::to_string(cacheStats.tracks) + " tracks, " +
+                                 std::to_string(cacheStats.hits) + "/" + std::to_string(cacheStats.hits + cacheStats.misses) + " hits");
+        Prefetcher::Stats prefetchStats = prefetcher.getStats();
+        prefetchText.setString("Prefetching " + std::to_string(appSettings.prefetchTracks) + " tracks ahead, " +
+                               std::to_string(prefetchStats.bytesWarmed >> 20) + " MB warmed, " +
+                               std::to_string(prefetchStats.hits) + "/" + std::to_string(prefetchStats.hits + prefetchStats.misses) +
+                               " opens from page cache");
+        limiterButton.setFillColor(editedSettings.limiterEnabled ? sf::Color(40, 120, 40) : sf::Color(90, 90, 90));
+        limiterText.setString(editedSettings.limiterEnabled ? "Limiter: On" : "Limiter: Off");
+
         settingsWindow.clear(sf::Color(50,50,50));
+        settingsWindow.draw(eqTitle);
+        for (int i = 0; i < EQ_SLIDER_COUNT; ++i) {
+            settingsWindow.draw(eqTracks[i]);
+            settingsWindow.draw(eqKnobs[i]);
+            settingsWindow.draw(eqLabels[i]);
+        }
+        settingsWindow.draw(gainText);
+        settingsWindow.draw(bandTypeButton);
+        settingsWindow.draw(bandTypeText);
+        settingsWindow.draw(frequencyLessButton);
+        settingsWindow.draw(frequencyLessText);
+        settingsWindow.draw(frequencyText);
+        settingsWindow.draw(frequencyMoreButton);
+        settingsWindow.draw(frequencyMoreText);
+        settingsWindow.draw(qLessButton);
+        settingsWindow.draw(qLessText);
+        settingsWindow.draw(qText);
+        settingsWindow.draw(qMoreButton);
+        settingsWindow.draw(qMoreText);
+        settingsWindow.draw(roomCorrectionButton);
+        settingsWindow.draw(roomCorrectionText);
+        settingsWindow.draw(loadImpulseButton);
+        settingsWindow.draw(loadImpulseText);
+        settingsWindow.draw(impulseNameText);
+        settingsWindow.draw(cacheText);
+        settingsWindow.draw(cacheLessButton);
+        settingsWindow.draw(cacheLessText);
+        settingsWindow.draw(cacheMoreButton);
+        settingsWindow.draw(cacheMoreText);
+        settingsWindow.draw(cacheUsageText);
+        settingsWindow.draw(prefetchText);
+        settingsWindow.draw(limiterButton);
+        settingsWindow.draw(limiterText);
+        settingsWindow.draw(resetButton);
+        settingsWindow.draw(resetText);
         settingsWindow.draw(applyButton);
         settingsWindow.draw(buttonText);
         settingsWindow.display();
     }
+
+    if (!applied) {
+        music.setDspSettings(appSettings.dsp);
+    }
 }
 
-sf::Music music;
-std::vector<std::string> mediaQueue;
-size_t currentMediaIndex = 0;
-int selectedMediaIndex = -1;
+TrackTable library;
+LibraryJournal libraryJournal(mediaDir);
+PlayQueue playQueue;
+MetadataScanner metadataScanner;
+TrackId nextScanTrack = 0;  // Tracks below this have been handed to the scanner
+TrackId selectedTrack = NO_TRACK;
+TrackId loadingTrack = NO_TRACK;
+TrackId nowPlayingTrack = NO_TRACK;
+std::string nowPlayingPath;
+bool resumingLastTrack = false;  // The loader is opening appSettings.resumePath
+bool playWhenResumed = false;
+uint32_t pendingResumeMs = 0;  // Applied when the resumed track starts playing
 bool isPlaying = false;
 bool isDraggingVolume = false;
 bool isDraggingSlider = false;
@@ -188,41 +520,263 @@ sf::Texture playTexture, pauseTexture, nextTexture, prevTexture;
 sf::Sprite playButtonSprite, nextButtonSprite, prevButtonSprite;
 
 
-void playMedia(const std::string& mediaPath){
-    if(music.openFromFile(mediaPath)) {
-        music.play();
-        isPlaying = true;
-    } else {
-        std::cerr << "Could not play media: " << mediaPath << std::endl;
+// The resumed track has been found in the library: show it selected and
+// let Next and Previous carry on from it.
+void placeResumedTrack(TrackId track) {
+    nowPlayingTrack = track;
+    if (track != NO_TRACK) {
+        selectedTrack = track;
+        playQueue.setLibrary(library.size());
+        playQueue.play(track);
     }
 }
 
+// Adds the next part of the library the journal is reading in the
+// background, within a per-frame budget, so the window stays responsive and
+// the partial library can be searched and played meanwhile.
+void updateLibraryLoad() {
+    const auto LOAD_BUDGET = std::chrono::milliseconds(6);
+    if (!libraryJournal.isLoading()) {
+        return;
+    }
+    bool stillLoading = libraryJournal.applyLoaded(library, LOAD_BUDGET);
+    if (!stillLoading) {
+        if (!libraryJournal.hasStoredLibrary()) {
+            // First start with the journal: bring over the old flat path list.
+            std::ifstream inFile(mediaFilePath);
+            std::string line;
+            while (std::getline(inFile, line)) {
+                library.add(line);
+                libraryJournal.recordAdd(line);
+            }
+            if (!library.empty()) {
+                libraryJournal.compact();
+            }
+        }
+        library.shrinkToFit();
+        if (nowPlayingTrack == NO_TRACK && !nowPlayingPath.empty()) {
+            // Resumed before its row was loaded.
+            placeResumedTrack(library.find(nowPlayingPath));
+        }
+    }
+    playQueue.setLibrary(library.size());
+}
+
+void addToLibrary(const std::string& path) {
+    library.add(path);
+    libraryJournal.recordAdd(path);
+}
+
+// Hands the journal what was recorded since the last call, and folds the
+// journal into a new snapshot in the background once it has grown enough.
+void commitLibraryChanges() {
+    libraryJournal.flush();
+    if (libraryJournal.wantsCompaction()) {
+        libraryJournal.compact();
+    }
+}
+
+void prefetchUpcoming() {
+    std::vector<std::string> upcoming;
+    for (TrackId track : playQueue.peek(appSettings.prefetchTracks)) {
+        if (track != playQueue.current()) {
+            upcoming.push_back(library.path(track));
+        }
+    }
+    prefetcher.schedule(upcoming);
+}
+
+// Opening happens on the loader thread; startLoadedMedia() picks the result up.
+void playMedia(TrackId track){
+    resumingLastTrack = false;
+    playWhenResumed = false;
+    pendingResumeMs = 0;
+    loadingTrack = track;
+    trackLoader.request(library.path(track));
+}
+
+// Opens the last played track paused at its old position, before the
+// library has loaded, so Play picks it up straight away.
+void resumeLastPlayed() {
+    if (appSettings.resumePath.empty()) {
+        return;
+    }
+    resumingLastTrack = true;
+    trackLoader.request(appSettings.resumePath);
+}
+
+void resumePlayback() {
+    music.play();
+    if (pendingResumeMs > 0) {
+        // A stopped stream ignores seeks, so this has to follow play().
+        music.setPlayingOffset(sf::milliseconds(static_cast<sf::Int32>(pendingResumeMs)));
+        pendingResumeMs = 0;
+    }
+    isPlaying = true;
+    playButtonSprite.setTexture(pauseTexture);
+}
+
+void saveResumePosition() {
+    if (nowPlayingPath.empty()) {
+        return;
+    }
+    appSettings.resumePath = nowPlayingPath;
+    appSettings.resumePositionMs = pendingResumeMs > 0 ? pendingResumeMs
+                                                       : static_cast<uint32_t>(music.getPlayingOffset().asMilliseconds());
+    saveSettings(settingsFilePath, appSettings);
+}
+
+void startLoadedMedia() {
+    TrackLoader::Result loaded;
+    if (!trackLoader.poll(loaded)) {
+        return;
+    }
+    if (resumingLastTrack) {
+        resumingLastTrack = false;
+        if (loaded.ok) {
+            music.open(std::move(loaded.source));
+            nowPlayingPath = loaded.path;
+            // NO_TRACK while its row has not loaded; updateLibraryLoad() places it then.
+            placeResumedTrack(library.find(loaded.path));
+            pendingResumeMs = appSettings.resumePositionMs;
+            if (playWhenResumed) {
+                resumePlayback();
+            }
+        }
+        playWhenResumed = false;
+        return;
+    }
+    TrackId track = loadingTrack;
+    loadingTrack = NO_TRACK;
+    if (!loaded.ok) {
+        // Whatever was playing before carries on; the button follows it.
+        std::cerr << "Could not play media: " << loaded.path << std::endl;
+        isPlaying = music.getStatus() == sf::SoundSource::Playing;
+        playButtonSprite.setTexture(isPlaying ? pauseTexture : playTexture);
+        return;
+    }
+    music.open(std::move(loaded.source));
+    music.play();
+    isPlaying = true;
+    playButtonSprite.setTexture(pauseTexture);
+    nowPlayingPath = loaded.path;
+    nowPlayingTrack = track;
+    appSettings.resumePath = loaded.path;
+    appSettings.resumePositionMs = 0;
+    saveSettings(settingsFilePath, appSettings);
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+    library.notePlayed(track, now);
+    libraryJournal.recordPlayed(track, now);
+    commitLibraryChanges();
+    if (!loaded.fromCache) {
+        pcmCache.prefill(loaded.path);
+    }
+    prefetchUpcoming();
+}
+
 void stopMedia() {
+    trackLoader.cancel();
+    loadingTrack = NO_TRACK;
     music.stop();
     isPlaying = false;
 }
 
 void nextMedia() {
-    if(mediaQueue.empty()) return;
-    currentMediaIndex = (currentMediaIndex + 1) % mediaQueue.size();
-    selectedMediaIndex = currentMediaIndex;
+    TrackId track = playQueue.next();
+    if(track == NO_TRACK) return;
+    selectedTrack = track;
     stopMedia();
-    std::cout << "Next Media: " << mediaQueue[currentMediaIndex] << std::endl;
-    playMedia(mediaQueue[currentMediaIndex]);
+    std::cout << "Next Media: " << library.path(track) << std::endl;
+    playMedia(track);
 }
 
 void prevMedia() {
-    if(mediaQueue.empty()) return;
+    TrackId track = playQueue.previous();
+    if(track == NO_TRACK) return;
     stopMedia();
-    currentMediaIndex = (currentMediaIndex == 0) ? mediaQueue.size() - 1 : currentMediaIndex - 1;
-    selectedMediaIndex = currentMediaIndex;
-    playMedia(mediaQueue[currentMediaIndex]);
+    selectedTrack = track;
+    playMedia(track);
+}
+
+// Hands the scanner a batch at a time so its queue stays small, and applies
+// whatever it has finished. Runs once per frame. Tracks whose tags were
+// restored from the journal are not scanned again.
+void updateLibraryMetadata() {
+    const std::size_t SCAN_BATCH = 256;
+    if (libraryJournal.isLoading()) {
+        // Rows still to come may carry tags already.
+        return;
+    }
+    if (nextScanTrack < library.size() && metadataScanner.backlog() < SCAN_BATCH) {
+        std::size_t requested = 0;
+        for (; nextScanTrack < library.size() && requested < SCAN_BATCH; ++nextScanTrack) {
+            if (!library.hasInfo(nextScanTrack) && !library.isRemoved(nextScanTrack)) {
+                metadataScanner.request(nextScanTrack, library.path(nextScanTrack));
+                requested++;
+            }
+        }
+    }
+    std::vector<MetadataScanner::Result> results;
+    if (metadataScanner.poll(results)) {
+        for (const auto& result : results) {
+            if (result.ok) {
+                library.setInfo(result.id, result.info);
+                libraryJournal.recordInfo(result.id, result.info);
+            }
+        }
+        commitLibraryChanges();
+    }
+}
+
+std::string trackLabel(TrackId track) {
+    std::string_view title = library.title(track);
+    if (title.empty()) {
+        return library.path(track);
+    }
+    std::string_view artist = library.artist(track);
+    std::string label(artist);
+    if (!label.empty()) {
+        label += " - ";
+    }
+    label.append(title.data(), title.size());
+    return label;
+}
+
+std::string formatLibrarySummary() {
+    uint64_t minutes = library.totalDurationMs() / 60000;
+    return std::to_string(library.trackCount()) + " tracks, " + std::to_string(minutes / 60) + "h " +
+           std::to_string(minutes % 60) + "m" + (libraryJournal.isLoading() ? " (loading)" : "") +
+           (libraryJournal.isReadOnly() ? " (read-only)" : "");
+}
+
+// Clicking the primary column flips its direction; any other column becomes
+// the primary key and the previous ones break its ties.
+void applySortClick(std::vector<SortKey>& keys, SortColumn column) {
+    if (!keys.empty() && keys.front().column == column) {
+        keys.front().descending = !keys.front().descending;
+        return;
+    }
+    keys.erase(std::remove_if(keys.begin(), keys.end(), [column](const SortKey& key) { return key.column == column; }),
+               keys.end());
+    keys.insert(keys.begin(), SortKey{column, false});
+    if (keys.size() > MAX_SORT_KEYS) {
+        keys.resize(MAX_SORT_KEYS);
+    }
 }
 
 void openMainWindow() {
     if(!std::filesystem::exists(mediaDir)){
-        std::filesystem::create_directory(mediaDir);
+        std::filesystem::create_directories(mediaDir);
     }
+    appSettings = loadSettings(settingsFilePath);
+    pcmCache.setBudget(appSettings.pcmCacheMb << 20);
+    music.setImpulseResponse(loadRoomCorrection(appSettings));
+    music.setDspSettings(appSettings.dsp);
+    // Tracks removed by another frontend stay as empty rows; skip them.
+    playQueue.setRemoved(&library.removedFlags());
+    // Both run in the background while the window and its assets come up.
+    libraryJournal.startLoad();
+    resumeLastPlayed();
 
     char cwd[1024];
     if (getcwd(cwd, sizeof(cwd)) != NULL) {
@@ -244,6 +798,7 @@ void openMainWindow() {
     }
 
     sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Aecros", sf::Style::Default);
+    window.setFramerateLimit(60);
     sf::View view = window.getDefaultView();
     sf::Font font;
 
@@ -283,6 +838,15 @@ void openMainWindow() {
     sliderKnob.setFillColor(sf::Color::White);
     sliderKnob.setPosition(200, WINDOW_HEIGHT - 40);
 
+    sf::Text loadingText("Loading...", font, 15);
+    loadingText.setFillColor(sf::Color(200, 200, 120));
+    loadingText.setPosition(200, WINDOW_HEIGHT - 42);
+
+    WaveformCache waveformCache(waveformCacheDir);
+    WaveformBar waveformBar;
+    waveformBar.setBounds(sf::FloatRect(200, WINDOW_HEIGHT - 46, 400, 32));
+    std::string waveformPath;
+
     sf::RectangleShape volumeBar(sf::Vector2f(60, 10));
     volumeBar.setFillColor(sf::Color(80, 80, 80));
     volumeBar.setPosition(620, WINDOW_HEIGHT-35);
@@ -314,10 +878,49 @@ void openMainWindow() {
     clearMediaButton.setFillColor(sf::Color(120, 120, 120));
     clearMediaButton.setPosition(10, 120);
 
+    sf::RectangleShape importPlaylistButton(sf::Vector2f(FILE_MENU_SIZE_LENGTH, FILE_MENU_ITEM_HEIGHT));
+    importPlaylistButton.setFillColor(sf::Color(120, 120, 120));
+    importPlaylistButton.setPosition(10, 150);
+
+    sf::RectangleShape exportPlaylistButton(sf::Vector2f(FILE_MENU_SIZE_LENGTH, FILE_MENU_ITEM_HEIGHT));
+    exportPlaylistButton.setFillColor(sf::Color(120, 120, 120));
+    exportPlaylistButton.setPosition(10, 180);
+
     sf::Text fileMenuText("File", font, 15);
     fileMenuText.setFillColor(sf::Color::White);
     fileMenuText.setPosition(20, 5);
 
+    Visualizer visualizer(music.outputTap());
+    visualizer.setArea(sf::FloatRect(0, WINDOW_HEIGHT - 50 - VISUALS_HEIGHT, WINDOW_WIDTH, VISUALS_HEIGHT));
+
+    sf::RectangleShape visualsButton(sf::Vector2f(150, FILE_MENU_ITEM_HEIGHT));
+    visualsButton.setFillColor(sf::Color(100, 100, 100));
+    visualsButton.setPosition(170, 0);
+
+    sf::Text visualsText(visualizer.getModeName(), font, 15);
+    visualsText.setFillColor(sf::Color::White);
+    visualsText.setPosition(180, 5);
+
+    sf::RectangleShape shuffleButton(sf::Vector2f(120, FILE_MENU_ITEM_HEIGHT));
+    shuffleButton.setFillColor(sf::Color(100, 100, 100));
+    shuffleButton.setPosition(330, 0);
+
+    sf::Text shuffleText("Shuffle: Off", font, 15);
+    shuffleText.setFillColor(sf::Color::White);
+    shuffleText.setPosition(340, 5);
+
+    sf::Text libraryText("", font, 12);
+    libraryText.setFillColor(sf::Color(200, 200, 200));
+    libraryText.setPosition(460, 8);
+
+    std::vector<sf::Text> sortHeaders;
+    for (int column = 0; column < SORT_COLUMN_COUNT; ++column) {
+        sf::Text header(sortColumnName(static_cast<SortColumn>(column)), font, 12);
+        header.setFillColor(sf::Color(200, 200, 200));
+        header.setPosition(100 + column * 80, 32);
+        sortHeaders.push_back(header);
+    }
+
     sf::Text settingsText("Settings", font, 15);
     settingsText.setFillColor(sf::Color::White);
     settingsText.setPosition(20,35);
@@ -334,6 +937,14 @@ void openMainWindow() {
     clearMediaText.setFillColor(sf::Color::White);
     clearMediaText.setPosition(20, 125);
 
+    sf::Text importPlaylistText("Import Playlist", font, 15);
+    importPlaylistText.setFillColor(sf::Color::White);
+    importPlaylistText.setPosition(20, 155);
+
+    sf::Text exportPlaylistText("Export Playlist", font, 15);
+    exportPlaylistText.setFillColor(sf::Color::White);
+    exportPlaylistText.setPosition(20, 185);
+
     sf::RectangleShape searchBar(sf::Vector2f(200, 24));
     searchBar.setFillColor(sf::Color(80, 80, 80));
     searchBar.setPosition(WINDOW_WIDTH-210, 3);
@@ -348,15 +959,37 @@ void openMainWindow() {
     window.draw(volumeLevelText);
 
 
-    std::vector<std::string> mediaPaths = loadMediaPaths();
-    bool noMediaDetected = mediaPaths.empty();
+    // Filled in over the first frames by updateLibraryLoad().
+    bool noMediaDetected = false;
+
+    // Rows currently on screen, rebuilt when the query, the sort or the
+    // library changes. A fresh vector each time, so the play queue can keep
+    // the one it was started from.
+    auto visibleTracks = std::make_shared<std::vector<TrackId>>();
+    std::string visibleQuery;
+    uint64_t visibleVersion = UINT64_MAX;
+    sf::Clock visibleAge;
+    sf::Int32 visibleCostMs = 0;
+    bool sortChanged = false;
+    std::vector<SortKey> sortKeys;
+    TrackSorter trackSorter;
     bool dropdownVisible = false;
+    std::size_t listScroll = 0;  // Index in visibleTracks of the top row on screen
+    // Only the rows on screen are ever laid out, however long the list is.
+    auto listRowsShown = [&]() -> std::size_t {
+        int bottom = static_cast<int>(window.getSize().y) - 50;
+        if (visualizer.getMode() != VisualMode::Off) {
+            bottom -= VISUALS_HEIGHT;
+        }
+        return bottom > LIST_TOP ? static_cast<std::size_t>((bottom - LIST_TOP) / LIST_ROW_HEIGHT) : 0;
+    };
 
     while (window.isOpen()) {
         sf::Event event;
 
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed) {
+                saveResumePosition();
                 window.close();
             }
 
@@ -371,6 +1004,17 @@ void openMainWindow() {
                 }
             }
 
+            if (event.type == sf::Event::MouseWheelScrolled &&
+                event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+                // Three rows a notch; the top is clamped to the list when drawn.
+                long rows = std::lround(event.mouseWheelScroll.delta * 3);
+                if (rows > 0) {
+                    listScroll -= std::min(listScroll, static_cast<std::size_t>(rows));
+                } else {
+                    listScroll += static_cast<std::size_t>(-rows);
+                }
+            }
+
             if (event.type == sf::Event::Resized) {
                 // Update the view to the new size
                 view.setSize(event.size.width, event.size.height);  // Set view size to new window size
@@ -389,6 +1033,8 @@ void openMainWindow() {
 
                 sliderBar.setPosition(200 * scaleX, (WINDOW_HEIGHT - 35) * scaleY);
                 sliderKnob.setPosition(200 * scaleX, (WINDOW_HEIGHT - 40) * scaleY);
+                loadingText.setPosition(200 * scaleX, (WINDOW_HEIGHT - 42) * scaleY);
+                waveformBar.setBounds(sf::FloatRect(200 * scaleX, (WINDOW_HEIGHT - 46) * scaleY, 400 * scaleX, 32 * scaleY));
 
                 volumeBar.setPosition(620 * scaleX, (WINDOW_HEIGHT - 35) * scaleY);
                 volumeKnob.setPosition((620 + 50) * scaleX, (WINDOW_HEIGHT - 40) * scaleY);
@@ -401,6 +1047,7 @@ void openMainWindow() {
                 searchText.setFillColor(sf::Color::White);
                 searchText.setPosition(event.size.width-200, 5);
 
+                visualizer.setArea(sf::FloatRect(0, event.size.height - 50.0f - VISUALS_HEIGHT, event.size.width, VISUALS_HEIGHT));
 
                 // Resize other UI elements similarly
             }
@@ -414,6 +1061,18 @@ void openMainWindow() {
                 fileMenu.setFillColor(sf::Color(100, 100, 100));
             }
 
+            if (visualsButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                visualsButton.setFillColor(sf::Color(80, 80, 80));
+            } else {
+                visualsButton.setFillColor(sf::Color(100, 100, 100));
+            }
+
+            if (shuffleButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                shuffleButton.setFillColor(sf::Color(80, 80, 80));
+            } else {
+                shuffleButton.setFillColor(sf::Color(100, 100, 100));
+            }
+
             // Settings menu hover
             if (dropdownVisible && settingsOption.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
                 settingsOption.setFillColor(sf::Color(140, 140, 140));
@@ -440,19 +1099,31 @@ void openMainWindow() {
                 clearMediaButton.setFillColor(sf::Color(120, 120, 120));
             }
 
+            if (dropdownVisible && importPlaylistButton.getGlobalBounds().contains(mousePos.x, mousePos.y)){
+                importPlaylistButton.setFillColor(sf::Color(140, 140, 140));
+            } else {
+                importPlaylistButton.setFillColor(sf::Color(120, 120, 120));
+            }
+
+            if (dropdownVisible && exportPlaylistButton.getGlobalBounds().contains(mousePos.x, mousePos.y)){
+                exportPlaylistButton.setFillColor(sf::Color(140, 140, 140));
+            } else {
+                exportPlaylistButton.setFillColor(sf::Color(120, 120, 120));
+            }
+
 
             if (event.type == sf::Event::MouseButtonPressed) {
                 sf::Vector2i mousePos = sf::Mouse::getPosition(window);
 
-                if(playButtonSprite.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
+                if(playButtonSprite.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y) && loadingTrack == NO_TRACK) {
                     if (isPlaying) {
                         music.pause();
                         isPlaying = false;
                         playButtonSprite.setTexture(playTexture);
+                    } else if (resumingLastTrack) {
+                        playWhenResumed = true;
                     } else {
-                        music.play();
-                        isPlaying = true;
-                        playButtonSprite.setTexture(pauseTexture);
+                        resumePlayback();
                     }
                 }
 
@@ -474,42 +1145,82 @@ void openMainWindow() {
                     prevMedia();
                 }
 
-                size_t yOffset = 50;
-                for (size_t i = 0; i < mediaPaths.size(); ++i) {
-                    sf::Text mediaText(mediaPaths[i], font, 15);
-                    mediaText.setPosition(100, yOffset);
-
-                    // Check if mouse clicked on a media path (song)
-                    if (mediaText.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
-                        selectedMediaIndex = i;  // Store the index of the selected media
-                        playMedia(mediaPaths[i]); // Play the selected media
-                        mediaQueue = mediaPaths;
-                        currentMediaIndex = i;
-                        for(std::string media: mediaPaths) {
-                            std::cout << media << std::endl;
+                for (int column = 0; column < SORT_COLUMN_COUNT; ++column) {
+                    if (!dropdownVisible && sortHeaders[column].getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                        applySortClick(sortKeys, static_cast<SortColumn>(column));
+                        for (int other = 0; other < SORT_COLUMN_COUNT; ++other) {
+                            std::string label = sortColumnName(static_cast<SortColumn>(other));
+                            if (sortKeys.front().column == static_cast<SortColumn>(other)) {
+                                label += sortKeys.front().descending ? " v" : " ^";
+                            }
+                            sortHeaders[other].setString(label);
+                        }
+                        sortChanged = true;
+                    }
+                }
+
+                // The row under the pointer, worked out rather than found by
+                // laying out every row.
+                if (!dropdownVisible && mousePos.x >= LIST_LEFT && mousePos.y >= LIST_TOP &&
+                    static_cast<std::size_t>(mousePos.y - LIST_TOP) / LIST_ROW_HEIGHT < listRowsShown()) {
+                    std::size_t row = listScroll + static_cast<std::size_t>(mousePos.y - LIST_TOP) / LIST_ROW_HEIGHT;
+                    TrackId track = row < visibleTracks->size() ? (*visibleTracks)[row] : NO_TRACK;
+                    if (track != NO_TRACK) {
+                        if (event.mouseButton.button == sf::Mouse::Right) {
+                            // Right click queues the track to play after the current one
+                            playQueue.enqueueNext(track);
+                            prefetchUpcoming();
+                        } else {
+                            selectedTrack = track;
+                            // Play on through the list as it is shown, sorted and filtered.
+                            playQueue.setOrder(visibleTracks);
+                            playQueue.play(track, row);
+                            playMedia(track); // Play the selected media
+                            playButtonSprite.setTexture(pauseTexture);
                         }
-                        playButtonSprite.setTexture(pauseTexture);
                     }
-                    yOffset += 30;
                 }
 
                 if(fileMenu.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
                     dropdownVisible = !dropdownVisible;
                 }
 
-                if (dropdownVisible && importMediaDropdownButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                if (visualsButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                    visualizer.cycleMode();
+                    visualsText.setString(visualizer.getModeName());
+                }
+
+                if (shuffleButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                    playQueue.setShuffle(!playQueue.isShuffled());
+                    shuffleText.setString(playQueue.isShuffled() ? "Shuffle: On" : "Shuffle: Off");
+                    prefetchUpcoming();
+                }
+
+                // Adding or clearing waits for the library to finish loading, so
+                // loaded rows keep the IDs the journal refers to.
+                if (dropdownVisible && !libraryJournal.isLoading() &&
+                    importMediaDropdownButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
                     std::vector<std::string> files = openFileDialog(window);
-                    mediaPaths.insert(mediaPaths.end(), files.begin(), files.end());
-                    saveMediaPaths(mediaPaths); // Save updated paths
-                    noMediaDetected = mediaPaths.empty(); // Update the status
+                    for (const auto& file : files) {
+                        addToLibrary(file);
+                        waveformCache.request(file, false);
+                    }
+                    commitLibraryChanges();
+                    playQueue.setLibrary(library.size());
+                    noMediaDetected = library.trackCount() == 0; // Update the status
                     dropdownVisible = false;
                 }
 
-                if (dropdownVisible && importMediaFolderButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                if (dropdownVisible && !libraryJournal.isLoading() &&
+                    importMediaFolderButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
                     std::vector<std::string> files = openFolderDialog(window);
-                    mediaPaths.insert(mediaPaths.end(), files.begin(), files.end());
-                    saveMediaPaths(mediaPaths); // Save updated paths
-                    noMediaDetected = mediaPaths.empty(); // Update the status
+                    for (const auto& file : files) {
+                        addToLibrary(file);
+                        waveformCache.request(file, false);
+                    }
+                    commitLibraryChanges();
+                    playQueue.setLibrary(library.size());
+                    noMediaDetected = library.trackCount() == 0; // Update the status
                     dropdownVisible = false;
                 }
 
@@ -519,11 +1230,51 @@ void openMainWindow() {
                     dropdownVisible = false;
                 }
 
-                if(dropdownVisible && clearMediaButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
-                    clearMediaPaths(mediaPaths);
+                if (dropdownVisible && !libraryJournal.isLoading() &&
+                    clearMediaButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                    library.clear();
+                    libraryJournal.recordClear();
+                    commitLibraryChanges();
+                    metadataScanner.cancel();
+                    nextScanTrack = 0;
+                    playQueue.clear();
+                    visibleTracks = std::make_shared<std::vector<TrackId>>();
+                    selectedTrack = NO_TRACK;
+                    nowPlayingTrack = NO_TRACK;
+                    dropdownVisible = false;
+                    noMediaDetected = library.trackCount() == 0;
+                }
+
+                if (dropdownVisible && !libraryJournal.isLoading() &&
+                    importPlaylistButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                    std::string playlistPath = openPlaylistDialog();
+                    auto playlist = std::make_shared<std::vector<TrackId>>();
+                    TrackId knownTracks = static_cast<TrackId>(library.size());
+                    if (!playlistPath.empty() && importPlaylist(playlistPath, library, *playlist)) {
+                        std::string path;
+                        for (TrackId id = knownTracks; id < library.size(); ++id) {
+                            library.path(id, path);
+                            libraryJournal.recordAdd(path);
+                        }
+                        commitLibraryChanges();
+                        playQueue.setLibrary(library.size());
+                        // The playlist becomes the play order; Next starts it from the top.
+                        playQueue.setOrder(playlist);
+                        prefetchUpcoming();
+                        noMediaDetected = library.trackCount() == 0;
+                    } else if (!playlistPath.empty()) {
+                        std::cerr << "Could not read playlist: " << playlistPath << std::endl;
+                    }
+                    dropdownVisible = false;
+                }
+
+                if (dropdownVisible && exportPlaylistButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
+                    // Exports the list as shown, filtered and sorted.
+                    std::string playlistPath = savePlaylistDialog();
+                    if (!playlistPath.empty() && !writePlaylist(playlistPath, library, *visibleTracks)) {
+                        std::cerr << "Could not write playlist: " << playlistPath << std::endl;
+                    }
                     dropdownVisible = false;
-                    //std::cout << mediaPaths.empty();
-                    noMediaDetected = mediaPaths.empty();
                 }
             }
 
@@ -540,6 +1291,7 @@ void openMainWindow() {
                 // Calculate new playback position based on slider position
                 float progress = (newPosX - sliderBar.getPosition().x) / sliderBar.getSize().x;
                 music.setPlayingOffset(sf::seconds(music.getDuration().asSeconds() * progress));
+                waveformBar.setProgress(progress);
             }
 
             if (isDraggingVolume) {
@@ -555,9 +1307,28 @@ void openMainWindow() {
 
         }
 
+        if (libraryJournal.isLoading()) {
+            updateLibraryLoad();
+            noMediaDetected = library.trackCount() == 0 && !libraryJournal.isLoading();
+        }
+        startLoadedMedia();
+        updateLibraryMetadata();
+
         if (isPlaying && !isDraggingSlider) {
             float progress = music.getPlayingOffset().asSeconds() / music.getDuration().asSeconds();
             sliderKnob.setPosition(sliderBar.getPosition().x + sliderBar.getSize().x * progress, sliderKnob.getPosition().y);
+            waveformBar.setProgress(progress);
+        }
+
+        if (nowPlayingPath != waveformPath) {
+            waveformPath = nowPlayingPath;
+            waveformBar.setSummary(nullptr);
+            waveformCache.request(waveformPath, true);
+        }
+        if (!waveformBar.hasSummary() && !waveformPath.empty()) {
+            if (auto summary = waveformCache.find(waveformPath)) {
+                waveformBar.setSummary(summary);
+            }
         }
 
         window.clear(sf::Color::Black);
@@ -568,14 +1339,32 @@ void openMainWindow() {
         window.draw(playButtonSprite);
         window.draw(nextButtonSprite);
         window.draw(prevButtonSprite);
-        window.draw(sliderBar);
-        window.draw(sliderKnob);
+        if (loadingTrack != NO_TRACK) {
+            window.draw(loadingText);
+        } else {
+            if (waveformBar.hasSummary()) {
+                waveformBar.draw(window);
+            } else {
+                window.draw(sliderBar);
+            }
+            window.draw(sliderKnob);
+        }
         window.draw(volumeBar);
         window.draw(volumeKnob);
         window.draw(fileMenu);
         window.draw(fileMenuText);
+        window.draw(visualsButton);
+        window.draw(visualsText);
+        window.draw(shuffleButton);
+        window.draw(shuffleText);
+        window.draw(libraryText);
         window.draw(searchBar);
         window.draw(searchText);
+        if (!noMediaDetected) {
+            for (const auto& header : sortHeaders) {
+                window.draw(header);
+            }
+        }
         if(dropdownVisible) {
             window.draw(settingsOption);
             window.draw(settingsText);
@@ -585,6 +1374,10 @@ void openMainWindow() {
             window.draw(importMediaDropdownText);
             window.draw(clearMediaButton);
             window.draw(clearMediaText);
+            window.draw(importPlaylistButton);
+            window.draw(importPlaylistText);
+            window.draw(exportPlaylistButton);
+            window.draw(exportPlaylistText);
         }
         if (noMediaDetected) {
             sf::Text noMediaText("No media detected!", font, 15);
@@ -592,40 +1385,61 @@ void openMainWindow() {
             noMediaText.setPosition((WINDOW_WIDTH-120)/2, (WINDOW_HEIGHT+20)/2 - 20);
             window.draw(noMediaText);
         } else {
-            // Vector to store only matching media paths
-            std::vector<std::string> matchingMediaPaths;
-            std::string lowerSearchQuery = toLowerCase(searchQuery); // Convert search query to lowercase
-
-            // Collect only the matching media paths
-            for (const auto& mediaPath : mediaPaths) {
-                std::string lowerMediaPath = toLowerCase(mediaPath); // Convert media path to lowercase
-                if (lowerMediaPath.find(lowerSearchQuery) != std::string::npos) {
-                    matchingMediaPaths.push_back(mediaPath); // Add to matching list
+            // Re-run the search and sort when the query or sort changes. While
+            // the library is still being imported or scanned, refresh at most
+            // twice a second, and less often when a refresh is expensive.
+            // A title sort waits, showing the rows as they were, while its
+            // ranks are built on the sorter's worker.
+            bool queryChanged = searchQuery != visibleQuery;
+            sf::Int32 refreshInterval = std::max<sf::Int32>(500, visibleCostMs * 10);
+            if ((queryChanged || sortChanged ||
+                 (library.version() != visibleVersion && visibleAge.getElapsedTime().asMilliseconds() > refreshInterval)) &&
+                trackSorter.prepare(library, sortKeys)) {
+                sf::Clock refreshClock;
+                auto rows = std::make_shared<std::vector<TrackId>>();
+                library.search(searchQuery, *rows);
+                if (!sortKeys.empty()) {
+                    trackSorter.sort(library, sortKeys, *rows);
                 }
+                visibleTracks = rows;
+                visibleQuery = searchQuery;
+                visibleVersion = library.version();
+                visibleCostMs = refreshClock.getElapsedTime().asMilliseconds();
+                visibleAge.restart();
+                sortChanged = false;
+                libraryText.setString(formatLibrarySummary());
             }
 
             // If there are no matching items, display a "No matches" text
-            if (matchingMediaPaths.empty() && !searchQuery.empty()) {
+            if (visibleTracks->empty() && !searchQuery.empty()) {
                 sf::Text noMatchesText("No matches found!", font, 15);
                 noMatchesText.setFillColor(sf::Color::White);
                 noMatchesText.setPosition((WINDOW_WIDTH - 120) / 2, (WINDOW_HEIGHT + 20) / 2 - 20);
                 window.draw(noMatchesText);
             } else {
-                // Draw only matching media paths
-                size_t yOffset = 50; // Starting Y position
-                for (size_t i = 0; i < matchingMediaPaths.size(); ++i) {
-                    sf::Text mediaText(matchingMediaPaths[i], font, 15);
+                // Draw only the matching rows that are on screen.
+                std::size_t shown = listRowsShown();
+                std::size_t maxScroll = visibleTracks->size() > shown ? visibleTracks->size() - shown : 0;
+                listScroll = std::min(listScroll, maxScroll);
+                std::size_t end = std::min(visibleTracks->size(), listScroll + shown);
+                size_t yOffset = LIST_TOP; // Starting Y position
+                for (std::size_t row = listScroll; row < end; ++row) {
+                    TrackId track = (*visibleTracks)[row];
+                    sf::Text mediaText(trackLabel(track), font, 15);
                     mediaText.setFillColor(sf::Color::White);
-                    mediaText.setPosition(100, yOffset);
-                    if (i == selectedMediaIndex) {
-                        mediaText.setFillColor(sf::Color::Green);
+                    mediaText.setPosition(LIST_LEFT, yOffset);
+                    if (track == selectedTrack) {
+                        mediaText.setFillColor(track == loadingTrack ? sf::Color::Yellow : sf::Color::Green);
                     }
                     window.draw(mediaText);
-                    yOffset += 30; // Increment Y position for the next item
+                    yOffset += LIST_ROW_HEIGHT; // Increment Y position for the next item
                 }
             }
         }
 
+        visualizer.update();
+        visualizer.draw(window);
+
         window.display();
     }
 }
\ No newline at end of file